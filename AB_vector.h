@@ -22,6 +22,21 @@
  *    Define this macro to be the runtime check function. Pulls in
  *    assert.h for @c assert as fallback.
  *
+ *  - AB_VEC_CHECK_LEVEL
+ *    Define this macro to choose which checks go through AB_VEC_ASSERT:
+ *     - 0: none. Invariants such as @c num <= @c capacity are passed to the
+ *       optimizer through AB_VEC_ASSUME instead.
+ *     - 1: cheap argument checks (NULL vectors, popping an empty vector).
+ *     - 2: as 1, plus bounds checks on every @c AB_vec_at().
+ *    Defaults to 0 when @c NDEBUG is defined and AB_VEC_ASSERT is not
+ *    customized, and to 1 otherwise.
+ *
+ *  - AB_VEC_ASSUME(cond)
+ *    Define this macro to tell the optimizer that @c cond holds. @c cond
+ *    must not have side effects. Defaults to AB_VEC_ASSERT at check levels
+ *    1 and 2, and to @c __builtin_assume, @c __builtin_unreachable,
+ *    @c __assume or C23 @c unreachable at level 0.
+ *
  *  - AB_VEC_USERDATA
  *    Define this macro to insert an additional member into the vector.
  *    This member is passed to the memory allocation functions
@@ -36,6 +51,25 @@
  *    Define this macro to customize memory usage of the vector. Same rules
  *    apply as for AB_VEC_REALLOC. Pulls in stdlib.h for @c free as fallback.
  *
+ *  - AB_VEC_CALLOC(size, userdata)
+ *    Define this macro to allocate zeroed memory for @c AB_vec_resize_zero().
+ *    Defaults to @c calloc when AB_VEC_REALLOC is not customized. If left
+ *    undefined with a custom AB_VEC_REALLOC, zeroing falls back to
+ *    @c memset over the reallocated buffer.
+ *
+ *  - AB_VEC_TYPEOF(expr)
+ *    Define this macro to an operator yielding the type of @c expr. Detected
+ *    as C23 @c typeof or GNU @c __typeof__ in C99 and later. When available,
+ *    the element access and push macros evaluate each argument exactly once.
+ *    Define AB_VEC_NO_TYPEOF to keep the ANSI C90 macros, which may evaluate
+ *    the vector argument several times.
+ *
+ *  - AB_VEC_LIKELY(cond), AB_VEC_UNLIKELY(cond), AB_VEC_COLD
+ *    Branch prediction hints and the attribute for out-of-line slow paths.
+ *    Default to @c __builtin_expect and @c noinline, @c cold on GNU
+ *    compilers, so every push site only carries the compare and the store.
+ *    Defining AB_VEC_COLD to @c AB_VEC_INLINE inlines the growth again.
+ *
  *  - AB_VEC_SIZE_T
  *    Define this macro to the type to use as the capacity counter. By default
  *    this uses @c size_t. However this may be inefficient as most uses won't
@@ -62,6 +96,17 @@
  *
  *************************************************************************/
 
+/** @brief Which checks are compiled in: 0 (none), 1 (cheap) or 2 (bounds)
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_CHECK_LEVEL
+# if defined(NDEBUG) && !defined(AB_VEC_ASSERT)
+#  define AB_VEC_CHECK_LEVEL 0
+# else
+#  define AB_VEC_CHECK_LEVEL 1
+# endif
+#endif /* AB_VEC_CHECK_LEVEL */
+
 #ifndef AB_VEC_ASSERT
 # include <assert.h>
 /** @brief Runtime assertion macro for the header
@@ -75,6 +120,38 @@
 # define AB_VEC_ASSERT(cond) assert(cond)
 #endif /* AB_VEC_ASSERT */
 
+/** @brief Tell the optimizer a condition without side effects holds
+ * @note This macro can be overidden
+ * @hideinitializer
+ */
+#ifndef AB_VEC_ASSUME
+# if AB_VEC_CHECK_LEVEL > 0
+#  define AB_VEC_ASSUME(cond) AB_VEC_ASSERT(cond)
+# elif defined(__clang__)
+#  define AB_VEC_ASSUME(cond) __builtin_assume(cond)
+# elif defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 5))
+#  define AB_VEC_ASSUME(cond) ((cond) ? (void)0 : __builtin_unreachable())
+# elif defined(_MSC_VER)
+#  define AB_VEC_ASSUME(cond) __assume(cond)
+# elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 202311L
+#  define AB_VEC_ASSUME(cond) ((cond) ? (void)0 : unreachable())
+# else
+#  define AB_VEC_ASSUME(cond) ((void)0)
+# endif
+#endif /* AB_VEC_ASSUME */
+
+/* Cheap argument checks and bounds checks, per AB_VEC_CHECK_LEVEL */
+#if AB_VEC_CHECK_LEVEL > 0
+# define AB_VEC_CHECK(cond) AB_VEC_ASSERT(cond)
+#else
+# define AB_VEC_CHECK(cond) ((void)0)
+#endif
+#if AB_VEC_CHECK_LEVEL > 1
+# define AB_VEC_CHECK_BOUNDS(cond) AB_VEC_ASSERT(cond)
+#else
+# define AB_VEC_CHECK_BOUNDS(cond) ((void)0)
+#endif
+
 /** @brief Decorator for functions that should be marked inline
  * @note This macro can be overidden
  */
@@ -92,6 +169,19 @@
 # include <stdlib.h>
 #endif /* !defined(AB_VEC_REALLOC) || !defined(AB_VEC_FREE) */
 
+/** @brief Zeroed memory allocation function for the header
+ * @note This macro can be overidden
+ * Large @c calloc requests are served from fresh @c mmap pages which the
+ * kernel already zeroed, so they are not touched until first use.
+ */
+#if !defined(AB_VEC_CALLOC) && !defined(AB_VEC_REALLOC)
+# ifndef AB_VEC_INCLUDE_USERDATA
+#  define AB_VEC_CALLOC(size) calloc(1, size)
+# else
+#  define AB_VEC_CALLOC(size, userdata) calloc(1, size)
+# endif
+#endif /* AB_VEC_CALLOC */
+
 /** @brief Memory allocation function for the header
  * @note This macro can be overidden
  */
@@ -114,6 +204,44 @@
 # endif
 #endif /* AB_VEC_FREE */
 
+/** @brief Operator giving the type of an expression, without evaluating it
+ * @note This macro can be overidden
+ */
+#if !defined(AB_VEC_TYPEOF) && !defined(AB_VEC_NO_TYPEOF) && defined(__STDC_VERSION__)
+# if __STDC_VERSION__ >= 202311L
+#  define AB_VEC_TYPEOF(expr) typeof(expr)
+# elif __STDC_VERSION__ >= 199901L && defined(__GNUC__)
+#  define AB_VEC_TYPEOF(expr) __typeof__(expr)
+# endif
+#endif /* AB_VEC_TYPEOF */
+#if defined(AB_VEC_NO_TYPEOF)
+# undef AB_VEC_TYPEOF
+#endif
+
+/** @brief Hint that a condition is usually true (or false)
+ * @note These macros can be overidden
+ */
+#ifndef AB_VEC_LIKELY
+# if defined(__GNUC__)
+#  define AB_VEC_LIKELY(cond) __builtin_expect(!!(cond), 1)
+#  define AB_VEC_UNLIKELY(cond) __builtin_expect(!!(cond), 0)
+# else
+#  define AB_VEC_LIKELY(cond) (cond)
+#  define AB_VEC_UNLIKELY(cond) (cond)
+# endif
+#endif /* AB_VEC_LIKELY */
+
+/** @brief Decorator for rarely taken functions that should stay out of line
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_COLD
+# if defined(__GNUC__)
+#  define AB_VEC_COLD __attribute__((noinline, cold, unused))
+# else
+#  define AB_VEC_COLD AB_VEC_INLINE
+# endif
+#endif /* AB_VEC_COLD */
+
 /** @brief Type of capacity storage
  * @note This macro can be overidden
  */
@@ -137,7 +265,14 @@
  *************************************************************************/
 
 /** @cond false */
-struct AB_vector_generic {
+/* Every AB_vec is accessed through this layout-compatible struct by the
+ * *_generic functions, so tell GCC not to assume the two types never alias */
+#if defined(__GNUC__)
+# define AB_VEC_MAY_ALIAS __attribute__((__may_alias__))
+#else
+# define AB_VEC_MAY_ALIAS
+#endif
+struct AB_VEC_MAY_ALIAS AB_vector_generic {
     AB_VEC_SIZE_T num, capacity;
     void *elems;
 #ifdef AB_VEC_INCLUDE_USERDATA
@@ -169,12 +304,12 @@ struct AB_vector_generic {
  */
 #ifdef AB_VEC_INCLUDE_USERDATA
 # define AB_vec_init(vec) do {                                                                     \
-    AB_VEC_ASSERT(vec != NULL); \
+    AB_VEC_CHECK(vec != NULL); \
     (vec)->num = (vec)->capacity = 0; (vec)->elems = NULL; (vec)->userdata = NULL;                 \
 } while (0)
 #else
 # define AB_vec_init(vec) do {                                                                     \
-    AB_VEC_ASSERT(vec != NULL); \
+    AB_VEC_CHECK(vec != NULL); \
     (vec)->num = (vec)->capacity = 0; (vec)->elems = NULL;                                         \
 } while (0)
 #endif
@@ -186,7 +321,7 @@ struct AB_vector_generic {
  * @note Only available when @c AB_VEC_INCLUDE_USERDATA is set
  * @hideinitializer
  */
-# define AB_vec_userdata(vec) (*(AB_VEC_ASSERT((vec) != NULL), &(vec)->userdata))
+# define AB_vec_userdata(vec) (*(AB_VEC_CHECK((vec) != NULL), &(vec)->userdata))
 #endif
 
 /** @brief Free memory associated with an AB_vec
@@ -195,24 +330,70 @@ struct AB_vector_generic {
  */
 #ifdef AB_VEC_INCLUDE_USERDATA
 # define AB_vec_destroy(vec)                                                                       \
-    (AB_VEC_ASSERT((vec) != NULL), \
+    (AB_VEC_CHECK((vec) != NULL), \
      AB_VEC_FREE((vec)->elems, \
          (vec)->capacity * sizeof(*(vec)->elems), (vec)->userdata))
 #else
 # define AB_vec_destroy(vec)                                                                       \
-    (AB_VEC_ASSERT((vec) != NULL), \
+    (AB_VEC_CHECK((vec) != NULL), \
      AB_VEC_FREE((vec)->elems, \
          (vec)->capacity * sizeof(*(vec)->elems)))
 #endif
 
+#ifdef AB_VEC_TYPEOF
+/* Single-evaluation helpers: the macros pass the vector once and use
+ * AB_VEC_TYPEOF and sizeof, which do not evaluate their operand, to get
+ * the element type back */
+static AB_VEC_INLINE void *
+AB_vec_at_generic(const struct AB_vector_generic *vec, size_t idx, size_t elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    AB_VEC_CHECK_BOUNDS(idx < vec->num);
+    AB_VEC_ASSUME(vec->num <= vec->capacity);
+    return (char *)vec->elems + elem_size * idx;
+}
+
+static AB_VEC_INLINE void *
+AB_vec_pop_generic(struct AB_vector_generic *vec, size_t elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    AB_VEC_CHECK(vec->num > 0);
+    return (char *)vec->elems + elem_size * --vec->num;
+}
+
+static AB_VEC_INLINE AB_VEC_SIZE_T
+AB_vec_size_generic(const struct AB_vector_generic *vec)
+{
+    AB_VEC_CHECK(vec != NULL);
+    AB_VEC_ASSUME(vec->num <= vec->capacity);
+    return vec->num;
+}
+
+static AB_VEC_INLINE AB_VEC_SIZE_T
+AB_vec_max_generic(const struct AB_vector_generic *vec)
+{
+    AB_VEC_CHECK(vec != NULL);
+    AB_VEC_ASSUME(vec->num <= vec->capacity);
+    return vec->capacity;
+}
+#endif /* AB_VEC_TYPEOF */
+
 /** @brief Access an element at a given index
  * @param vec Pointer to the AB_vec
  * @param idx Index to access
  * @return The element at that index (as an lvalue, ie. can take address)
- * @note @c idx must be a valid index
+ * @note @c idx must be a valid index, which is checked when
+ *  @c AB_VEC_CHECK_LEVEL is 2
  */
-#define AB_vec_at(vec, idx)                                                                        \
-    (*(AB_VEC_ASSERT((vec) != NULL), &(vec)->elems[idx]))
+#ifdef AB_VEC_TYPEOF
+# define AB_vec_at(vec, idx)                                                                       \
+    (*(AB_VEC_TYPEOF((vec)->elems))AB_vec_at_generic(                                              \
+        (const struct AB_vector_generic *)(vec), (idx), sizeof(*(vec)->elems)))
+#else
+# define AB_vec_at(vec, idx)                                                                       \
+    (*(AB_VEC_CHECK((vec) != NULL), AB_VEC_CHECK_BOUNDS((size_t)(idx) < (vec)->num),               \
+       &(vec)->elems[idx]))
+#endif
 
 /** @brief Remove the last element of the vector, returning the value
  * @param vec Pointer to the AB_vec
@@ -220,29 +401,50 @@ struct AB_vector_generic {
  * @note The vector must be non-empty
  * @hideinitializer
  */
-#define AB_vec_pop(vec)                                                                            \
-    (AB_VEC_ASSERT((vec)->num > 0), (vec)->elems[--(vec)->num])
+#if defined(AB_VEC_TYPEOF) && defined(__GNUC__)
+/* The statement expression keeps GCC quiet when the value is discarded */
+# define AB_vec_pop(vec)                                                                           \
+    __extension__ ({ *(AB_VEC_TYPEOF((vec)->elems))AB_vec_pop_generic(                             \
+        (struct AB_vector_generic *)(vec), sizeof(*(vec)->elems)); })
+#elif defined(AB_VEC_TYPEOF)
+# define AB_vec_pop(vec)                                                                           \
+    (*(AB_VEC_TYPEOF((vec)->elems))AB_vec_pop_generic(                                             \
+        (struct AB_vector_generic *)(vec), sizeof(*(vec)->elems)))
+#else
+# define AB_vec_pop(vec)                                                                           \
+    (AB_VEC_CHECK((vec)->num > 0), (vec)->elems[--(vec)->num])
+#endif
 
 /** @brief Query the number of elements in the vector
  * @param vec Pointer to the AB_vec
  * @return The number of elements
  */
-#define AB_vec_size(vec)                                                                           \
-    (AB_VEC_ASSERT((vec) != NULL), (const AB_VEC_SIZE_T)(vec)->num)
+#ifdef AB_VEC_TYPEOF
+# define AB_vec_size(vec)                                                                          \
+    AB_vec_size_generic((const struct AB_vector_generic *)(vec))
+#else
+# define AB_vec_size(vec)                                                                          \
+    (AB_VEC_CHECK((vec) != NULL), (const AB_VEC_SIZE_T)(vec)->num)
+#endif
 
 /** @brief Query the current capacity of the vector
  * @param vec Pointer to the AB_vec
  * @return The current number of possible elements storable before @c realloc
  */
-#define AB_vec_max(vec)                                                                            \
-    (AB_VEC_ASSERT((vec) != NULL), (const AB_VEC_SIZE_T)(vec)->capacity)
+#ifdef AB_VEC_TYPEOF
+# define AB_vec_max(vec)                                                                           \
+    AB_vec_max_generic((const struct AB_vector_generic *)(vec))
+#else
+# define AB_vec_max(vec)                                                                           \
+    (AB_VEC_CHECK((vec) != NULL), (const AB_VEC_SIZE_T)(vec)->capacity)
+#endif
 
 static AB_VEC_INLINE int
 AB_vec_resize_generic(struct AB_vector_generic *vec, 
         AB_VEC_SIZE_T new_size, AB_VEC_SIZE_T elem_size)
 {
     void *new_elems;
-    AB_VEC_ASSERT(vec != NULL);
+    AB_VEC_CHECK(vec != NULL);
 #ifdef AB_VEC_INCLUDE_USERDATA
     new_elems = AB_VEC_REALLOC(vec->elems,
             elem_size * vec->capacity, elem_size * new_size, vec->userdata);
@@ -267,12 +469,31 @@ AB_vec_resize_generic(struct AB_vector_generic *vec,
 #define AB_vec_resize(vec, newsize)                                                                \
     AB_vec_resize_generic((struct AB_vector_generic *)(vec), newsize, sizeof(*(vec)->elems))
 
+static AB_VEC_INLINE int
+AB_vec_reserve_generic(struct AB_vector_generic *vec,
+        AB_VEC_SIZE_T min_size, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    if (vec->capacity >= min_size)
+        return 0;
+    return AB_vec_resize_generic(vec, min_size, elem_size);
+}
+/** @brief Make sure a vector can hold at least a number of elements
+ * @param vec Pointer to an AB_vec
+ * @param minsize The minimum capacity
+ * @return 0 on success, nonzero on error
+ * @note The capacity is never shrunk
+ * @hideinitializer
+ */
+#define AB_vec_reserve(vec, minsize)                                                               \
+    AB_vec_reserve_generic((struct AB_vector_generic *)(vec), minsize, sizeof(*(vec)->elems))
+
 static AB_VEC_INLINE int
 AB_vec_copy_generic(struct AB_vector_generic *dest,
         const struct AB_vector_generic *src, AB_VEC_SIZE_T entry_size)
 {
-    AB_VEC_ASSERT(src != NULL);
-    AB_VEC_ASSERT(dest != NULL);
+    AB_VEC_CHECK(src != NULL);
+    AB_VEC_CHECK(dest != NULL);
     if (dest->capacity < src->capacity) {
         int err = AB_vec_resize_generic(dest, src->capacity, entry_size);
         AB_VEC_ASSERT(!err);
@@ -280,7 +501,8 @@ AB_vec_copy_generic(struct AB_vector_generic *dest,
             return 1;
     }
     dest->num = src->num;
-    memcpy(dest->elems, src->elems, entry_size * src->capacity);
+    if (src->capacity > 0)
+        memcpy(dest->elems, src->elems, entry_size * src->capacity);
     return 0;
 }
 /** @brief Copy a vector from src to dest
@@ -295,45 +517,422 @@ AB_vec_copy_generic(struct AB_vector_generic *dest,
     AB_vec_copy_generic((struct AB_vector_generic *)(dest),                                        \
             (const struct AB_vector_generic *)(src), sizeof(*(dest)->elems))
 
+/* Replicate the first of num elements across all of them */
+static AB_VEC_INLINE void
+AB_vec_fill_generic(void *ptr, size_t num, size_t elem_size)
+{
+    char *elems = (char *)ptr;
+    size_t i, filled = elem_size, total = num * elem_size;
+
+    for (i = 1; i < elem_size && elems[i] == elems[0]; i++)
+        ;
+    if (i == elem_size) {
+        memset(elems + filled, elems[0], total - filled);
+        return;
+    }
+    while (filled < total) {
+        size_t chunk = filled < total - filled ? filled : total - filled;
+        memcpy(elems + filled, elems, chunk);
+        filled += chunk;
+    }
+}
+/** @brief Set every element of the vector to a value
+ * @param vec Pointer to the AB_vec
+ * @param value The value to store in indexes [0, size)
+ * @note Values whose bytes are all equal (like 0) use @c memset, others are
+ *  replicated with doubling @c memcpy calls
+ * @hideinitializer
+ */
+#define AB_vec_fill(vec, value)                                                                    \
+    ((void)(AB_VEC_CHECK((vec) != NULL), (vec)->num == 0 ? 0 :                                    \
+        ((vec)->elems[0] = (value),                                                                \
+         AB_vec_fill_generic((vec)->elems, (vec)->num, sizeof(*(vec)->elems)), 0)))
+
+/* Default roundup implementation */
+static AB_VEC_INLINE AB_VEC_SIZE_T AB_vec_roundup_size_t(AB_VEC_SIZE_T x)
+{
+    AB_VEC_SIZE_T y = 1;
+    if (x == 0)
+        return 0;
+    while (y <= x)
+        y += y;
+    return y;
+}
+
+/* Capacity to grow to for n elements, rounded up with
+ * AB_VEC_SIZE_T_ROUNDUP like AB_vec_insert() does, so that growing a
+ * vector by a few elements per call stays amortized */
+static AB_VEC_INLINE AB_VEC_SIZE_T
+AB_vec_growth_capacity(AB_VEC_SIZE_T n)
+{
+    AB_VEC_SIZE_T cap = AB_VEC_SIZE_T_ROUNDUP(n);
+    /* The roundup wraps to 0 past the largest power of two */
+    return cap < n ? n : cap;
+}
+
+/* Make room for n elements */
+static AB_VEC_INLINE int
+AB_vec_resize_fill_reserve_generic(struct AB_vector_generic *vec,
+        AB_VEC_SIZE_T n, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    if (n <= vec->capacity)
+        return 0;
+    return AB_vec_resize_generic(vec, AB_vec_growth_capacity(n), elem_size);
+}
+
+/* Replicate the value stored at index num over [num, n) and set the size */
+static AB_VEC_INLINE int
+AB_vec_resize_fill_finish_generic(struct AB_vector_generic *vec,
+        AB_VEC_SIZE_T n, AB_VEC_SIZE_T elem_size)
+{
+    if (n > vec->num)
+        AB_vec_fill_generic((char *)vec->elems + elem_size * vec->num, n - vec->num, elem_size);
+    vec->num = n;
+    return 0;
+}
+
+#ifdef AB_VEC_TYPEOF
+static AB_VEC_INLINE int
+AB_vec_resize_fill_generic(struct AB_vector_generic *vec,
+        AB_VEC_SIZE_T n, const void *value, AB_VEC_SIZE_T elem_size)
+{
+    if (AB_vec_resize_fill_reserve_generic(vec, n, elem_size))
+        return 1;
+    if (n > vec->num)
+        memcpy((char *)vec->elems + elem_size * vec->num, value, elem_size);
+    return AB_vec_resize_fill_finish_generic(vec, n, elem_size);
+}
+#endif /* AB_VEC_TYPEOF */
+
+/** @brief Change the size of a vector, copying a value into new elements
+ * @param vec Pointer to the AB_vec
+ * @param n The new number of elements
+ * @param value The value to store in indexes [size, n)
+ * @return 0 on success, nonzero on error
+ * @note Unlike @c AB_vec_resize(), this sets the size rather than the capacity.
+ *  When the capacity has to grow, it is rounded up with
+ *  @c AB_VEC_SIZE_T_ROUNDUP, so calls that add a few elements at a time
+ *  reallocate a logarithmic number of times. It is never shrunk.
+ * @note With @c AB_VEC_TYPEOF, every argument is evaluated once. Otherwise
+ *  @c vec is evaluated several times and @c n twice.
+ * @hideinitializer
+ */
+#ifdef AB_VEC_TYPEOF
+# define AB_vec_resize_fill(vec, n, value)                                                         \
+    AB_vec_resize_fill_generic((struct AB_vector_generic *)(vec), (n),                             \
+        (AB_VEC_TYPEOF(*(vec)->elems)[1]){ (value) }, sizeof(*(vec)->elems))
+#else
+/* The value goes to index num, which exists whenever elements are added */
+# define AB_vec_resize_fill(vec, n, value)                                                         \
+    (AB_vec_resize_fill_reserve_generic((struct AB_vector_generic *)(vec), (n),                    \
+        sizeof(*(vec)->elems)) != 0 ? 1                                                            \
+     : ((vec)->num < (vec)->capacity ? (void)((vec)->elems[(vec)->num] = (value)) : (void)0,      \
+        AB_vec_resize_fill_finish_generic((struct AB_vector_generic *)(vec), (n),                  \
+            sizeof(*(vec)->elems))))
+#endif
+
+static AB_VEC_INLINE int
+AB_vec_resize_zero_generic(struct AB_vector_generic *vec,
+        AB_VEC_SIZE_T n, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+#ifdef AB_VEC_CALLOC
+    if (n > vec->capacity && vec->num == 0) {
+        /* Nothing to preserve, so skip realloc + memset and take memory
+         * the allocator already knows is zero */
+        AB_VEC_SIZE_T cap = AB_vec_growth_capacity(n);
+        void *new_elems;
+# ifdef AB_VEC_INCLUDE_USERDATA
+        AB_VEC_FREE(vec->elems, elem_size * vec->capacity, vec->userdata);
+        new_elems = AB_VEC_CALLOC(elem_size * cap, vec->userdata);
+# else
+        AB_VEC_FREE(vec->elems, elem_size * vec->capacity);
+        new_elems = AB_VEC_CALLOC(elem_size * cap);
+# endif
+        vec->elems = new_elems;
+        vec->capacity = new_elems != NULL ? cap : 0;
+        AB_VEC_ASSERT(new_elems != NULL);
+        if (new_elems == NULL)
+            return 1;
+        vec->num = n;
+        return 0;
+    }
+#endif
+    if (AB_vec_resize_fill_reserve_generic(vec, n, elem_size))
+        return 1;
+    if (n > vec->num)
+        memset((char *)vec->elems + elem_size * vec->num, 0, elem_size * (n - vec->num));
+    vec->num = n;
+    return 0;
+}
+/** @brief Change the size of a vector, zeroing new elements
+ * @param vec Pointer to the AB_vec
+ * @param n The new number of elements
+ * @return 0 on success, nonzero on error
+ * @note When the capacity has to grow, it is rounded up with
+ *  @c AB_VEC_SIZE_T_ROUNDUP, as in @c AB_vec_resize_fill(). When an empty
+ *  vector has to grow, the buffer is replaced by one from
+ *  @c AB_VEC_CALLOC, so huge vectors are not faulted in eagerly
+ * @hideinitializer
+ */
+#define AB_vec_resize_zero(vec, n)                                                                 \
+    AB_vec_resize_zero_generic((struct AB_vector_generic *)(vec), (n), sizeof(*(vec)->elems))
+
+/* Slow path of the push macros: one out-of-line copy per translation
+ * unit instead of a realloc call inlined at every push site */
+static AB_VEC_COLD int
+AB_vec_grow_generic(struct AB_vector_generic *vec, AB_VEC_SIZE_T elem_size)
+{
+    return AB_vec_resize_generic(vec, vec->capacity ? vec->capacity << 1 : 2, elem_size);
+}
+
+#ifdef AB_VEC_TYPEOF
+static AB_VEC_INLINE void *
+AB_vec_pushp_generic(struct AB_vector_generic *vec, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    AB_VEC_ASSUME(vec->num <= vec->capacity);
+    if (AB_VEC_UNLIKELY(vec->num == vec->capacity) && AB_vec_grow_generic(vec, elem_size))
+        return NULL;
+    return (char *)vec->elems + elem_size * vec->num++;
+}
+
+static AB_VEC_INLINE int
+AB_vec_push_generic(struct AB_vector_generic *vec, const void *elem, AB_VEC_SIZE_T elem_size)
+{
+    void *slot = AB_vec_pushp_generic(vec, elem_size);
+    if (AB_VEC_UNLIKELY(slot == NULL))
+        return 1;
+    memcpy(slot, elem, elem_size);
+    return 0;
+}
+#endif /* AB_VEC_TYPEOF */
+
 /** @brief Add an element to the end of the vector
  * @param vec Pointer to the AB_vec
  * @param elem The element to insert
  * @return 0 on success, nonzero on error
  * @note Capacity is increased using a left bitshift,
  * so overflow can cause problems.
+ * @note With @c AB_VEC_TYPEOF, @c elem is evaluated before the vector grows;
+ *  otherwise it is evaluated after
  * @hideinitializer
  */
-#define AB_vec_push(vec, elem)                                                                     \
-    (AB_VEC_ASSERT((vec) != NULL), \
-     (vec)->num == (vec)->capacity ?                                                               \
-         (AB_vec_resize((vec), (vec)->capacity ? (vec)->capacity << 1 : 2) == 0 ?                  \
-              ((vec)->elems[(vec)->num++] = (elem), 0)                                             \
-              : 1)                                                                                 \
+#ifdef AB_VEC_TYPEOF
+/* The element goes through a one-element array compound literal, which
+ * also accepts a struct value as its initializer */
+# define AB_vec_push(vec, elem)                                                                    \
+    AB_vec_push_generic((struct AB_vector_generic *)(vec),                                         \
+        (AB_VEC_TYPEOF(*(vec)->elems)[1]){ (elem) }, sizeof(*(vec)->elems))
+#else
+# define AB_vec_push(vec, elem)                                                                    \
+    (AB_VEC_CHECK((vec) != NULL), \
+     AB_VEC_UNLIKELY((vec)->num == (vec)->capacity)                                                \
+         && AB_vec_grow_generic((struct AB_vector_generic *)(vec), sizeof(*(vec)->elems)) != 0 ?   \
+         1                                                                                         \
          : ((vec)->elems[(vec)->num++] = (elem), 0))
+#endif
 
 /** @brief Add an element to the end of the vector, returning a pointer to that spot
  * @param vec Pointer to the AB_vec
  * @return Pointer to the pushed element, or NULL on error
  * @hideinitializer
  */
-#define AB_vec_pushp(vec)                                                                          \
-    (AB_VEC_ASSERT((vec) != NULL), \
-     (vec)->num == (vec)->capacity ?                                                               \
-         (AB_vec_resize((vec), (vec)->capacity ? (vec)->capacity << 1 : 2) == 0 ?                  \
-              &(vec)->elems[(vec)->num++]                                                          \
-              : NULL)                                                                              \
+#ifdef AB_VEC_TYPEOF
+# define AB_vec_pushp(vec)                                                                         \
+    ((AB_VEC_TYPEOF((vec)->elems))AB_vec_pushp_generic(                                            \
+        (struct AB_vector_generic *)(vec), sizeof(*(vec)->elems)))
+#else
+# define AB_vec_pushp(vec)                                                                         \
+    (AB_VEC_CHECK((vec) != NULL), \
+     AB_VEC_UNLIKELY((vec)->num == (vec)->capacity)                                                \
+         && AB_vec_grow_generic((struct AB_vector_generic *)(vec), sizeof(*(vec)->elems)) != 0 ?   \
+         NULL                                                                                      \
          : &(vec)->elems[(vec)->num++])
+#endif
 
-/* Default roundup implementation */
-static AB_VEC_INLINE AB_VEC_SIZE_T AB_vec_roundup_size_t(AB_VEC_SIZE_T x)
+/** @brief Cursor for appending many elements to an AB_vec
+ * @param type The element type, matching the vector's
+ *
+ * A writer keeps a write pointer and the end of the reserved space, so each
+ * push is a store and a pointer bump behind one well-predicted branch. The
+ * vector's size is only brought up to date when the reserved space runs out
+ * and by @c AB_vec_writer_close(). While a writer is open, the vector must
+ * not be used through any other macro.
+ */
+#define AB_vec_writer(type)                                                                        \
+    struct { type *cur, *end; struct AB_vector_generic *vec; }
+
+/* The typed cursor is only ever read and written by the macros below:
+ * accessing it through a generic struct instead would let the optimizer
+ * keep a stale copy under strict aliasing */
+static AB_VEC_INLINE void
+AB_vec_writer_commit_generic(struct AB_vector_generic *vec, const void *cur,
+        AB_VEC_SIZE_T elem_size)
 {
-    AB_VEC_SIZE_T y = 1;
-    if (x == 0)
+    AB_VEC_CHECK(vec != NULL);
+    if (cur != NULL)
+        vec->num = (AB_VEC_SIZE_T)(((const char *)cur - (const char *)vec->elems) / elem_size);
+}
+
+static AB_VEC_INLINE int
+AB_vec_writer_grow_generic(struct AB_vector_generic *vec, const void *cur,
+        AB_VEC_SIZE_T n, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_SIZE_T cap = vec->capacity ? vec->capacity << 1 : 2;
+    AB_vec_writer_commit_generic(vec, cur, elem_size);
+    if (cap < vec->num + n)
+        cap = vec->num + n;
+    if (vec->capacity < vec->num + n && AB_vec_resize_generic(vec, cap, elem_size))
+        return 1;
+    return 0;
+}
+
+/** @cond false */
+/* Commit, make room for n more elements and point the cursor at it */
+#define AB_vec_writer_refill_(w, n)                                                                \
+    (AB_vec_writer_grow_generic((w)->vec, (w)->cur, (n), sizeof(*(w)->cur)) != 0 ? 1               \
+     : ((w)->cur = (void *)((char *)(w)->vec->elems + sizeof(*(w)->cur) * (w)->vec->num),          \
+        (w)->end = (void *)((char *)(w)->vec->elems + sizeof(*(w)->cur) * (w)->vec->capacity),     \
+        0))
+/** @endcond */
+
+/** @brief Start appending to a vector
+ * @param w Pointer to an AB_vec_writer of the vector's element type
+ * @param vector Pointer to the AB_vec to append to
+ * @param n Number of elements to reserve room for up front, may be 0
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#define AB_vec_writer_open(w, vector, n)                                                           \
+    (AB_VEC_CHECK((w) != NULL && (vector) != NULL),                                                \
+     AB_VEC_CHECK(sizeof(*(w)->cur) == sizeof(*(vector)->elems)),                                  \
+     (w)->vec = (struct AB_vector_generic *)(vector), (w)->cur = (w)->end = NULL,                  \
+     AB_vec_writer_refill_((w), (n)))
+
+/** @brief Add an element through a writer
+ * @param w Pointer to an open AB_vec_writer
+ * @param elem The element to append
+ * @return 0 on success, nonzero on error
+ * @note When the reserved space runs out, the capacity is doubled like
+ *  @c AB_vec_push() does
+ * @hideinitializer
+ */
+#define AB_vec_writer_push(w, elem)                                                                \
+    (AB_VEC_LIKELY((w)->cur != (w)->end) || AB_vec_writer_refill_((w), 1) == 0 ?                   \
+         (*(w)->cur++ = (elem), 0)                                                                 \
+         : 1)
+
+/** @brief Add an element through a writer, returning a pointer to that spot
+ * @param w Pointer to an open AB_vec_writer
+ * @return Pointer to the new element, or NULL on error
+ * @hideinitializer
+ */
+#define AB_vec_writer_pushp(w)                                                                     \
+    (AB_VEC_LIKELY((w)->cur != (w)->end) || AB_vec_writer_refill_((w), 1) == 0 ?                   \
+         (w)->cur++                                                                                \
+         : NULL)
+
+/** @brief Make room for at least @c n more elements without further checks
+ * @param w Pointer to an open AB_vec_writer
+ * @param n Number of elements
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#define AB_vec_writer_reserve(w, n)                                                                \
+    ((AB_VEC_SIZE_T)((w)->end - (w)->cur) >= (AB_VEC_SIZE_T)(n) ? 0                                \
+         : AB_vec_writer_refill_((w), (n)))
+
+/** @brief Store the number of written elements back into the vector
+ * @param w Pointer to an open AB_vec_writer
+ * @note The writer stays usable; this is only needed to read the vector
+ *  before @c AB_vec_writer_close()
+ * @hideinitializer
+ */
+#define AB_vec_writer_commit(w)                                                                    \
+    AB_vec_writer_commit_generic((w)->vec, (w)->cur, sizeof(*(w)->cur))
+
+/** @brief Finish appending, updating the vector's size
+ * @param w Pointer to an open AB_vec_writer
+ * @note The writer must be reopened before it is used again
+ * @hideinitializer
+ */
+#define AB_vec_writer_close(w)                                                                     \
+    (AB_vec_writer_commit(w), (w)->cur = (w)->end = NULL, (void)0)
+
+static AB_VEC_INLINE int
+AB_vec_equal_generic(const struct AB_vector_generic *a,
+        const struct AB_vector_generic *b, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_CHECK(a != NULL);
+    AB_VEC_CHECK(b != NULL);
+    if (a->num != b->num)
         return 0;
-    while (y <= x)
-        y += y;
-    return y;
+    return a->num == 0 || memcmp(a->elems, b->elems, (size_t)elem_size * a->num) == 0;
+}
+/** @brief Check whether two vectors hold the same elements
+ * @param a Const pointer to an AB_vec
+ * @param b Const pointer to an AB_vec
+ * @return Nonzero if the sizes and the bytes of all elements match
+ * @note Elements are compared with @c memcmp, so they must not contain
+ *  padding or values with several representations (like floating point
+ *  @c -0.0 and @c 0.0)
+ * @hideinitializer
+ */
+#define AB_vec_equal(a, b)                                                                         \
+    AB_vec_equal_generic((const struct AB_vector_generic *)(a),                                    \
+            (const struct AB_vector_generic *)(b), sizeof(*(a)->elems))
+
+static AB_VEC_INLINE int
+AB_vec_compare_generic(const struct AB_vector_generic *a,
+        const struct AB_vector_generic *b, AB_VEC_SIZE_T elem_size,
+        int (*cmp)(const void *, const void *))
+{
+    AB_VEC_SIZE_T i, n;
+    AB_VEC_CHECK(a != NULL);
+    AB_VEC_CHECK(b != NULL);
+    n = a->num < b->num ? a->num : b->num;
+    if (cmp == NULL) {
+        int r = n == 0 ? 0 : memcmp(a->elems, b->elems, (size_t)elem_size * n);
+        if (r != 0)
+            return r < 0 ? -1 : 1;
+    } else {
+        for (i = 0; i < n; i++) {
+            int r = cmp((const char *)a->elems + (size_t)elem_size * i,
+                    (const char *)b->elems + (size_t)elem_size * i);
+            if (r != 0)
+                return r;
+        }
+    }
+    return a->num < b->num ? -1 : a->num > b->num;
 }
+/** @brief Lexicographically compare two vectors of bytes
+ * @param a Const pointer to an AB_vec of single-byte elements
+ * @param b Const pointer to an AB_vec of single-byte elements
+ * @return Negative, zero or positive if @c a is less than, equal to or
+ *  greater than @c b, comparing elements as unsigned char. A proper prefix
+ *  compares less.
+ * @note Byte order does not match numeric order for wider elements, so
+ *  they fail to compile here; use @c AB_vec_compare_with() for them
+ * @hideinitializer
+ */
+#define AB_vec_compare(a, b)                                                                       \
+    AB_vec_compare_generic((const struct AB_vector_generic *)(a),                                  \
+            (const struct AB_vector_generic *)(b),                                                 \
+            sizeof(char[sizeof(*(a)->elems) == 1 && sizeof(*(b)->elems) == 1 ? 1 : -1]), NULL)
+
+/** @brief Lexicographically compare two vectors with an element comparator
+ * @param a Const pointer to an AB_vec
+ * @param b Const pointer to an AB_vec
+ * @param cmp A @c qsort style comparison function on element pointers
+ * @return Negative, zero or positive if @c a is less than, equal to or
+ *  greater than @c b. A proper prefix compares less.
+ * @hideinitializer
+ */
+#define AB_vec_compare_with(a, b, cmp)                                                             \
+    AB_vec_compare_generic((const struct AB_vector_generic *)(a),                                  \
+            (const struct AB_vector_generic *)(b), sizeof(*(a)->elems), (cmp))
 
 static AB_VEC_INLINE int AB_vec_insert_generic(struct AB_vector_generic *vec,
         AB_VEC_SIZE_T idx, AB_VEC_SIZE_T elem_size)
@@ -348,18 +947,38 @@ static AB_VEC_INLINE int AB_vec_insert_generic(struct AB_vector_generic *vec,
     }
     return 0;
 }
+#ifdef AB_VEC_TYPEOF
+static AB_VEC_INLINE int
+AB_vec_insert_value_generic(struct AB_vector_generic *vec,
+        AB_VEC_SIZE_T idx, const void *elem, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    if (AB_vec_insert_generic(vec, idx, elem_size))
+        return 1;
+    memcpy((char *)vec->elems + elem_size * idx, elem, elem_size);
+    return 0;
+}
+#endif /* AB_VEC_TYPEOF */
+
 /** @brief Insert an element at an arbitrary index
  * @param vec Pointer to an AB_vec
  * @param idx index to insert the element, not necessarily an allocated one
  * @param elem the element to insert
  * @return 0 on success, nonzero on error
  * @note If this function expands the vector, skipped indexes are uninitialized
- *  (depending on the @c realloc function)
+ *  (depending on the @c realloc function). Use @c AB_vec_resize_zero() or
+ *  @c AB_vec_resize_fill() first if they need a value.
  * @hideinitializer
  */
-#define AB_vec_insert(vec, idx, elem)                                                              \
+#ifdef AB_VEC_TYPEOF
+# define AB_vec_insert(vec, idx, elem)                                                             \
+    AB_vec_insert_value_generic((struct AB_vector_generic *)(vec), (idx),                          \
+        (AB_VEC_TYPEOF(*(vec)->elems)[1]){ (elem) }, sizeof(*(vec)->elems))
+#else
+# define AB_vec_insert(vec, idx, elem)                                                             \
     (AB_vec_insert_generic((struct AB_vector_generic *)(vec), (idx), sizeof(*(vec)->elems)) == 0 ? \
-        (vec)->elems[(idx)] = (elem)                                                               \
+        ((vec)->elems[(idx)] = (elem), 0)                                                          \
         : 1)
+#endif
 
 #endif /* AMBER_UTIL_VECTOR_H */
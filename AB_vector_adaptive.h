@@ -0,0 +1,194 @@
+/** @file AB_vector_adaptive.h
+ * @brief Initial capacities learned per push call site
+ *
+ * A vector starts empty and doubles from 2, so one that ends up holding
+ * 500 elements is reallocated 8 times, even when every vector filled at
+ * that line of code ends up about as large. When @c AB_VEC_ADAPTIVE is
+ * defined, this header redefines @c AB_vec_push() and @c AB_vec_pushp()
+ * so that each expansion owns a static @c AB_vec_site, and
+ * @c AB_vec_destroy() so that it reports the final size of the vector to
+ * the site that first grew it. The first growth at a site then jumps
+ * straight to the size learned there; later growths double as usual.
+ * Without @c AB_VEC_ADAPTIVE the macros are left alone.
+ *
+ * A site keeps a moving average of the final sizes and of their deviation
+ * from it, as TCP keeps its round-trip time (Jacobson, 1988), and learns
+ * the mean plus twice the deviation, so most vectors fit without a second
+ * reallocation. Each sample moves the mean by 1/8 and the deviation by
+ * 1/4. The learned size is capped by @c AB_VEC_ADAPTIVE_MAX bytes.
+ *
+ * Vectors carry no extra field. Instead, the first growth records the
+ * vector's address and site in a small table of the calling thread, which
+ * @c AB_vec_destroy() looks up. A vector destroyed on another thread, or
+ * whose table entry was taken by a newer vector, is not counted; this
+ * loses samples but not correctness. Sites are shared between threads and
+ * updated with relaxed loads and stores, so concurrent samples may
+ * overwrite each other.
+ *
+ * The instrumented macros evaluate each argument once, and the element
+ * before the vector grows, like those of AB_vector.h with
+ * @c AB_VEC_TYPEOF.
+ *
+ * Macro-options (besides those of AB_vector.h):
+ *  - AB_VEC_ADAPTIVE
+ *    Define this macro to learn initial capacities.
+ *
+ *  - AB_VEC_ADAPTIVE_MAX
+ *    Largest learned initial capacity, in bytes. Defaults to 1 MiB; past
+ *    that the doublings are cheap next to filling the vector.
+ *
+ * This header requires GNU C statement expressions, @c __typeof__, the
+ * @c __atomic builtins and @c __thread, and a target with weak symbols
+ * (ELF or Mach-O).
+ */
+#ifndef AMBER_UTIL_VECTOR_ADAPTIVE_H
+#define AMBER_UTIL_VECTOR_ADAPTIVE_H
+
+#include "AB_vector.h"
+#include <stdint.h>
+
+#if !defined(__GNUC__) && !defined(__DOXYGEN__)
+# error "AB_vector_adaptive.h requires GNU C statement expressions"
+#endif
+
+/** @brief Largest learned initial capacity, in bytes
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_ADAPTIVE_MAX
+# define AB_VEC_ADAPTIVE_MAX ((size_t)1 << 20)
+#endif /* AB_VEC_ADAPTIVE_MAX */
+
+/** @brief What one push call site has learned; zero-initialize */
+typedef struct AB_vec_site {
+    /** @cond false */
+    size_t mean8, dev4;
+    /** @endcond */
+} AB_vec_site;
+
+/** @cond false */
+#define AB_VEC_ADAPTIVE_SLOTS 1024
+
+typedef struct AB_vec_adaptive_slot {
+    const void *vec;
+    AB_vec_site *site;
+} AB_vec_adaptive_slot;
+
+__attribute__((weak)) __thread AB_vec_adaptive_slot AB_vec_adaptive_table[AB_VEC_ADAPTIVE_SLOTS];
+
+static AB_VEC_INLINE AB_vec_adaptive_slot *
+AB_vec_adaptive_slot_of(const void *vec)
+{
+    return &AB_vec_adaptive_table[(uint32_t)((uintptr_t)vec * 0x9e3779b97f4a7c15ull >> 54)];
+}
+/** @endcond */
+
+/** @brief Initial capacity learned at a site
+ * @param site Const pointer to an AB_vec_site
+ * @param elem_size Size of the elements of the site's vectors
+ * @return The number of elements the first growth allocates, at least 2
+ */
+static AB_VEC_INLINE size_t
+AB_vec_site_capacity(const AB_vec_site *site, size_t elem_size)
+{
+    size_t n = __atomic_load_n(&site->mean8, __ATOMIC_RELAXED) / 8
+        + __atomic_load_n(&site->dev4, __ATOMIC_RELAXED) / 2;
+    if (n > AB_VEC_ADAPTIVE_MAX / elem_size)
+        n = AB_VEC_ADAPTIVE_MAX / elem_size;
+    return n < 2 ? 2 : n;
+}
+
+/** @brief Count the final size of one vector at a site
+ * @param site Pointer to an AB_vec_site
+ * @param num Number of elements the vector held when it was destroyed
+ * @note @c AB_vec_destroy() calls this; it is public so that callers can
+ *  feed sizes they know from elsewhere
+ */
+static AB_VEC_INLINE void
+AB_vec_site_sample(AB_vec_site *site, size_t num)
+{
+    size_t mean8 = __atomic_load_n(&site->mean8, __ATOMIC_RELAXED);
+    size_t dev4 = __atomic_load_n(&site->dev4, __ATOMIC_RELAXED);
+    size_t mean = mean8 / 8, err = num > mean ? num - mean : mean - num;
+    /* The first sample sets the mean instead of moving it from 0 */
+    if (mean8 == 0) {
+        mean8 = num * 8;
+    } else {
+        mean8 = mean8 - mean8 / 8 + num;
+        dev4 = dev4 - dev4 / 4 + err;
+    }
+    __atomic_store_n(&site->mean8, mean8, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->dev4, dev4, __ATOMIC_RELAXED);
+}
+
+/** @cond false */
+static AB_VEC_COLD int
+AB_vec_adaptive_grow(struct AB_vector_generic *vec, AB_VEC_SIZE_T elem_size, AB_vec_site *site)
+{
+    AB_vec_adaptive_slot *s;
+    AB_VEC_CHECK(vec != NULL);
+    if (vec->capacity != 0)
+        return AB_vec_grow_generic(vec, elem_size);
+    if (AB_vec_resize_generic(vec, (AB_VEC_SIZE_T)AB_vec_site_capacity(site, elem_size),
+                elem_size))
+        return 1;
+    s = AB_vec_adaptive_slot_of(vec);
+    s->vec = vec;
+    s->site = site;
+    return 0;
+}
+
+static AB_VEC_INLINE void
+AB_vec_adaptive_destroy(const void *vec, size_t num)
+{
+    AB_vec_adaptive_slot *s = AB_vec_adaptive_slot_of(vec);
+    if (s->vec == vec) {
+        AB_vec_site_sample(s->site, num);
+        s->vec = NULL;
+    }
+}
+/** @endcond */
+
+#if defined(AB_VEC_ADAPTIVE)
+# undef AB_vec_push
+# undef AB_vec_pushp
+# undef AB_vec_destroy
+
+# define AB_vec_push(vec, elem) __extension__ ({                                                   \
+    static AB_vec_site AB_vec_site_;                                                               \
+    __typeof__(vec) AB_vec_v_ = (vec);                                                             \
+    __typeof__(*AB_vec_v_->elems) AB_vec_e_ = (elem);                                              \
+    AB_VEC_CHECK(AB_vec_v_ != NULL);                                                               \
+    AB_VEC_UNLIKELY(AB_vec_v_->num == AB_vec_v_->capacity)                                         \
+        && AB_vec_adaptive_grow((struct AB_vector_generic *)AB_vec_v_, sizeof(AB_vec_e_),          \
+            &AB_vec_site_) != 0 ? 1 : (AB_vec_v_->elems[AB_vec_v_->num++] = AB_vec_e_, 0);        \
+})
+
+# define AB_vec_pushp(vec) __extension__ ({                                                        \
+    static AB_vec_site AB_vec_site_;                                                               \
+    __typeof__(vec) AB_vec_v_ = (vec);                                                             \
+    AB_VEC_CHECK(AB_vec_v_ != NULL);                                                               \
+    AB_VEC_UNLIKELY(AB_vec_v_->num == AB_vec_v_->capacity)                                         \
+        && AB_vec_adaptive_grow((struct AB_vector_generic *)AB_vec_v_,                             \
+            sizeof(*AB_vec_v_->elems), &AB_vec_site_) != 0 ? NULL                                  \
+        : &AB_vec_v_->elems[AB_vec_v_->num++];                                                     \
+})
+
+# ifdef AB_VEC_INCLUDE_USERDATA
+#  define AB_vec_destroy(vec) __extension__ ({                                                     \
+    __typeof__(vec) AB_vec_v_ = (vec);                                                             \
+    AB_VEC_CHECK(AB_vec_v_ != NULL);                                                               \
+    AB_vec_adaptive_destroy(AB_vec_v_, AB_vec_v_->num);                                            \
+    AB_VEC_FREE(AB_vec_v_->elems, AB_vec_v_->capacity * sizeof(*AB_vec_v_->elems),                 \
+        AB_vec_v_->userdata);                                                                      \
+})
+# else
+#  define AB_vec_destroy(vec) __extension__ ({                                                     \
+    __typeof__(vec) AB_vec_v_ = (vec);                                                             \
+    AB_VEC_CHECK(AB_vec_v_ != NULL);                                                               \
+    AB_vec_adaptive_destroy(AB_vec_v_, AB_vec_v_->num);                                            \
+    AB_VEC_FREE(AB_vec_v_->elems, AB_vec_v_->capacity * sizeof(*AB_vec_v_->elems));                \
+})
+# endif
+#endif /* AB_VEC_ADAPTIVE */
+
+#endif /* AMBER_UTIL_VECTOR_ADAPTIVE_H */
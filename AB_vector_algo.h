@@ -0,0 +1,1153 @@
+/** @file AB_vector_algo.h
+ * @brief Generic algorithms over AB_vec
+ *
+ * Like the core header, these algorithms take any AB_vec and work out the
+ * element size from the vector itself. Index vectors may hold 4- or 8-byte
+ * unsigned integers (@c uint32_t, @c uint64_t, or @c size_t on 64-bit
+ * platforms).
+ *
+ * Reordering primitives (reverse, rotate, concatenate) work on raw bytes,
+ * so they take vectors of any element type. Merges and selections take a
+ * @c qsort style comparator, or NULL to compare 4- or 8-byte unsigned
+ * integers inline.
+ *
+ * This header requires C99 (for stdint.h).
+ *
+ * Macro-options:
+ *  - AB_VEC_PREFETCH_DISTANCE
+ *    How many elements ahead the indexed kernels prefetch their random
+ *    accesses. Should cover the memory latency divided by the time spent
+ *    per element; defaults to 16. Define it to 0 to disable prefetching.
+ *
+ *  - AB_VEC_NO_HW_GATHER
+ *    Define this macro to never use the AVX2/AVX-512 gather and scatter
+ *    instructions, which are slow on some microarchitectures.
+ *
+ */
+#ifndef AMBER_UTIL_VECTOR_ALGO_H
+#define AMBER_UTIL_VECTOR_ALGO_H
+
+#include "AB_vector.h"
+#include <stdint.h>
+#if (defined(__AVX2__) || defined(__AVX512F__)) && !defined(AB_VEC_NO_HW_GATHER)
+# include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+/** @brief Number of elements the indexed kernels prefetch ahead
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_PREFETCH_DISTANCE
+# define AB_VEC_PREFETCH_DISTANCE 16
+#endif
+
+/** @cond false */
+#if defined(__GNUC__)
+# define AB_VEC_PREFETCH_(addr, rw) __builtin_prefetch((addr), (rw))
+#else
+# define AB_VEC_PREFETCH_(addr, rw) ((void)0)
+#endif
+
+#define AB_VEC_IDX_(idx, idx_size, i)                                                              \
+    ((idx_size) == 4 ? (size_t)((const uint32_t *)(idx))[i] : (size_t)((const uint64_t *)(idx))[i])
+/** @endcond */
+
+/**************************************************************************
+ *
+ * Gather / scatter / permute
+ *
+ *************************************************************************/
+
+/** @cond false */
+/* Scalar gather for a concrete element and index type, with the loop split
+ * so the prefetch needs no bounds check */
+#define AB_VEC_GATHER_LOOP_(T, IT) do {                                                            \
+    T *d_ = (T *)dest;                                                                             \
+    const T *s_ = (const T *)src;                                                                  \
+    const IT *x_ = (const IT *)idx;                                                                \
+    size_t dist_ = AB_VEC_PREFETCH_DISTANCE;                                                       \
+    for (; dist_ != 0 && i + dist_ < n; i++) {                                                     \
+        AB_VEC_PREFETCH_(&s_[x_[i + dist_]], 0);                                                   \
+        d_[i] = s_[x_[i]];                                                                         \
+    }                                                                                              \
+    for (; i < n; i++)                                                                             \
+        d_[i] = s_[x_[i]];                                                                         \
+} while (0)
+
+#define AB_VEC_SCATTER_LOOP_(T, IT) do {                                                           \
+    T *d_ = (T *)dest;                                                                             \
+    const T *s_ = (const T *)src;                                                                  \
+    const IT *x_ = (const IT *)idx;                                                                \
+    size_t dist_ = AB_VEC_PREFETCH_DISTANCE;                                                       \
+    for (; dist_ != 0 && i + dist_ < n; i++) {                                                     \
+        AB_VEC_PREFETCH_(&d_[x_[i + dist_]], 1);                                                   \
+        d_[x_[i]] = s_[i];                                                                         \
+    }                                                                                              \
+    for (; i < n; i++)                                                                             \
+        d_[x_[i]] = s_[i];                                                                         \
+} while (0)
+/** @endcond */
+
+/* dest[i] = src[idx[i]] for i in [0, n) */
+static AB_VEC_INLINE void
+AB_vec_gather_kernel(void *dest, const void *src, const void *idx, size_t n,
+        size_t elem_size, size_t idx_size, size_t src_num)
+{
+    size_t i = 0;
+    (void)src_num;
+
+#if defined(__AVX512F__) && !defined(AB_VEC_NO_HW_GATHER)
+    /* Gather indices are signed 32-bit lanes, so large sources use scalar */
+    if (elem_size == 4 && idx_size == 4 && src_num <= INT32_MAX) {
+        for (; i + 16 <= n; i += 16) {
+            __m512i vi = _mm512_loadu_si512((const void *)((const uint32_t *)idx + i));
+            _mm512_storeu_si512((void *)((uint32_t *)dest + i),
+                    _mm512_i32gather_epi32(vi, src, 4));
+        }
+    } else if (elem_size == 8 && idx_size == 8) {
+        for (; i + 8 <= n; i += 8) {
+            __m512i vi = _mm512_loadu_si512((const void *)((const uint64_t *)idx + i));
+            _mm512_storeu_si512((void *)((uint64_t *)dest + i),
+                    _mm512_i64gather_epi64(vi, src, 8));
+        }
+    }
+#elif defined(__AVX2__) && !defined(AB_VEC_NO_HW_GATHER)
+    if (elem_size == 4 && idx_size == 4 && src_num <= INT32_MAX) {
+        for (; i + 8 <= n; i += 8) {
+            __m256i vi = _mm256_loadu_si256((const __m256i *)((const uint32_t *)idx + i));
+            _mm256_storeu_si256((__m256i *)((uint32_t *)dest + i),
+                    _mm256_i32gather_epi32((const int *)src, vi, 4));
+        }
+    } else if (elem_size == 8 && idx_size == 8) {
+        for (; i + 4 <= n; i += 4) {
+            __m256i vi = _mm256_loadu_si256((const __m256i *)((const uint64_t *)idx + i));
+            _mm256_storeu_si256((__m256i *)((uint64_t *)dest + i),
+                    _mm256_i64gather_epi64((const long long *)src, vi, 8));
+        }
+    }
+#endif
+
+    /* Finish (or do all of) the work with prefetching scalar loops */
+    switch (elem_size * 16 + idx_size) {
+    case 1 * 16 + 4: AB_VEC_GATHER_LOOP_(uint8_t, uint32_t); break;
+    case 1 * 16 + 8: AB_VEC_GATHER_LOOP_(uint8_t, uint64_t); break;
+    case 2 * 16 + 4: AB_VEC_GATHER_LOOP_(uint16_t, uint32_t); break;
+    case 2 * 16 + 8: AB_VEC_GATHER_LOOP_(uint16_t, uint64_t); break;
+    case 4 * 16 + 4: AB_VEC_GATHER_LOOP_(uint32_t, uint32_t); break;
+    case 4 * 16 + 8: AB_VEC_GATHER_LOOP_(uint32_t, uint64_t); break;
+    case 8 * 16 + 4: AB_VEC_GATHER_LOOP_(uint64_t, uint32_t); break;
+    case 8 * 16 + 8: AB_VEC_GATHER_LOOP_(uint64_t, uint64_t); break;
+    default:
+        for (; i < n; i++) {
+            if (AB_VEC_PREFETCH_DISTANCE != 0 && i + AB_VEC_PREFETCH_DISTANCE < n) {
+                AB_VEC_PREFETCH_((const char *)src + elem_size
+                        * AB_VEC_IDX_(idx, idx_size, i + AB_VEC_PREFETCH_DISTANCE), 0);
+            }
+            memcpy((char *)dest + i * elem_size,
+                    (const char *)src + AB_VEC_IDX_(idx, idx_size, i) * elem_size, elem_size);
+        }
+    }
+}
+
+/* dest[idx[i]] = src[i] for i in [0, n) */
+static AB_VEC_INLINE void
+AB_vec_scatter_kernel(void *dest, const void *src, const void *idx, size_t n,
+        size_t elem_size, size_t idx_size, size_t dest_num)
+{
+    size_t i = 0;
+    (void)dest_num;
+
+#if defined(__AVX512F__) && !defined(AB_VEC_NO_HW_GATHER)
+    /* Overlapping lanes are written in order, so duplicates keep
+     * last-writer-wins semantics */
+    if (elem_size == 4 && idx_size == 4 && dest_num <= INT32_MAX) {
+        for (; i + 16 <= n; i += 16) {
+            __m512i vi = _mm512_loadu_si512((const void *)((const uint32_t *)idx + i));
+            __m512i v = _mm512_loadu_si512((const void *)((const uint32_t *)src + i));
+            _mm512_i32scatter_epi32(dest, vi, v, 4);
+        }
+    } else if (elem_size == 8 && idx_size == 8) {
+        for (; i + 8 <= n; i += 8) {
+            __m512i vi = _mm512_loadu_si512((const void *)((const uint64_t *)idx + i));
+            __m512i v = _mm512_loadu_si512((const void *)((const uint64_t *)src + i));
+            _mm512_i64scatter_epi64(dest, vi, v, 8);
+        }
+    }
+#endif
+
+    switch (elem_size * 16 + idx_size) {
+    case 1 * 16 + 4: AB_VEC_SCATTER_LOOP_(uint8_t, uint32_t); break;
+    case 1 * 16 + 8: AB_VEC_SCATTER_LOOP_(uint8_t, uint64_t); break;
+    case 2 * 16 + 4: AB_VEC_SCATTER_LOOP_(uint16_t, uint32_t); break;
+    case 2 * 16 + 8: AB_VEC_SCATTER_LOOP_(uint16_t, uint64_t); break;
+    case 4 * 16 + 4: AB_VEC_SCATTER_LOOP_(uint32_t, uint32_t); break;
+    case 4 * 16 + 8: AB_VEC_SCATTER_LOOP_(uint32_t, uint64_t); break;
+    case 8 * 16 + 4: AB_VEC_SCATTER_LOOP_(uint64_t, uint32_t); break;
+    case 8 * 16 + 8: AB_VEC_SCATTER_LOOP_(uint64_t, uint64_t); break;
+    default:
+        for (; i < n; i++) {
+            if (AB_VEC_PREFETCH_DISTANCE != 0 && i + AB_VEC_PREFETCH_DISTANCE < n) {
+                AB_VEC_PREFETCH_((char *)dest + elem_size
+                        * AB_VEC_IDX_(idx, idx_size, i + AB_VEC_PREFETCH_DISTANCE), 1);
+            }
+            memcpy((char *)dest + AB_VEC_IDX_(idx, idx_size, i) * elem_size,
+                    (const char *)src + i * elem_size, elem_size);
+        }
+    }
+}
+
+static AB_VEC_INLINE int
+AB_vec_gather_generic(struct AB_vector_generic *dest, const struct AB_vector_generic *src,
+        const struct AB_vector_generic *idx, size_t elem_size, size_t idx_size)
+{
+    AB_VEC_ASSERT(dest != NULL);
+    AB_VEC_ASSERT(src != NULL && idx != NULL);
+    AB_VEC_ASSERT(dest != src);
+    AB_VEC_ASSERT(idx_size == 4 || idx_size == 8);
+    if (AB_vec_reserve_generic(dest, idx->num, (AB_VEC_SIZE_T)elem_size))
+        return 1;
+    AB_vec_gather_kernel(dest->elems, src->elems, idx->elems, idx->num,
+            elem_size, idx_size, src->num);
+    dest->num = idx->num;
+    return 0;
+}
+/** @brief Gather elements by index: @c dest[i] = @c src[idx[i]]
+ * @param [out] dest Pointer to the destination AB_vec, resized to the size
+ *  of @c idx
+ * @param [in] src Const pointer to the source AB_vec, distinct from @c dest
+ * @param [in] idx Const pointer to an AB_vec of 4- or 8-byte indices into @c src
+ * @return 0 on success, nonzero on error
+ * @note The random reads from @c src are prefetched
+ *  @c AB_VEC_PREFETCH_DISTANCE elements ahead, and use hardware gathers for
+ *  4- and 8-byte elements when compiled for AVX2 or AVX-512
+ * @hideinitializer
+ */
+#define AB_vec_gather(dest, src, idx)                                                              \
+    AB_vec_gather_generic((struct AB_vector_generic *)(dest),                                      \
+            (const struct AB_vector_generic *)(src), (const struct AB_vector_generic *)(idx),      \
+            sizeof(*(dest)->elems), sizeof(*(idx)->elems))
+
+static AB_VEC_INLINE int
+AB_vec_scatter_generic(struct AB_vector_generic *dest, const struct AB_vector_generic *src,
+        const struct AB_vector_generic *idx, size_t elem_size, size_t idx_size)
+{
+    AB_VEC_ASSERT(dest != NULL);
+    AB_VEC_ASSERT(src != NULL && idx != NULL);
+    AB_VEC_ASSERT(dest != src);
+    AB_VEC_ASSERT(idx_size == 4 || idx_size == 8);
+    AB_VEC_ASSERT(idx->num >= src->num);
+    AB_vec_scatter_kernel(dest->elems, src->elems, idx->elems, src->num,
+            elem_size, idx_size, dest->num);
+    return 0;
+}
+/** @brief Scatter elements by index: @c dest[idx[i]] = @c src[i]
+ * @param [in, out] dest Pointer to the destination AB_vec. Every index must
+ *  already be in [0, size) of @c dest.
+ * @param [in] src Const pointer to the source AB_vec, distinct from @c dest
+ * @param [in] idx Const pointer to an AB_vec of 4- or 8-byte indices into
+ *  @c dest, at least as long as @c src
+ * @return 0 on success, nonzero on error
+ * @note If an index repeats, the last element written to it wins
+ * @hideinitializer
+ */
+#define AB_vec_scatter(dest, src, idx)                                                             \
+    AB_vec_scatter_generic((struct AB_vector_generic *)(dest),                                     \
+            (const struct AB_vector_generic *)(src), (const struct AB_vector_generic *)(idx),      \
+            sizeof(*(dest)->elems), sizeof(*(idx)->elems))
+
+static AB_VEC_INLINE int
+AB_vec_permute_generic(struct AB_vector_generic *vec, const struct AB_vector_generic *idx,
+        size_t elem_size, size_t idx_size)
+{
+    AB_vec(unsigned char) done = AB_VEC_INIT;
+    AB_vec(char) spill = AB_VEC_INIT;
+    char local[64], *tmp = local, *elems;
+    size_t start, n;
+
+    AB_VEC_ASSERT(vec != NULL && idx != NULL);
+    AB_VEC_ASSERT(idx->num == vec->num);
+    elems = vec->elems;
+    n = vec->num;
+    AB_VEC_ASSERT(idx_size == 4 || idx_size == 8);
+    if (n == 0)
+        return 0;
+    if (AB_vec_resize_zero(&done, (n + 7) / 8))
+        return 1;
+    if (elem_size > sizeof(local)) {
+        if (AB_vec_resize(&spill, elem_size)) {
+            AB_vec_destroy(&done);
+            return 1;
+        }
+        tmp = spill.elems;
+    }
+
+    /* Follow each cycle once, pulling every element into its final slot and
+     * parking only the first one in tmp */
+    for (start = 0; start < n; start++) {
+        size_t j = start, k;
+        if (done.elems[start / 8] & (1u << (start % 8)))
+            continue;
+        memcpy(tmp, elems + start * elem_size, elem_size);
+        for (;;) {
+            done.elems[j / 8] |= (unsigned char)(1u << (j % 8));
+            k = AB_VEC_IDX_(idx->elems, idx_size, j);
+            AB_VEC_ASSERT(k < n);
+            if (k == start)
+                break;
+            memcpy(elems + j * elem_size, elems + k * elem_size, elem_size);
+            j = k;
+        }
+        memcpy(elems + j * elem_size, tmp, elem_size);
+    }
+
+    AB_vec_destroy(&done);
+    AB_vec_destroy(&spill);
+    return 0;
+}
+/** @brief Reorder a vector in place so that element @c i becomes the old
+ *  element @c idx[i]
+ * @param vec Pointer to the AB_vec
+ * @param [in] idx Const pointer to an AB_vec of 4- or 8-byte indices, which
+ *  must be a permutation of [0, size)
+ * @return 0 on success, nonzero on error
+ * @note Uses cycle-following with one temporary element and a bitmap of
+ *  n / 8 bytes, instead of a full copy of the vector
+ * @hideinitializer
+ */
+#define AB_vec_permute(vec, idx)                                                                   \
+    AB_vec_permute_generic((struct AB_vector_generic *)(vec),                                      \
+            (const struct AB_vector_generic *)(idx), sizeof(*(vec)->elems), sizeof(*(idx)->elems))
+
+/**************************************************************************
+ *
+ * Reverse / rotate / concatenate
+ *
+ *************************************************************************/
+
+#if defined(__SSE2__)
+/* Reverse the order of the 1-, 2-, 4- or 8-byte lanes of a register */
+static AB_VEC_INLINE __m128i
+AB_vec_reverse_lanes(__m128i x, size_t elem_size)
+{
+    switch (elem_size) {
+        case 1:
+            x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+            /* fallthrough */
+        case 2:
+            x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+            x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+            return _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2));
+        case 4:
+            return _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 1, 2, 3));
+        default:
+            return _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2));
+    }
+}
+#endif
+
+/* Exchange two non-overlapping byte ranges */
+static AB_VEC_INLINE void
+AB_vec_swap_bytes(char *a, char *b, size_t n)
+{
+    char buf[256];
+#if defined(__SSE2__)
+    for (; n >= 32; a += 32, b += 32, n -= 32) {
+        __m128i x0 = _mm_loadu_si128((const __m128i *)a);
+        __m128i x1 = _mm_loadu_si128((const __m128i *)(a + 16));
+        __m128i y0 = _mm_loadu_si128((const __m128i *)b);
+        __m128i y1 = _mm_loadu_si128((const __m128i *)(b + 16));
+        _mm_storeu_si128((__m128i *)a, y0);
+        _mm_storeu_si128((__m128i *)(a + 16), y1);
+        _mm_storeu_si128((__m128i *)b, x0);
+        _mm_storeu_si128((__m128i *)(b + 16), x1);
+    }
+#endif
+    while (n > 0) {
+        size_t m = n < sizeof(buf) ? n : sizeof(buf);
+        memcpy(buf, a, m);
+        memcpy(a, b, m);
+        memcpy(b, buf, m);
+        a += m;
+        b += m;
+        n -= m;
+    }
+}
+
+static AB_VEC_INLINE void
+AB_vec_reverse_kernel(void *base, size_t n, size_t elem_size)
+{
+    char *lo = base, *hi;
+    if (n < 2)
+        return;
+    hi = lo + n * elem_size;
+#if defined(__SSE2__)
+    if (elem_size == 1 || elem_size == 2 || elem_size == 4 || elem_size == 8) {
+        /* Swap 16-byte blocks from both ends, reversing the lanes of each */
+        while (hi - lo >= 32) {
+            __m128i a = _mm_loadu_si128((const __m128i *)lo);
+            __m128i b = _mm_loadu_si128((const __m128i *)(hi - 16));
+            _mm_storeu_si128((__m128i *)lo, AB_vec_reverse_lanes(b, elem_size));
+            _mm_storeu_si128((__m128i *)(hi - 16), AB_vec_reverse_lanes(a, elem_size));
+            lo += 16;
+            hi -= 16;
+        }
+    }
+#endif
+    switch (elem_size) {
+#define AB_VEC_REVERSE_LOOP_(T) do {                                                               \
+    T *e_ = (T *)lo;                                                                               \
+    size_t i_, m_ = (size_t)(hi - lo) / sizeof(T);                                                 \
+    for (i_ = 0; i_ < m_ / 2; i_++) {                                                              \
+        T t_ = e_[i_];                                                                             \
+        e_[i_] = e_[m_ - 1 - i_];                                                                  \
+        e_[m_ - 1 - i_] = t_;                                                                      \
+    }                                                                                              \
+} while (0)
+        case 1: AB_VEC_REVERSE_LOOP_(uint8_t); break;
+        case 2: AB_VEC_REVERSE_LOOP_(uint16_t); break;
+        case 4: AB_VEC_REVERSE_LOOP_(uint32_t); break;
+        case 8: AB_VEC_REVERSE_LOOP_(uint64_t); break;
+#undef AB_VEC_REVERSE_LOOP_
+        default:
+            while (hi - lo >= (ptrdiff_t)(2 * elem_size)) {
+                hi -= elem_size;
+                AB_vec_swap_bytes(lo, hi, elem_size);
+                lo += elem_size;
+            }
+    }
+}
+/** @brief Reverse the order of the elements of a vector in place
+ * @param vec Pointer to the AB_vec
+ * @note 1-, 2-, 4- and 8-byte elements are reversed 16 bytes at a time with
+ *  SSE2 lane shuffles
+ * @hideinitializer
+ */
+#define AB_vec_reverse(vec)                                                                        \
+    (AB_VEC_CHECK((vec) != NULL),                                                                  \
+     AB_vec_reverse_kernel((vec)->elems, (vec)->num, sizeof(*(vec)->elems)))
+
+static AB_VEC_INLINE void
+AB_vec_rotate_kernel(void *base, size_t n, size_t k, size_t elem_size)
+{
+    char *mid = (char *)base + k * elem_size;
+    size_t left = k * elem_size, right = (n - k) * elem_size;
+    char buf[512];
+
+    /* Gries-Mills block swap: swap the shorter block into its final place
+     * and repeat on the rest, until one side is short enough to be parked
+     * on the stack while the other slides over with one memmove */
+    for (;;) {
+        char *p = mid - left;
+        if (left == 0 || right == 0)
+            return;
+        if (left <= sizeof(buf)) {
+            memcpy(buf, p, left);
+            memmove(p, mid, right);
+            memcpy(p + right, buf, left);
+            return;
+        }
+        if (right <= sizeof(buf)) {
+            memcpy(buf, mid, right);
+            memmove(p + right, p, left);
+            memcpy(p, buf, right);
+            return;
+        }
+        if (left < right) {
+            AB_vec_swap_bytes(p, mid + right - left, left);
+            right -= left;
+        } else {
+            AB_vec_swap_bytes(p, mid, right);
+            left -= right;
+        }
+    }
+}
+/** @brief Rotate a vector left in place, so element @c k becomes the first
+ * @param vec Pointer to the AB_vec
+ * @param k Number of positions, in [0, size]
+ * @note Uses block swaps until one side fits in 512 bytes, which is then
+ *  parked on the stack while the rest moves with a single @c memmove
+ * @hideinitializer
+ */
+#define AB_vec_rotate(vec, k)                                                                      \
+    (AB_VEC_CHECK((vec) != NULL), AB_VEC_CHECK_BOUNDS((size_t)(k) <= (vec)->num),                  \
+     AB_vec_rotate_kernel((vec)->elems, (vec)->num, (k), sizeof(*(vec)->elems)))
+
+static AB_VEC_INLINE int
+AB_vec_concat_generic(struct AB_vector_generic *dest, const void *srcs, size_t stride,
+        size_t n, size_t elem_size)
+{
+    const char *s = srcs;
+    size_t i, total, at;
+
+    AB_VEC_CHECK(dest != NULL);
+    AB_VEC_CHECK(n == 0 || srcs != NULL);
+    total = at = dest->num;
+    for (i = 0; i < n; i++) {
+        total += ((const struct AB_vector_generic *)(s + i * stride))->num;
+        if (total < ((const struct AB_vector_generic *)(s + i * stride))->num)
+            return 1;
+    }
+    if (AB_vec_reserve_generic(dest, (AB_VEC_SIZE_T)total, (AB_VEC_SIZE_T)elem_size))
+        return 1;
+    /* Read each source after the reserve, so dest may be one of them */
+    for (i = 0; i < n; i++) {
+        const struct AB_vector_generic *src = (const struct AB_vector_generic *)(s + i * stride);
+        if (src->num > 0)
+            memcpy((char *)dest->elems + at * elem_size, src->elems, src->num * elem_size);
+        at += src->num;
+    }
+    dest->num = (AB_VEC_SIZE_T)total;
+    return 0;
+}
+/** @brief Append the elements of several vectors to a vector
+ * @param dest Pointer to the destination AB_vec
+ * @param [in] srcs Pointer to the first of @c n AB_vec with the same element
+ *  type as @c dest, which may include @c dest itself
+ * @param n Number of source vectors
+ * @return 0 on success, nonzero on error
+ * @note The destination grows at most once, to exactly the total size
+ * @hideinitializer
+ */
+#define AB_vec_concat(dest, srcs, n)                                                               \
+    ((void)sizeof(char[sizeof(*(dest)->elems) == sizeof(*(srcs)->elems) ? 1 : -1]),                \
+     AB_vec_concat_generic((struct AB_vector_generic *)(dest), (srcs), sizeof(*(srcs)), (n),       \
+         sizeof(*(dest)->elems)))
+
+/**************************************************************************
+ *
+ * Merging sorted vectors
+ *
+ *************************************************************************/
+
+/** @brief Comparison function on element pointers, as for @c qsort
+ *
+ * The merge functions also accept NULL, which compares 4- or 8-byte elements
+ * as unsigned integers without a function call.
+ */
+typedef int (*AB_vec_cmp_fn)(const void *a, const void *b);
+
+/* Nonzero if *x sorts strictly before *y */
+static AB_VEC_INLINE int
+AB_vec_cmp_less(const void *x, const void *y, size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    if (cmp != NULL)
+        return cmp(x, y) < 0;
+    if (elem_size == 4)
+        return *(const uint32_t *)x < *(const uint32_t *)y;
+    return *(const uint64_t *)x < *(const uint64_t *)y;
+}
+
+/** @cond false */
+/* Branchless merge step: the smaller head is selected with a conditional
+ * move and both cursors advance by 0 or 1, so unpredictable inputs cost no
+ * mispredictions */
+#define AB_VEC_MERGE_LOOP_(T) do {                                                                 \
+    const T *a_ = (const T *)a, *b_ = (const T *)b;                                                \
+    T *o_ = (T *)out;                                                                              \
+    size_t i_ = 0, j_ = 0;                                                                         \
+    while (i_ < na && j_ < nb) {                                                                   \
+        T x_ = a_[i_], y_ = b_[j_];                                                                \
+        int tb_ = y_ < x_;                                                                         \
+        *o_++ = tb_ ? y_ : x_;                                                                     \
+        i_ += (size_t)!tb_;                                                                        \
+        j_ += (size_t)tb_;                                                                         \
+    }                                                                                              \
+    a = a_ + i_; na -= i_;                                                                         \
+    b = b_ + j_; nb -= j_;                                                                         \
+    out = o_;                                                                                      \
+} while (0)
+/** @endcond */
+
+/* Stable merge of na and nb sorted elements into out, which must not
+ * overlap either input. Equal elements keep a's before b's. */
+static AB_VEC_INLINE void
+AB_vec_merge_kernel(void *out, const void *a, size_t na, const void *b, size_t nb,
+        size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    if (cmp == NULL && elem_size == 4) {
+        AB_VEC_MERGE_LOOP_(uint32_t);
+    } else if (cmp == NULL) {
+        AB_VEC_MERGE_LOOP_(uint64_t);
+    } else {
+        const char *pa = a, *pb = b, *ea = pa + na * elem_size, *eb = pb + nb * elem_size;
+        char *o = out;
+        while (pa < ea && pb < eb) {
+            size_t tb = (size_t)(cmp(pb, pa) < 0);
+            memcpy(o, tb ? pb : pa, elem_size);
+            o += elem_size;
+            pa += (1 - tb) * elem_size;
+            pb += tb * elem_size;
+        }
+        na = (size_t)(ea - pa) / elem_size;
+        nb = (size_t)(eb - pb) / elem_size;
+        a = pa;
+        b = pb;
+        out = o;
+    }
+    if (na > 0)
+        memcpy(out, a, na * elem_size);
+    if (nb > 0)
+        memcpy(out, b, nb * elem_size);
+}
+
+static AB_VEC_INLINE int
+AB_vec_merge_generic(struct AB_vector_generic *dest, const struct AB_vector_generic *a,
+        const struct AB_vector_generic *b, size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    AB_VEC_CHECK(dest != NULL && a != NULL && b != NULL);
+    AB_VEC_CHECK(dest != a && dest != b);
+    AB_VEC_CHECK(cmp != NULL || elem_size == 4 || elem_size == 8);
+    if (AB_vec_reserve_generic(dest, a->num + b->num, (AB_VEC_SIZE_T)elem_size))
+        return 1;
+    AB_vec_merge_kernel(dest->elems, a->elems, a->num, b->elems, b->num, elem_size, cmp);
+    dest->num = a->num + b->num;
+    return 0;
+}
+/** @brief Merge two sorted vectors into a third
+ * @param [out] dest Pointer to the destination AB_vec, distinct from both
+ *  inputs. Its contents are replaced.
+ * @param [in] a Const pointer to a sorted AB_vec
+ * @param [in] b Const pointer to a sorted AB_vec of the same type
+ * @param cmp An @c AB_vec_cmp_fn, or NULL for 4- or 8-byte unsigned integers
+ * @return 0 on success, nonzero on error
+ * @note The merge is stable: equal elements of @c a come before those of
+ *  @c b. With NULL @c cmp the inner loop is branchless.
+ * @hideinitializer
+ */
+#define AB_vec_merge(dest, a, b, cmp)                                                              \
+    AB_vec_merge_generic((struct AB_vector_generic *)(dest),                                       \
+            (const struct AB_vector_generic *)(a), (const struct AB_vector_generic *)(b),          \
+            sizeof(*(dest)->elems), (cmp))
+
+/** @cond false */
+struct AB_vec_merge_run {
+    const char *cur, *end;
+};
+/** @endcond */
+
+/* Nonzero if run x loses to run y: exhausted runs sort last, and ties go
+ * to the lower run index to keep the merge stable. Run k is the -infinity
+ * sentinel used while building the tree. */
+static AB_VEC_INLINE int
+AB_vec_loser_beats(const struct AB_vec_merge_run *runs, size_t k, size_t x, size_t y,
+        size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    if (y == k)
+        return 1;
+    if (x == k)
+        return 0;
+    if (runs[x].cur == runs[x].end)
+        return runs[y].cur != runs[y].end || x > y;
+    if (runs[y].cur == runs[y].end)
+        return 0;
+    if (AB_vec_cmp_less(runs[y].cur, runs[x].cur, elem_size, cmp))
+        return 1;
+    return x > y && !AB_vec_cmp_less(runs[x].cur, runs[y].cur, elem_size, cmp);
+}
+
+/* Replay the matches from leaf s up to the root, leaving the losers in the
+ * tree and the overall winner in tree[0] */
+static AB_VEC_INLINE void
+AB_vec_loser_adjust(size_t *tree, const struct AB_vec_merge_run *runs, size_t k, size_t s,
+        size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    size_t t;
+    for (t = (s + k) / 2; t > 0; t /= 2) {
+        if (AB_vec_loser_beats(runs, k, s, tree[t], elem_size, cmp)) {
+            size_t loser = s;
+            s = tree[t];
+            tree[t] = loser;
+        }
+    }
+    tree[0] = s;
+}
+
+static AB_VEC_INLINE int
+AB_vec_merge_runs_generic(struct AB_vector_generic *dest, const void *srcs, size_t stride,
+        size_t k, size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    AB_vec(struct AB_vec_merge_run) runs = AB_VEC_INIT;
+    AB_vec(size_t) tree = AB_VEC_INIT;
+    const char *s = srcs;
+    size_t i, total = 0;
+    char *out;
+
+    AB_VEC_CHECK(dest != NULL);
+    AB_VEC_CHECK(k == 0 || srcs != NULL);
+    AB_VEC_CHECK(cmp != NULL || elem_size == 4 || elem_size == 8);
+    for (i = 0; i < k; i++) {
+        const struct AB_vector_generic *src = (const struct AB_vector_generic *)(s + i * stride);
+        AB_VEC_CHECK(src != dest);
+        total += src->num;
+    }
+    if (AB_vec_reserve_generic(dest, (AB_VEC_SIZE_T)total, (AB_VEC_SIZE_T)elem_size))
+        return 1;
+    out = dest->elems;
+    dest->num = (AB_VEC_SIZE_T)total;
+    if (k <= 2) {
+        const struct AB_vector_generic *a = (const struct AB_vector_generic *)s;
+        const struct AB_vector_generic *b = (const struct AB_vector_generic *)(s + stride);
+        if (k == 1 && total > 0)
+            memcpy(out, a->elems, total * elem_size);
+        else if (k == 2)
+            AB_vec_merge_kernel(out, a->elems, a->num, b->elems, b->num, elem_size, cmp);
+        return 0;
+    }
+
+    if (AB_vec_resize(&runs, k) || AB_vec_resize(&tree, k)) {
+        AB_vec_destroy(&runs);
+        AB_vec_destroy(&tree);
+        return 1;
+    }
+    for (i = 0; i < k; i++) {
+        const struct AB_vector_generic *src = (const struct AB_vector_generic *)(s + i * stride);
+        runs.elems[i].cur = src->elems;
+        runs.elems[i].end = (const char *)src->elems + src->num * elem_size;
+        tree.elems[i] = k;
+    }
+    for (i = k; i-- > 0;)
+        AB_vec_loser_adjust(tree.elems, runs.elems, k, i, elem_size, cmp);
+
+    /* Each output element costs log2(k) comparisons on the path from the
+     * winner's leaf to the root, against the stored losers only */
+    for (i = 0; i < total; i++) {
+        size_t w = tree.elems[0];
+        memcpy(out, runs.elems[w].cur, elem_size);
+        out += elem_size;
+        runs.elems[w].cur += elem_size;
+        AB_vec_loser_adjust(tree.elems, runs.elems, k, w, elem_size, cmp);
+    }
+
+    AB_vec_destroy(&runs);
+    AB_vec_destroy(&tree);
+    return 0;
+}
+/** @brief Merge @c k sorted vectors into one with a loser tree
+ * @param [out] dest Pointer to the destination AB_vec, distinct from every
+ *  source. Its contents are replaced.
+ * @param [in] srcs Pointer to the first of @c k sorted AB_vec of the same
+ *  type as @c dest
+ * @param k Number of source vectors
+ * @param cmp An @c AB_vec_cmp_fn, or NULL for 4- or 8-byte unsigned integers
+ * @return 0 on success, nonzero on error
+ * @note The destination grows at most once. The merge is stable: ties are
+ *  taken from the earlier source first.
+ * @hideinitializer
+ */
+#define AB_vec_merge_runs(dest, srcs, k, cmp)                                                      \
+    ((void)sizeof(char[sizeof(*(dest)->elems) == sizeof(*(srcs)->elems) ? 1 : -1]),                \
+     AB_vec_merge_runs_generic((struct AB_vector_generic *)(dest), (srcs), sizeof(*(srcs)), (k),   \
+         sizeof(*(dest)->elems), (cmp)))
+
+/* First element of [p, p + n) that does not sort before *key (upper is 0),
+ * or that sorts after it (upper is 1) */
+static AB_VEC_INLINE size_t
+AB_vec_merge_bound(const char *p, size_t n, const char *key, int upper,
+        size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    size_t lo = 0;
+    while (n > 0) {
+        size_t half = n / 2;
+        const char *m = p + (lo + half) * elem_size;
+        if (upper ? !AB_vec_cmp_less(key, m, elem_size, cmp)
+                  : AB_vec_cmp_less(m, key, elem_size, cmp)) {
+            lo += half + 1;
+            n -= half + 1;
+        } else {
+            n = half;
+        }
+    }
+    return lo;
+}
+
+static AB_VEC_INLINE void
+AB_vec_merge_inplace_kernel(char *first, size_t n1, size_t n2, size_t elem_size,
+        AB_vec_cmp_fn cmp)
+{
+    char buf[1024];
+
+    while (n1 > 0 && n2 > 0) {
+        char *mid = first + n1 * elem_size;
+        size_t c1, c2;
+
+        /* A short side is merged through a stack buffer in one pass */
+        if (n1 * elem_size <= sizeof(buf)) {
+            const char *pb = buf, *eb = buf + n1 * elem_size;
+            const char *pr = mid, *er = mid + n2 * elem_size;
+            char *o = first;
+            memcpy(buf, first, n1 * elem_size);
+            while (pb < eb && pr < er) {
+                int tr = AB_vec_cmp_less(pr, pb, elem_size, cmp);
+                memmove(o, tr ? pr : pb, elem_size);
+                o += elem_size;
+                if (tr)
+                    pr += elem_size;
+                else
+                    pb += elem_size;
+            }
+            memcpy(o, pb, (size_t)(eb - pb));
+            return;
+        }
+        if (n2 * elem_size <= sizeof(buf)) {
+            const char *pb = buf + n2 * elem_size, *pl = mid;
+            char *o = mid + n2 * elem_size;
+            memcpy(buf, mid, n2 * elem_size);
+            while (pb > buf && pl > first) {
+                int tl = AB_vec_cmp_less(pb - elem_size, pl - elem_size, elem_size, cmp);
+                o -= elem_size;
+                if (tl) {
+                    pl -= elem_size;
+                    memmove(o, pl, elem_size);
+                } else {
+                    pb -= elem_size;
+                    memcpy(o, pb, elem_size);
+                }
+            }
+            memcpy(first, buf, (size_t)(pb - buf));
+            return;
+        }
+
+        /* Split the longer run in half, find the matching cut in the other,
+         * and rotate the two middle pieces into place */
+        if (n1 > n2) {
+            c1 = n1 / 2;
+            c2 = AB_vec_merge_bound(mid, n2, first + c1 * elem_size, 0, elem_size, cmp);
+        } else {
+            c2 = n2 / 2;
+            c1 = AB_vec_merge_bound(first, n1, mid + c2 * elem_size, 1, elem_size, cmp);
+        }
+        AB_vec_rotate_kernel(first + c1 * elem_size, n1 - c1 + c2, n1 - c1, elem_size);
+        /* Recurse on the smaller half, loop on the larger one */
+        if (c1 + c2 < n1 + n2 - c1 - c2) {
+            AB_vec_merge_inplace_kernel(first, c1, c2, elem_size, cmp);
+            first += (c1 + c2) * elem_size;
+            n1 -= c1;
+            n2 -= c2;
+        } else {
+            AB_vec_merge_inplace_kernel(first + (c1 + c2) * elem_size, n1 - c1, n2 - c2,
+                    elem_size, cmp);
+            n1 = c1;
+            n2 = c2;
+        }
+    }
+}
+/** @brief Merge the sorted runs [0, mid) and [mid, size) of a vector in place
+ * @param vec Pointer to the AB_vec
+ * @param mid Start of the second run
+ * @param cmp An @c AB_vec_cmp_fn, or NULL for 4- or 8-byte unsigned integers
+ * @note Allocates nothing. Runs that fit in 1 KiB are merged linearly
+ *  through a stack buffer; longer ones are split by binary search and
+ *  rotation, which costs O(n log n) moves.
+ * @hideinitializer
+ */
+#define AB_vec_merge_inplace(vec, mid, cmp)                                                        \
+    (AB_VEC_CHECK((vec) != NULL), AB_VEC_CHECK_BOUNDS((size_t)(mid) <= (vec)->num),                \
+     AB_VEC_CHECK((cmp) != NULL || sizeof(*(vec)->elems) == 4 || sizeof(*(vec)->elems) == 8),      \
+     AB_vec_merge_inplace_kernel((char *)(vec)->elems, (mid), (vec)->num - (mid),                  \
+         sizeof(*(vec)->elems), (cmp)))
+
+/**************************************************************************
+ *
+ * Selection
+ *
+ *************************************************************************/
+
+static AB_VEC_INLINE void
+AB_vec_elem_swap(char *a, char *b, size_t elem_size)
+{
+    if (elem_size == 4) {
+        uint32_t t;
+        memcpy(&t, a, 4);
+        memcpy(a, b, 4);
+        memcpy(b, &t, 4);
+    } else if (elem_size == 8) {
+        uint64_t t;
+        memcpy(&t, a, 8);
+        memcpy(a, b, 8);
+        memcpy(b, &t, 8);
+    } else {
+        AB_vec_swap_bytes(a, b, elem_size);
+    }
+}
+
+/* Nonzero if *x belongs above *y: a min-heap keeps the smallest element at
+ * the root, a max-heap the largest */
+static AB_VEC_INLINE int
+AB_vec_heap_above(const char *x, const char *y, size_t elem_size, AB_vec_cmp_fn cmp, int min)
+{
+    return min ? AB_vec_cmp_less(x, y, elem_size, cmp) : AB_vec_cmp_less(y, x, elem_size, cmp);
+}
+
+static AB_VEC_INLINE void
+AB_vec_heap_sift_down(char *base, size_t n, size_t i, size_t elem_size,
+        AB_vec_cmp_fn cmp, int min)
+{
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= n)
+            return;
+        if (c + 1 < n
+                && AB_vec_heap_above(base + (c + 1) * elem_size, base + c * elem_size,
+                    elem_size, cmp, min))
+            c++;
+        if (!AB_vec_heap_above(base + c * elem_size, base + i * elem_size, elem_size, cmp, min))
+            return;
+        AB_vec_elem_swap(base + c * elem_size, base + i * elem_size, elem_size);
+        i = c;
+    }
+}
+
+static AB_VEC_INLINE void
+AB_vec_heap_sift_up(char *base, size_t i, size_t elem_size, AB_vec_cmp_fn cmp, int min)
+{
+    while (i > 0) {
+        size_t p = (i - 1) / 2;
+        if (!AB_vec_heap_above(base + i * elem_size, base + p * elem_size, elem_size, cmp, min))
+            return;
+        AB_vec_elem_swap(base + i * elem_size, base + p * elem_size, elem_size);
+        i = p;
+    }
+}
+
+/* Turn a heap of n elements into a sorted run: ascending for a max-heap,
+ * descending for a min-heap */
+static AB_VEC_INLINE void
+AB_vec_heap_sort(char *base, size_t n, size_t elem_size, AB_vec_cmp_fn cmp, int min)
+{
+    while (n > 1) {
+        n--;
+        AB_vec_elem_swap(base, base + n * elem_size, elem_size);
+        AB_vec_heap_sift_down(base, n, 0, elem_size, cmp, min);
+    }
+}
+
+/* Move the k smallest of n elements to the front as a max-heap */
+static AB_VEC_INLINE void
+AB_vec_heap_select(char *base, size_t n, size_t k, size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    size_t i;
+    for (i = k / 2; i-- > 0;)
+        AB_vec_heap_sift_down(base, k, i, elem_size, cmp, 0);
+    for (i = k; i < n; i++) {
+        if (AB_vec_cmp_less(base + i * elem_size, base, elem_size, cmp)) {
+            AB_vec_elem_swap(base + i * elem_size, base, elem_size);
+            AB_vec_heap_sift_down(base, k, 0, elem_size, cmp, 0);
+        }
+    }
+}
+
+/* Introselect: quickselect with median-of-three pivots, falling back to a
+ * heap selection once the partitions stop shrinking geometrically */
+static AB_VEC_INLINE void
+AB_vec_select_kernel(char *base, size_t n, size_t nth, size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    size_t lo = 0, hi = n, depth = 0, i, j;
+
+    for (i = n; i > 1; i /= 2)
+        depth += 2;
+    while (hi - lo > 16) {
+        char *p = base + lo * elem_size;
+        char *m = base + (lo + (hi - lo) / 2) * elem_size, *l = base + (hi - 1) * elem_size;
+
+        if (depth-- == 0) {
+            AB_vec_heap_select(p, hi - lo, nth - lo + 1, elem_size, cmp);
+            AB_vec_elem_swap(p, base + nth * elem_size, elem_size);
+            return;
+        }
+        /* Order first <= middle <= last, then park the median at lo. The
+         * last element then stops the left scan and the pivot the right. */
+        if (AB_vec_cmp_less(m, p, elem_size, cmp))
+            AB_vec_elem_swap(m, p, elem_size);
+        if (AB_vec_cmp_less(l, m, elem_size, cmp)) {
+            AB_vec_elem_swap(l, m, elem_size);
+            if (AB_vec_cmp_less(m, p, elem_size, cmp))
+                AB_vec_elem_swap(m, p, elem_size);
+        }
+        AB_vec_elem_swap(m, p, elem_size);
+
+        /* Hoare partition; both scans stop on keys equal to the pivot so
+         * runs of duplicates split evenly */
+        i = lo;
+        j = hi;
+        for (;;) {
+            do
+                i++;
+            while (AB_vec_cmp_less(base + i * elem_size, p, elem_size, cmp));
+            do
+                j--;
+            while (AB_vec_cmp_less(p, base + j * elem_size, elem_size, cmp));
+            if (i >= j)
+                break;
+            AB_vec_elem_swap(base + i * elem_size, base + j * elem_size, elem_size);
+        }
+        AB_vec_elem_swap(p, base + j * elem_size, elem_size);
+        if (nth == j)
+            return;
+        if (nth < j)
+            hi = j;
+        else
+            lo = j + 1;
+    }
+
+    for (i = lo + 1; i < hi; i++)
+        for (j = i; j > lo && AB_vec_cmp_less(base + j * elem_size, base + (j - 1) * elem_size,
+                    elem_size, cmp); j--)
+            AB_vec_elem_swap(base + j * elem_size, base + (j - 1) * elem_size, elem_size);
+}
+/** @brief Partially sort a vector so that one index holds its sorted value
+ * @param vec Pointer to the AB_vec
+ * @param nth Index in [0, size) to place
+ * @param cmp An @c AB_vec_cmp_fn, or NULL for 4- or 8-byte unsigned integers
+ * @note Afterwards no element before @c nth sorts after it and no element
+ *  after @c nth sorts before it. Runs in O(size) time on average and
+ *  O(size log size) in the worst case; the order is not stable.
+ * @hideinitializer
+ */
+#define AB_vec_nth_element(vec, nth, cmp)                                                          \
+    (AB_VEC_CHECK((vec) != NULL), AB_VEC_CHECK_BOUNDS((size_t)(nth) < (vec)->num),                 \
+     AB_VEC_CHECK((cmp) != NULL || sizeof(*(vec)->elems) == 4 || sizeof(*(vec)->elems) == 8),      \
+     AB_vec_select_kernel((char *)(vec)->elems, (vec)->num, (nth), sizeof(*(vec)->elems), (cmp)))
+
+static AB_VEC_INLINE void
+AB_vec_partial_sort_kernel(char *base, size_t n, size_t k, size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    size_t i;
+    if (k > n)
+        k = n;
+    if (k == 0)
+        return;
+    if (k < n)
+        AB_vec_select_kernel(base, n, k - 1, elem_size, cmp);
+    for (i = k / 2; i-- > 0;)
+        AB_vec_heap_sift_down(base, k, i, elem_size, cmp, 0);
+    AB_vec_heap_sort(base, k, elem_size, cmp, 0);
+}
+/** @brief Sort the smallest @c k elements of a vector into its front
+ * @param vec Pointer to the AB_vec
+ * @param k Number of elements to sort, clamped to the size
+ * @param cmp An @c AB_vec_cmp_fn, or NULL for 4- or 8-byte unsigned integers
+ * @note The remaining elements are left in unspecified order. Runs in
+ *  O(size + k log k) time on average.
+ * @hideinitializer
+ */
+#define AB_vec_partial_sort(vec, k, cmp)                                                           \
+    (AB_VEC_CHECK((vec) != NULL),                                                                  \
+     AB_VEC_CHECK((cmp) != NULL || sizeof(*(vec)->elems) == 4 || sizeof(*(vec)->elems) == 8),      \
+     AB_vec_partial_sort_kernel((char *)(vec)->elems, (vec)->num, (k), sizeof(*(vec)->elems),      \
+         (cmp)))
+
+/* Index of the first element of [i, n) that sorts after *t, or n. Numeric
+ * keys are tested a block at a time so the common case of a full heap
+ * rejecting everything costs a few instructions per element. */
+static AB_VEC_INLINE size_t
+AB_vec_topk_skip(const char *base, size_t i, size_t n, const char *t,
+        size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    if (cmp == NULL && elem_size == 4) {
+        const uint32_t *p = (const uint32_t *)base;
+        uint32_t tv;
+        memcpy(&tv, t, 4);
+#if defined(__SSE2__)
+        {
+            /* No unsigned compare in SSE2: flip the sign bits instead */
+            const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+            const __m128i th = _mm_xor_si128(_mm_set1_epi32((int)tv), bias);
+            for (; i + 16 <= n; i += 16) {
+                const __m128i *v = (const __m128i *)(p + i);
+                __m128i m0 = _mm_xor_si128(_mm_loadu_si128(v), bias);
+                __m128i m1 = _mm_xor_si128(_mm_loadu_si128(v + 1), bias);
+                __m128i m2 = _mm_xor_si128(_mm_loadu_si128(v + 2), bias);
+                __m128i m3 = _mm_xor_si128(_mm_loadu_si128(v + 3), bias);
+                m0 = _mm_or_si128(_mm_cmpgt_epi32(m0, th), _mm_cmpgt_epi32(m1, th));
+                m2 = _mm_or_si128(_mm_cmpgt_epi32(m2, th), _mm_cmpgt_epi32(m3, th));
+                if (_mm_movemask_epi8(_mm_or_si128(m0, m2)))
+                    break;
+            }
+        }
+#endif
+        while (i < n && p[i] <= tv)
+            i++;
+        return i;
+    }
+    if (cmp == NULL) {
+        const uint64_t *p = (const uint64_t *)base;
+        uint64_t tv;
+        memcpy(&tv, t, 8);
+        for (; i + 8 <= n; i += 8) {
+            int any = 0, j;
+            for (j = 0; j < 8; j++)
+                any |= p[i + j] > tv;
+            if (any)
+                break;
+        }
+        while (i < n && p[i] <= tv)
+            i++;
+        return i;
+    }
+    while (i < n && !AB_vec_cmp_less(t, base + i * elem_size, elem_size, cmp))
+        i++;
+    return i;
+}
+
+static AB_VEC_INLINE int
+AB_vec_topk_generic(struct AB_vector_generic *heap, const struct AB_vector_generic *src,
+        size_t k, size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    const char *in;
+    size_t i = 0, n;
+
+    AB_VEC_CHECK(heap != NULL && src != NULL && heap != src);
+    AB_VEC_CHECK(cmp != NULL || elem_size == 4 || elem_size == 8);
+    AB_VEC_CHECK_BOUNDS(heap->num <= k);
+    if (AB_vec_reserve_generic(heap, (AB_VEC_SIZE_T)k, (AB_VEC_SIZE_T)elem_size))
+        return 1;
+    in = src->elems;
+    n = src->num;
+
+    /* Fill the min-heap, then only elements beating its root get in */
+    for (; heap->num < k && i < n; i++) {
+        memcpy((char *)heap->elems + heap->num * elem_size, in + i * elem_size, elem_size);
+        AB_vec_heap_sift_up(heap->elems, heap->num++, elem_size, cmp, 1);
+    }
+    if (k == 0)
+        return 0;
+    for (;;) {
+        i = AB_vec_topk_skip(in, i, n, heap->elems, elem_size, cmp);
+        if (i == n)
+            return 0;
+        memcpy(heap->elems, in + i * elem_size, elem_size);
+        AB_vec_heap_sift_down(heap->elems, k, 0, elem_size, cmp, 1);
+        i++;
+    }
+}
+/** @brief Feed a span of elements into a streaming top-k selection
+ * @param heap Pointer to the AB_vec holding the selection state. Start
+ *  with an empty vector and pass it to every call for the same stream.
+ * @param [in] src Const pointer to the next span, an AB_vec of the same type
+ * @param k Number of greatest elements to keep; the same on every call
+ * @param cmp An @c AB_vec_cmp_fn, or NULL for 4- or 8-byte unsigned integers
+ * @return 0 on success, nonzero on error
+ * @note @c heap is a min-heap of at most @c k elements, so memory stays
+ *  O(k) however long the stream. Once it is full, numeric keys are
+ *  compared against its root in SIMD blocks and most spans are rejected
+ *  without touching the heap. Use @c AB_vec_topk_sort() to read it out.
+ * @hideinitializer
+ */
+#define AB_vec_topk(heap, src, k, cmp)                                                             \
+    ((void)sizeof(char[sizeof(*(heap)->elems) == sizeof(*(src)->elems) ? 1 : -1]),                 \
+     AB_vec_topk_generic((struct AB_vector_generic *)(heap),                                       \
+         (const struct AB_vector_generic *)(src), (k), sizeof(*(heap)->elems), (cmp)))
+
+/** @brief Finish a top-k selection, sorting it from greatest to least
+ * @param heap Pointer to the AB_vec filled by @c AB_vec_topk()
+ * @param cmp The comparator passed to @c AB_vec_topk()
+ * @note The vector is no longer a heap afterwards
+ * @hideinitializer
+ */
+#define AB_vec_topk_sort(heap, cmp)                                                                \
+    (AB_VEC_CHECK((heap) != NULL),                                                                 \
+     AB_vec_heap_sort((char *)(heap)->elems, (heap)->num, sizeof(*(heap)->elems), (cmp), 1))
+
+#endif /* AMBER_UTIL_VECTOR_ALGO_H */
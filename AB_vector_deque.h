@@ -0,0 +1,419 @@
+/** @file AB_vector_deque.h
+ * @brief Lock-free work-stealing deque (Chase-Lev) with epoch reclamation
+ *
+ * The deque has one owner thread, which pushes and pops at the bottom, and
+ * any number of thieves, which steal from the top. Only the owner may grow
+ * the deque, and thieves never take a lock, so the common owner operations
+ * are a handful of plain loads and stores plus one fence. The algorithm and
+ * its memory orderings follow Lê, Pop, Cohen and Zappa Nardelli, "Correct
+ * and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+ *
+ * The ring buffer is allocated through @c AB_VEC_REALLOC and released with
+ * @c AB_VEC_FREE, just like an AB_vec. When it grows, the old buffer may
+ * still be read by a thief, so it is retired rather than freed. Retired
+ * buffers are freed once an @c AB_epoch domain shared by all thieves shows
+ * that no steal which could have seen them is still in flight. Without an
+ * epoch domain retired buffers are kept until @c AB_deque_destroy(), which
+ * bounds the overhead to the size of the live buffer.
+ *
+ * Elements are copied with @c memcpy and must be trivially copyable. A thief
+ * may read a slot while the owner overwrites it after wrapping; such a read
+ * is always discarded because the thief's CAS on @c top then fails.
+ *
+ * This header requires the GCC-style @c __atomic builtins.
+ */
+#ifndef AMBER_UTIL_VECTOR_DEQUE_H
+#define AMBER_UTIL_VECTOR_DEQUE_H
+
+#include "AB_vector.h"
+
+#if !defined(__GNUC__) && !defined(__DOXYGEN__)
+# error "AB_vector_deque.h requires GCC-style __atomic builtins"
+#endif
+
+/** @brief Cache line size in bytes
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_CACHELINE
+# define AB_VEC_CACHELINE 64
+#endif
+
+/**************************************************************************
+ *
+ * Epoch-based reclamation
+ *
+ *************************************************************************/
+
+/** @cond false */
+struct AB_epoch_slot {
+    size_t epoch;
+    char pad[AB_VEC_CACHELINE - sizeof(size_t)];
+};
+/** @endcond */
+
+/** @brief Epoch domain shared by all threads that may steal from a deque
+ *
+ * Each participating thread owns one slot. A slot holds 0 while its thread
+ * is quiescent, and the global epoch observed on entry while it is inside
+ * a critical section.
+ */
+typedef struct AB_epoch {
+    /** @cond false */
+    size_t global;
+    char pad[AB_VEC_CACHELINE - sizeof(size_t)];
+    AB_vec(struct AB_epoch_slot) slots;
+    /** @endcond */
+} AB_epoch;
+
+/** @brief Initialize an epoch domain
+ * @param epoch Pointer to an uninitialized AB_epoch
+ * @param nslots Number of participating threads
+ * @return 0 on success, nonzero on error
+ */
+static AB_VEC_INLINE int
+AB_epoch_init(AB_epoch *epoch, unsigned nslots)
+{
+    unsigned i;
+    AB_VEC_ASSERT(epoch != NULL);
+    epoch->global = 1;
+    AB_vec_init(&epoch->slots);
+    if (nslots != 0 && AB_vec_resize(&epoch->slots, nslots))
+        return 1;
+    for (i = 0; i < nslots; i++)
+        epoch->slots.elems[i].epoch = 0;
+    epoch->slots.num = nslots;
+    return 0;
+}
+
+/** @brief Free memory associated with an epoch domain
+ * @param epoch Pointer to an AB_epoch
+ */
+static AB_VEC_INLINE void
+AB_epoch_destroy(AB_epoch *epoch)
+{
+    AB_VEC_ASSERT(epoch != NULL);
+    AB_vec_destroy(&epoch->slots);
+}
+
+/** @brief Enter a critical section, pinning every buffer reachable now
+ * @param epoch Pointer to an AB_epoch
+ * @param slot The calling thread's slot index
+ */
+static AB_VEC_INLINE void
+AB_epoch_enter(AB_epoch *epoch, unsigned slot)
+{
+    size_t e = __atomic_load_n(&epoch->global, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&epoch->slots.elems[slot].epoch, e, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Leave a critical section
+ * @param epoch Pointer to an AB_epoch
+ * @param slot The calling thread's slot index
+ */
+static AB_VEC_INLINE void
+AB_epoch_exit(AB_epoch *epoch, unsigned slot)
+{
+    __atomic_store_n(&epoch->slots.elems[slot].epoch, 0, __ATOMIC_RELEASE);
+}
+
+/** @brief Advance the global epoch after unlinking an object
+ * @param epoch Pointer to an AB_epoch
+ * @return The epoch to tag the unlinked object with
+ */
+static AB_VEC_INLINE size_t
+AB_epoch_retire(AB_epoch *epoch)
+{
+    return __atomic_fetch_add(&epoch->global, 1, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Check whether an object retired at a given epoch can be freed
+ * @param epoch Pointer to an AB_epoch
+ * @param retired The value returned by @c AB_epoch_retire()
+ * @return Nonzero if no thread can still hold a reference
+ */
+static AB_VEC_INLINE int
+AB_epoch_safe(AB_epoch *epoch, size_t retired)
+{
+    AB_VEC_SIZE_T i;
+    for (i = 0; i < epoch->slots.num; i++) {
+        size_t e = __atomic_load_n(&epoch->slots.elems[i].epoch, __ATOMIC_SEQ_CST);
+        if (e != 0 && e <= retired)
+            return 0;
+    }
+    return 1;
+}
+
+/**************************************************************************
+ *
+ * Deque
+ *
+ *************************************************************************/
+
+/** @brief Return values of @c AB_deque_pop() and @c AB_deque_steal() */
+enum {
+    AB_DEQUE_OK = 0,    /**< An element was taken */
+    AB_DEQUE_EMPTY = 1, /**< The deque was empty */
+    AB_DEQUE_ABORT = 2  /**< A thief lost a race, the deque may be non-empty */
+};
+
+/** @cond false */
+struct AB_deque_buffer {
+    struct AB_deque_buffer *next;
+    size_t retired_at;
+    size_t capacity;
+    void *elems;
+};
+
+struct AB_deque_generic {
+    ptrdiff_t top;
+    char pad0[AB_VEC_CACHELINE - sizeof(ptrdiff_t)];
+    ptrdiff_t bottom;
+    struct AB_deque_buffer *buffer;
+    struct AB_deque_buffer *retired;
+    AB_epoch *epoch;
+#ifdef AB_VEC_INCLUDE_USERDATA
+    void *userdata;
+#endif
+    char pad1[AB_VEC_CACHELINE];
+};
+
+#ifdef AB_VEC_INCLUDE_USERDATA
+# define AB_DEQUE_REALLOC_(dq, ptr, old_size, new_size) \
+    AB_VEC_REALLOC(ptr, old_size, new_size, (dq)->userdata)
+# define AB_DEQUE_FREE_(dq, ptr, size) AB_VEC_FREE(ptr, size, (dq)->userdata)
+#else
+# define AB_DEQUE_REALLOC_(dq, ptr, old_size, new_size) AB_VEC_REALLOC(ptr, old_size, new_size)
+# define AB_DEQUE_FREE_(dq, ptr, size) AB_VEC_FREE(ptr, size)
+#endif
+/** @endcond */
+
+/** @brief Anonymous type for a deque of the given element type
+ * @param type The element type
+ */
+#define AB_deque(type)                                                                             \
+    union { struct AB_deque_generic impl; type *elem_type; }
+
+static AB_VEC_INLINE void
+AB_deque_init_generic(struct AB_deque_generic *dq, AB_epoch *epoch)
+{
+    AB_VEC_ASSERT(dq != NULL);
+    dq->top = dq->bottom = 0;
+    dq->buffer = dq->retired = NULL;
+    dq->epoch = epoch;
+#ifdef AB_VEC_INCLUDE_USERDATA
+    dq->userdata = NULL;
+#endif
+}
+/** @brief Initialize a deque
+ * @param dq Pointer to an AB_deque
+ * @param epoch Pointer to the AB_epoch shared by all thieves, or NULL to
+ *  defer freeing grown-out buffers until the deque is destroyed
+ * @hideinitializer
+ */
+#define AB_deque_init(dq, epoch) AB_deque_init_generic(&(dq)->impl, (epoch))
+
+#if defined(AB_VEC_INCLUDE_USERDATA) || defined(__DOXYGEN__)
+/** @brief Access a deque's userdata
+ * @param dq Pointer to an AB_deque
+ * @return The @c userdata field (as lvalue)
+ * @note Only available when @c AB_VEC_INCLUDE_USERDATA is set
+ * @hideinitializer
+ */
+# define AB_deque_userdata(dq) (*(AB_VEC_ASSERT((dq) != NULL), &(dq)->impl.userdata))
+#endif
+
+static AB_VEC_INLINE void
+AB_deque_free_buffer(struct AB_deque_generic *dq, struct AB_deque_buffer *buf, size_t elem_size)
+{
+    (void)dq;
+    (void)elem_size;
+    AB_DEQUE_FREE_(dq, buf->elems, buf->capacity * elem_size);
+    AB_DEQUE_FREE_(dq, buf, sizeof(*buf));
+}
+
+/* Free every retired buffer no thief can still be reading */
+static AB_VEC_INLINE void
+AB_deque_reclaim(struct AB_deque_generic *dq, size_t elem_size)
+{
+    struct AB_deque_buffer **link = &dq->retired;
+    if (dq->epoch == NULL)
+        return;
+    while (*link != NULL) {
+        struct AB_deque_buffer *buf = *link;
+        if (AB_epoch_safe(dq->epoch, buf->retired_at)) {
+            *link = buf->next;
+            AB_deque_free_buffer(dq, buf, elem_size);
+        } else {
+            link = &buf->next;
+        }
+    }
+}
+
+static AB_VEC_INLINE struct AB_deque_buffer *
+AB_deque_grow(struct AB_deque_generic *dq, ptrdiff_t top, ptrdiff_t bottom, size_t elem_size)
+{
+    struct AB_deque_buffer *old = dq->buffer, *buf;
+    size_t capacity = old != NULL ? old->capacity << 1 : 32;
+    ptrdiff_t i;
+
+    buf = AB_DEQUE_REALLOC_(dq, NULL, 0, sizeof(*buf));
+    AB_VEC_ASSERT(buf != NULL);
+    if (buf == NULL)
+        return NULL;
+    buf->capacity = capacity;
+    buf->elems = AB_DEQUE_REALLOC_(dq, NULL, 0, capacity * elem_size);
+    AB_VEC_ASSERT(buf->elems != NULL);
+    if (buf->elems == NULL) {
+        AB_DEQUE_FREE_(dq, buf, sizeof(*buf));
+        return NULL;
+    }
+    for (i = top; i < bottom; i++) {
+        memcpy((char *)buf->elems + ((size_t)i & (capacity - 1)) * elem_size,
+                (char *)old->elems + ((size_t)i & (old->capacity - 1)) * elem_size,
+                elem_size);
+    }
+    __atomic_store_n(&dq->buffer, buf, __ATOMIC_SEQ_CST);
+
+    if (old != NULL) {
+        old->retired_at = dq->epoch != NULL ? AB_epoch_retire(dq->epoch) : 0;
+        old->next = dq->retired;
+        dq->retired = old;
+        AB_deque_reclaim(dq, elem_size);
+    }
+    return buf;
+}
+
+static AB_VEC_INLINE void
+AB_deque_destroy_generic(struct AB_deque_generic *dq, size_t elem_size)
+{
+    AB_VEC_ASSERT(dq != NULL);
+    while (dq->retired != NULL) {
+        struct AB_deque_buffer *buf = dq->retired;
+        dq->retired = buf->next;
+        AB_deque_free_buffer(dq, buf, elem_size);
+    }
+    if (dq->buffer != NULL)
+        AB_deque_free_buffer(dq, dq->buffer, elem_size);
+    dq->buffer = NULL;
+}
+/** @brief Free memory associated with a deque
+ * @param dq Pointer to an AB_deque
+ * @note No thief may be using the deque
+ * @hideinitializer
+ */
+#define AB_deque_destroy(dq) AB_deque_destroy_generic(&(dq)->impl, sizeof(*(dq)->elem_type))
+
+static AB_VEC_INLINE int
+AB_deque_push_generic(struct AB_deque_generic *dq, const void *elem, size_t elem_size)
+{
+    ptrdiff_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+    ptrdiff_t t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+    struct AB_deque_buffer *buf = dq->buffer;
+
+    if (buf == NULL || (size_t)(b - t) >= buf->capacity) {
+        buf = AB_deque_grow(dq, t, b, elem_size);
+        if (buf == NULL)
+            return 1;
+    }
+    memcpy((char *)buf->elems + ((size_t)b & (buf->capacity - 1)) * elem_size, elem, elem_size);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    return 0;
+}
+/** @brief Push an element at the bottom of the deque (owner only)
+ * @param dq Pointer to an AB_deque
+ * @param elem Pointer to the element to copy in
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#define AB_deque_push(dq, elem)                                                                    \
+    AB_deque_push_generic(&(dq)->impl, (const void *)(1 ? (elem) : (dq)->elem_type),               \
+            sizeof(*(dq)->elem_type))
+
+static AB_VEC_INLINE int
+AB_deque_pop_generic(struct AB_deque_generic *dq, void *out, size_t elem_size)
+{
+    ptrdiff_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1;
+    struct AB_deque_buffer *buf = dq->buffer;
+    ptrdiff_t t;
+    int result = AB_DEQUE_OK;
+
+    __atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+
+    if (t > b) {
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+        return AB_DEQUE_EMPTY;
+    }
+    memcpy(out, (char *)buf->elems + ((size_t)b & (buf->capacity - 1)) * elem_size, elem_size);
+    if (t == b) {
+        /* Last element: race the thieves for it */
+        if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, 0,
+                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            result = AB_DEQUE_EMPTY;
+        __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+/** @brief Pop an element from the bottom of the deque (owner only)
+ * @param dq Pointer to an AB_deque
+ * @param [out] out Pointer to storage for the element
+ * @return @c AB_DEQUE_OK or @c AB_DEQUE_EMPTY
+ * @hideinitializer
+ */
+#define AB_deque_pop(dq, out)                                                                      \
+    AB_deque_pop_generic(&(dq)->impl, (void *)(1 ? (out) : (dq)->elem_type),                       \
+            sizeof(*(dq)->elem_type))
+
+static AB_VEC_INLINE int
+AB_deque_steal_generic(struct AB_deque_generic *dq, void *out, size_t elem_size, unsigned slot)
+{
+    ptrdiff_t t, b;
+    int result = AB_DEQUE_EMPTY;
+
+    if (dq->epoch != NULL)
+        AB_epoch_enter(dq->epoch, slot);
+    t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+    if (t < b) {
+        struct AB_deque_buffer *buf = __atomic_load_n(&dq->buffer, __ATOMIC_ACQUIRE);
+        memcpy(out, (char *)buf->elems + ((size_t)t & (buf->capacity - 1)) * elem_size, elem_size);
+        result = __atomic_compare_exchange_n(&dq->top, &t, t + 1, 0,
+                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED) ? AB_DEQUE_OK : AB_DEQUE_ABORT;
+    }
+    if (dq->epoch != NULL)
+        AB_epoch_exit(dq->epoch, slot);
+    return result;
+}
+/** @brief Steal an element from the top of the deque (any thread)
+ * @param dq Pointer to an AB_deque
+ * @param [out] out Pointer to storage for the element
+ * @param slot The calling thread's slot in the deque's AB_epoch, ignored
+ *  if the deque has none
+ * @return @c AB_DEQUE_OK, @c AB_DEQUE_EMPTY, or @c AB_DEQUE_ABORT if another
+ *  thread took the element first
+ * @hideinitializer
+ */
+#define AB_deque_steal(dq, out, slot)                                                              \
+    AB_deque_steal_generic(&(dq)->impl, (void *)(1 ? (out) : (dq)->elem_type),                     \
+            sizeof(*(dq)->elem_type), (slot))
+
+/** @brief Estimate the number of elements in a deque
+ * @param dq Pointer to an AB_deque
+ * @return The size at some recent point in time
+ * @hideinitializer
+ */
+#define AB_deque_size(dq)                                                                          \
+    AB_deque_size_generic(&(dq)->impl)
+
+static AB_VEC_INLINE size_t
+AB_deque_size_generic(struct AB_deque_generic *dq)
+{
+    ptrdiff_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+    ptrdiff_t t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+    return b > t ? (size_t)(b - t) : 0;
+}
+
+#endif /* AMBER_UTIL_VECTOR_DEQUE_H */
@@ -0,0 +1,143 @@
+/** @file AB_vector_hash.h
+ * @brief Fast seedable hashing of AB_vec contents
+ *
+ * @c AB_vec_hash() hashes the bytes of @c elems[0..num) with the final
+ * version of wyhash (Wang Yi, public domain). Inputs of 48 bytes and more
+ * are consumed by three independent multiply-mix lanes, which keeps the
+ * 64x64->128 bit multipliers of modern CPUs busy without SIMD. Short inputs
+ * take a branch-light path, so small vectors hash in a few nanoseconds.
+ *
+ * The hash is not cryptographic and must not be used where an attacker
+ * picks the keys without a secret seed. As with @c AB_vec_equal(), element
+ * types must not contain padding bytes. Words are read little-endian
+ * through @c memcpy, so big-endian hosts produce different values.
+ *
+ * This header requires C99 (for stdint.h).
+ */
+#ifndef AMBER_UTIL_VECTOR_HASH_H
+#define AMBER_UTIL_VECTOR_HASH_H
+
+#include "AB_vector.h"
+#include <stdint.h>
+
+/** @cond false */
+static const uint64_t AB_vec_hash_secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+/** @endcond */
+
+/* Full 64x64->128 bit product, low half in *a and high half in *b */
+static AB_VEC_INLINE void
+AB_vec_hash_mum_portable(uint64_t *a, uint64_t *b)
+{
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), lo, c = t < rl;
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+}
+
+static AB_VEC_INLINE void
+AB_vec_hash_mum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    AB_vec_hash_mum_portable(a, b);
+#endif
+}
+
+static AB_VEC_INLINE uint64_t
+AB_vec_hash_mix(uint64_t a, uint64_t b)
+{
+    AB_vec_hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static AB_VEC_INLINE uint64_t
+AB_vec_hash_r8(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static AB_VEC_INLINE uint64_t
+AB_vec_hash_r4(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/** @brief Hash @c len bytes starting at @c key
+ * @param key Pointer to the data, may be NULL if @c len is 0
+ * @param len Number of bytes to hash
+ * @param seed Any 64-bit value; different seeds give unrelated hashes
+ * @return The 64-bit hash
+ */
+static AB_VEC_INLINE uint64_t
+AB_vec_hash_bytes(const void *key, size_t len, uint64_t seed)
+{
+    const uint64_t *s = AB_vec_hash_secret;
+    const unsigned char *p = key;
+    uint64_t a, b;
+
+    seed ^= AB_vec_hash_mix(seed ^ s[0], s[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t k = (len >> 3) << 2;
+            a = (AB_vec_hash_r4(p) << 32) | AB_vec_hash_r4(p + k);
+            b = (AB_vec_hash_r4(p + len - 4) << 32) | AB_vec_hash_r4(p + len - 4 - k);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i >= 48) {
+            /* Three independent lanes so the multiplies overlap */
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = AB_vec_hash_mix(AB_vec_hash_r8(p) ^ s[1], AB_vec_hash_r8(p + 8) ^ seed);
+                see1 = AB_vec_hash_mix(AB_vec_hash_r8(p + 16) ^ s[2], AB_vec_hash_r8(p + 24) ^ see1);
+                see2 = AB_vec_hash_mix(AB_vec_hash_r8(p + 32) ^ s[3], AB_vec_hash_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = AB_vec_hash_mix(AB_vec_hash_r8(p) ^ s[1], AB_vec_hash_r8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        /* The last 16 bytes, overlapping earlier ones if needed */
+        a = AB_vec_hash_r8(p + i - 16);
+        b = AB_vec_hash_r8(p + i - 8);
+    }
+    a ^= s[1];
+    b ^= seed;
+    AB_vec_hash_mum(&a, &b);
+    return AB_vec_hash_mix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+/** @brief Hash the elements of a vector
+ * @param vec Const pointer to an AB_vec
+ * @param seed Any 64-bit value; different seeds give unrelated hashes
+ * @return The 64-bit hash of the bytes of @c elems[0..num)
+ * @note Vectors that compare equal with @c AB_vec_equal() hash equal.
+ *  Capacity and userdata are not part of the hash.
+ * @hideinitializer
+ */
+#define AB_vec_hash(vec, seed)                                                                     \
+    AB_vec_hash_bytes((vec)->elems, (size_t)(vec)->num * sizeof(*(vec)->elems), (seed))
+
+#endif /* AMBER_UTIL_VECTOR_HASH_H */
@@ -0,0 +1,320 @@
+/** @file AB_vector_incremental.h
+ * @brief A vector whose growth never copies more than a few KiB per push
+ *
+ * When an AB_vec is full, @c AB_vec_push() reallocates and copies every
+ * element before it returns, so the push that crosses a gigabyte boundary
+ * takes hundreds of milliseconds. An @c AB_ivec spreads that copy out the
+ * way Redis rehashes its dictionaries incrementally: growth allocates the
+ * new buffer and keeps the old one, and every later push moves
+ * @c AB_VEC_INCREMENTAL_STEP bytes of old elements across. The move is
+ * always done before the new buffer fills up, so at most two buffers are
+ * alive at a time.
+ *
+ * While elements are being moved, @c AB_ivec_at() picks the buffer that
+ * holds the index, which costs one extra compare per access. Pointers to
+ * elements are invalidated by every push during a move, not only by
+ * growth. Small vectors grow with a plain reallocation. Freeing the old
+ * buffer once the move is done still costs what the allocator needs to
+ * return its pages, a few milliseconds per hundred megabytes.
+ *
+ * This mostly helps with allocators that copy on every reallocation. The
+ * glibc @c realloc already moves large blocks by remapping their pages.
+ *
+ * Macro-options (besides those of AB_vector.h):
+ *  - AB_VEC_INCREMENTAL_STEP
+ *    Bytes moved to the new buffer per push. Defaults to 4096. At least one
+ *    element is moved per push, whatever the element size.
+ *
+ *  - AB_VEC_INCREMENTAL_MIN
+ *    Buffers smaller than this many bytes grow with a single reallocation.
+ *    Defaults to 256 KiB.
+ *
+ * Storage goes through @c AB_VEC_REALLOC, which has to accept a NULL
+ * pointer like @c realloc does, and @c AB_VEC_FREE.
+ */
+#ifndef AMBER_UTIL_VECTOR_INCREMENTAL_H
+#define AMBER_UTIL_VECTOR_INCREMENTAL_H
+
+#include "AB_vector.h"
+
+/** @brief Bytes of old elements moved per push while growing
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_INCREMENTAL_STEP
+# define AB_VEC_INCREMENTAL_STEP 4096
+#endif
+
+/** @brief Buffers below this size in bytes grow with one reallocation
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_INCREMENTAL_MIN
+# define AB_VEC_INCREMENTAL_MIN (256 * 1024)
+#endif
+
+/** @cond false */
+/* Elements [moved, old_num) are still in old; all others are in elems */
+struct AB_VEC_MAY_ALIAS AB_ivector_generic {
+    AB_VEC_SIZE_T num, capacity;
+    void *elems;
+#ifdef AB_VEC_INCLUDE_USERDATA
+    void *userdata;
+#endif
+    void *old;
+    AB_VEC_SIZE_T old_num, old_capacity, moved;
+};
+/** @endcond */
+
+/** @brief Anonymous structure used for AB_ivec functions
+ * @param type The element type
+ */
+#ifdef AB_VEC_INCLUDE_USERDATA
+# define AB_ivec(type)                                                                             \
+    struct {                                                                                       \
+        AB_VEC_SIZE_T num, capacity; type *elems; void *userdata;                                  \
+        type *old; AB_VEC_SIZE_T old_num, old_capacity, moved;                                     \
+    }
+#else
+# define AB_ivec(type)                                                                             \
+    struct {                                                                                       \
+        AB_VEC_SIZE_T num, capacity; type *elems;                                                  \
+        type *old; AB_VEC_SIZE_T old_num, old_capacity, moved;                                     \
+    }
+#endif
+
+/** @brief Initializer list for an AB_ivec */
+#ifdef AB_VEC_INCLUDE_USERDATA
+# define AB_IVEC_INIT { 0, 0, NULL, NULL, NULL, 0, 0, 0 }
+#else
+# define AB_IVEC_INIT { 0, 0, NULL, NULL, 0, 0, 0 }
+#endif
+
+/** @brief Initialize an AB_ivec
+ * @param vec Pointer to an AB_ivec structure
+ */
+#define AB_ivec_init(vec) do {                                                                     \
+    AB_vec_init(vec);                                                                              \
+    (vec)->old = NULL;                                                                             \
+    (vec)->old_num = (vec)->old_capacity = (vec)->moved = 0;                                       \
+} while (0)
+
+static AB_VEC_INLINE void
+AB_ivec_free_old(struct AB_ivector_generic *vec, AB_VEC_SIZE_T elem_size)
+{
+#ifdef AB_VEC_INCLUDE_USERDATA
+    AB_VEC_FREE(vec->old, elem_size * vec->old_capacity, vec->userdata);
+#else
+    AB_VEC_FREE(vec->old, elem_size * vec->old_capacity);
+#endif
+    (void)elem_size;
+    vec->old = NULL;
+    vec->old_num = vec->old_capacity = vec->moved = 0;
+}
+
+/* Move up to max elements from the old buffer */
+static AB_VEC_INLINE void
+AB_ivec_migrate(struct AB_ivector_generic *vec, AB_VEC_SIZE_T max, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_SIZE_T k = vec->old_num - vec->moved;
+    if (k > max)
+        k = max;
+    memcpy((char *)vec->elems + elem_size * vec->moved,
+            (const char *)vec->old + elem_size * vec->moved, elem_size * k);
+    vec->moved += k;
+    if (vec->moved == vec->old_num)
+        AB_ivec_free_old(vec, elem_size);
+}
+
+static AB_VEC_COLD void
+AB_ivec_step_generic(struct AB_ivector_generic *vec, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_SIZE_T step = AB_VEC_INCREMENTAL_STEP / elem_size;
+    AB_ivec_migrate(vec, step > 0 ? step : 1, elem_size);
+}
+
+/** @brief Finish moving elements out of the old buffer
+ * @param vec Pointer to an AB_ivec
+ * @note Afterwards @c elems holds every element, like an AB_vec
+ * @hideinitializer
+ */
+#define AB_ivec_finish(vec)                                                                        \
+    ((vec)->old != NULL ? AB_ivec_migrate((struct AB_ivector_generic *)(vec), (vec)->old_num,      \
+        sizeof(*(vec)->elems)) : (void)0)
+
+static AB_VEC_COLD int
+AB_ivec_grow_generic(struct AB_ivector_generic *vec, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_SIZE_T cap = vec->capacity ? vec->capacity << 1 : 2;
+    void *new_elems;
+
+    if (vec->old != NULL)
+        AB_ivec_migrate(vec, vec->old_num, elem_size);
+    if ((size_t)elem_size * vec->capacity < AB_VEC_INCREMENTAL_MIN)
+        return AB_vec_resize_generic((struct AB_vector_generic *)vec, cap, elem_size);
+#ifdef AB_VEC_INCLUDE_USERDATA
+    new_elems = AB_VEC_REALLOC(NULL, 0, elem_size * cap, vec->userdata);
+#else
+    new_elems = AB_VEC_REALLOC(NULL, 0, elem_size * cap);
+#endif
+    AB_VEC_ASSERT(new_elems != NULL);
+    if (new_elems == NULL)
+        return 1;
+    vec->old = vec->elems;
+    vec->old_num = vec->num;
+    vec->old_capacity = vec->capacity;
+    vec->moved = 0;
+    vec->elems = new_elems;
+    vec->capacity = cap;
+    return 0;
+}
+
+static AB_VEC_INLINE void *
+AB_ivec_pushp_generic(struct AB_ivector_generic *vec, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    AB_VEC_ASSUME(vec->num <= vec->capacity);
+    if (AB_VEC_UNLIKELY(vec->num == vec->capacity) && AB_ivec_grow_generic(vec, elem_size))
+        return NULL;
+    if (AB_VEC_UNLIKELY(vec->old != NULL))
+        AB_ivec_step_generic(vec, elem_size);
+    return (char *)vec->elems + elem_size * vec->num++;
+}
+
+static AB_VEC_INLINE int
+AB_ivec_push_generic(struct AB_ivector_generic *vec, const void *elem, AB_VEC_SIZE_T elem_size)
+{
+    void *slot = AB_ivec_pushp_generic(vec, elem_size);
+    if (AB_VEC_UNLIKELY(slot == NULL))
+        return 1;
+    memcpy(slot, elem, elem_size);
+    return 0;
+}
+
+static AB_VEC_INLINE void *
+AB_ivec_at_generic(const struct AB_ivector_generic *vec, size_t idx, size_t elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    AB_VEC_CHECK_BOUNDS(idx < vec->num);
+    /* Both differences wrap around unless moved <= idx < old_num */
+    return (char *)((size_t)(idx - vec->moved) < (size_t)(vec->old_num - vec->moved)
+            ? vec->old : vec->elems) + elem_size * idx;
+}
+
+static AB_VEC_INLINE void *
+AB_ivec_pop_generic(struct AB_ivector_generic *vec, size_t elem_size)
+{
+    AB_VEC_SIZE_T i;
+    AB_VEC_CHECK(vec != NULL);
+    AB_VEC_CHECK(vec->num > 0);
+    i = --vec->num;
+    /* The popped element is returned from the new buffer, and the rest of
+     * the old buffer past the end no longer needs moving */
+    if (i >= vec->moved && i < vec->old_num) {
+        memcpy((char *)vec->elems + elem_size * i, (const char *)vec->old + elem_size * i,
+                elem_size);
+        vec->old_num = i;
+        if (vec->moved == vec->old_num)
+            AB_ivec_free_old(vec, (AB_VEC_SIZE_T)elem_size);
+    }
+    return (char *)vec->elems + elem_size * i;
+}
+
+/** @brief Free memory associated with an AB_ivec
+ * @param vec Pointer to the AB_ivec
+ * @hideinitializer
+ */
+#define AB_ivec_destroy(vec)                                                                       \
+    ((vec)->old != NULL                                                                            \
+        ? AB_ivec_free_old((struct AB_ivector_generic *)(vec), sizeof(*(vec)->elems)) : (void)0,   \
+     AB_vec_destroy(vec))
+
+/** @brief Query the number of elements in the vector
+ * @param vec Pointer to the AB_ivec
+ * @return The number of elements
+ * @hideinitializer
+ */
+#define AB_ivec_size(vec) AB_vec_size(vec)
+
+/** @brief Query the current capacity of the vector
+ * @param vec Pointer to the AB_ivec
+ * @return The number of elements storable before the next growth
+ * @hideinitializer
+ */
+#define AB_ivec_max(vec) AB_vec_max(vec)
+
+/** @brief Check whether elements are still being moved after a growth
+ * @param vec Pointer to the AB_ivec
+ * @return Nonzero while the old buffer is alive
+ * @hideinitializer
+ */
+#define AB_ivec_migrating(vec) ((vec)->old != NULL)
+
+/** @brief Access an element at a given index
+ * @param vec Pointer to the AB_ivec
+ * @param idx Index to access
+ * @return The element at that index, as an lvalue in whichever buffer
+ *  currently holds it
+ * @hideinitializer
+ */
+#ifdef AB_VEC_TYPEOF
+# define AB_ivec_at(vec, idx)                                                                      \
+    (*(AB_VEC_TYPEOF((vec)->elems))AB_ivec_at_generic(                                             \
+        (const struct AB_ivector_generic *)(vec), (idx), sizeof(*(vec)->elems)))
+#else
+# define AB_ivec_at(vec, idx)                                                                      \
+    (*(AB_VEC_CHECK((vec) != NULL), AB_VEC_CHECK_BOUNDS((size_t)(idx) < (vec)->num),               \
+       (size_t)((idx) - (vec)->moved) < (size_t)((vec)->old_num - (vec)->moved)                    \
+           ? &(vec)->old[idx] : &(vec)->elems[idx]))
+#endif
+
+/** @brief Remove the last element of the vector, returning the value
+ * @param vec Pointer to the AB_ivec
+ * @return The removed element
+ * @note The vector must be non-empty
+ * @hideinitializer
+ */
+#if defined(AB_VEC_TYPEOF) && defined(__GNUC__)
+# define AB_ivec_pop(vec)                                                                          \
+    __extension__ ({ *(AB_VEC_TYPEOF((vec)->elems))AB_ivec_pop_generic(                            \
+        (struct AB_ivector_generic *)(vec), sizeof(*(vec)->elems)); })
+#elif defined(AB_VEC_TYPEOF)
+# define AB_ivec_pop(vec)                                                                          \
+    (*(AB_VEC_TYPEOF((vec)->elems))AB_ivec_pop_generic(                                            \
+        (struct AB_ivector_generic *)(vec), sizeof(*(vec)->elems)))
+#else
+# define AB_ivec_pop(vec)                                                                          \
+    (AB_ivec_pop_generic((struct AB_ivector_generic *)(vec), sizeof(*(vec)->elems)),              \
+     (vec)->elems[(vec)->num])
+#endif
+
+/** @brief Add an element to the end of the vector, returning a pointer to that spot
+ * @param vec Pointer to the AB_ivec
+ * @return Pointer to the pushed element, or NULL on error
+ * @hideinitializer
+ */
+#ifdef AB_VEC_TYPEOF
+# define AB_ivec_pushp(vec)                                                                        \
+    ((AB_VEC_TYPEOF((vec)->elems))AB_ivec_pushp_generic(                                           \
+        (struct AB_ivector_generic *)(vec), sizeof(*(vec)->elems)))
+#else
+# define AB_ivec_pushp(vec)                                                                        \
+    (AB_ivec_pushp_generic((struct AB_ivector_generic *)(vec), sizeof(*(vec)->elems)) == NULL      \
+         ? NULL : &(vec)->elems[(vec)->num - 1])
+#endif
+
+/** @brief Add an element to the end of the vector
+ * @param vec Pointer to the AB_ivec
+ * @param elem The element to insert
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#ifdef AB_VEC_TYPEOF
+# define AB_ivec_push(vec, elem)                                                                   \
+    AB_ivec_push_generic((struct AB_ivector_generic *)(vec),                                       \
+        (AB_VEC_TYPEOF(*(vec)->elems)[1]){ (elem) }, sizeof(*(vec)->elems))
+#else
+# define AB_ivec_push(vec, elem)                                                                   \
+    (AB_ivec_pushp_generic((struct AB_ivector_generic *)(vec), sizeof(*(vec)->elems)) == NULL      \
+         ? 1 : ((vec)->elems[(vec)->num - 1] = (elem), 0))
+#endif
+
+#endif /* AMBER_UTIL_VECTOR_INCREMENTAL_H */
@@ -0,0 +1,337 @@
+/** @file AB_vector_latency.h
+ * @brief Per-thread latency histograms of AB_vec operations
+ *
+ * Throughput numbers average away the rare push that reallocates a large
+ * vector. When @c AB_VEC_LATENCY is defined, this header redefines
+ * @c AB_vec_push(), @c AB_vec_pushp(), @c AB_vec_insert() and
+ * @c AB_vec_resize(), so every call made after the include is timed and
+ * counted in a histogram of the calling thread. Without @c AB_VEC_LATENCY
+ * the macros are left alone and the histograms stay empty, so the header
+ * can be included unconditionally and the instrumentation switched on per
+ * build. The instrumented macros evaluate their arguments like the ANSI C
+ * ones do without @c AB_VEC_TYPEOF: the vector more than once, and the
+ * element after the vector has grown.
+ *
+ * The histograms are log-bucketed like HdrHistogram: 16 buckets per power
+ * of two, so every recorded value is known to within 1/16 (6%), from one
+ * clock tick up to 2^64. Each thread allocates its own histogram on first
+ * use and only that thread writes to it, with relaxed atomic stores, so
+ * recording takes no lock and no read-modify-write. Histograms are linked
+ * into one global list and outlive their threads. @c AB_vec_latency_merge()
+ * sums them while they are being written; @c AB_vec_latency_dump() prints
+ * the tail by operation.
+ *
+ * Macro-options (besides those of AB_vector.h):
+ *  - AB_VEC_LATENCY
+ *    Define this macro to time the operations.
+ *
+ *  - AB_VEC_LATENCY_CLOCK(), AB_VEC_LATENCY_UNIT
+ *    A cheap monotonic counter returning @c uint64_t, and the name of its
+ *    unit. Default to @c rdtsc ("cycles") on x86 and @c CLOCK_MONOTONIC
+ *    ("ns") elsewhere.
+ *
+ * This header requires C99, the GCC-style @c __atomic builtins and
+ * @c __thread, and a target with weak symbols (ELF or Mach-O), which keep
+ * one list of histograms for the whole program.
+ */
+#ifndef AMBER_UTIL_VECTOR_LATENCY_H
+#define AMBER_UTIL_VECTOR_LATENCY_H
+
+#include "AB_vector.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(__GNUC__) && !defined(__DOXYGEN__)
+# error "AB_vector_latency.h requires GCC-style __atomic builtins"
+#endif
+
+/** @brief Monotonic counter used to time operations
+ * @note This macro can be overidden, together with AB_VEC_LATENCY_UNIT
+ */
+#ifndef AB_VEC_LATENCY_CLOCK
+# if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#  define AB_VEC_LATENCY_CLOCK() ((uint64_t)__rdtsc())
+#  define AB_VEC_LATENCY_UNIT "cycles"
+# else
+#  include <time.h>
+#  define AB_VEC_LATENCY_CLOCK() AB_vec_latency_ns()
+#  define AB_VEC_LATENCY_UNIT "ns"
+static AB_VEC_INLINE uint64_t
+AB_vec_latency_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+# endif
+#endif /* AB_VEC_LATENCY_CLOCK */
+
+/** @brief Operations with a histogram of their own */
+enum {
+    AB_VEC_LATENCY_PUSH,   /**< @c AB_vec_push() */
+    AB_VEC_LATENCY_PUSHP,  /**< @c AB_vec_pushp() */
+    AB_VEC_LATENCY_INSERT, /**< @c AB_vec_insert() */
+    AB_VEC_LATENCY_RESIZE, /**< @c AB_vec_resize() */
+    AB_VEC_LATENCY_OPS     /**< Number of operations */
+};
+
+/** @brief Number of buckets per operation */
+#define AB_VEC_LATENCY_BUCKETS (61 * 16)
+
+/** @brief Latency histograms of every operation, for one thread or merged */
+typedef struct AB_vec_latency {
+    uint64_t count[AB_VEC_LATENCY_OPS][AB_VEC_LATENCY_BUCKETS]; /**< Calls per bucket */
+    uint64_t max[AB_VEC_LATENCY_OPS];                           /**< Slowest call */
+    /** @cond false */
+    struct AB_vec_latency *next;
+    /** @endcond */
+} AB_vec_latency;
+
+/** @cond false */
+__attribute__((weak)) AB_vec_latency *AB_vec_latency_head;
+__attribute__((weak)) __thread AB_vec_latency *AB_vec_latency_self;
+/** @endcond */
+
+/** @brief Bucket of a latency
+ * @param ticks Latency in clock units
+ * @return Bucket index. Values below 16 have a bucket each, then every
+ *  power of two is split into 16 equal buckets.
+ */
+static AB_VEC_INLINE unsigned
+AB_vec_latency_bucket(uint64_t ticks)
+{
+    unsigned lg;
+    if (ticks < 16)
+        return (unsigned)ticks;
+    lg = 63u - (unsigned)__builtin_clzll(ticks);
+    return (lg - 3) * 16 + (unsigned)(ticks >> (lg - 4)) - 16;
+}
+
+/** @brief Smallest latency counted in a bucket
+ * @param bucket Bucket index, less than @c AB_VEC_LATENCY_BUCKETS
+ * @return The lower bound, in clock units
+ */
+static AB_VEC_INLINE uint64_t
+AB_vec_latency_bucket_low(unsigned bucket)
+{
+    unsigned lg;
+    if (bucket < 16)
+        return bucket;
+    lg = bucket / 16 + 3;
+    return (uint64_t)(16 + bucket % 16) << (lg - 4);
+}
+
+/* First call on a thread: allocate and publish its histogram */
+static AB_VEC_COLD AB_vec_latency *
+AB_vec_latency_register(void)
+{
+    AB_vec_latency *h = calloc(1, sizeof(*h));
+    if (h == NULL)
+        return NULL;
+    h->next = __atomic_load_n(&AB_vec_latency_head, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&AB_vec_latency_head, &h->next, h, 1,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    AB_vec_latency_self = h;
+    return h;
+}
+
+/** @brief Count one call in the calling thread's histogram
+ * @param op One of the @c AB_VEC_LATENCY_* operations
+ * @param ticks Latency in clock units
+ * @note The instrumented macros call this; it is public so that callers
+ *  can time their own operations in the same histograms
+ */
+static AB_VEC_INLINE void
+AB_vec_latency_record(int op, uint64_t ticks)
+{
+    AB_vec_latency *h = AB_vec_latency_self;
+    uint64_t *c;
+    if (AB_VEC_UNLIKELY(h == NULL) && (h = AB_vec_latency_register()) == NULL)
+        return;
+    /* Only this thread writes, so a plain increment published with a
+     * relaxed store cannot lose counts */
+    c = &h->count[op][AB_vec_latency_bucket(ticks)];
+    __atomic_store_n(c, *c + 1, __ATOMIC_RELAXED);
+    if (ticks > h->max[op])
+        __atomic_store_n(&h->max[op], ticks, __ATOMIC_RELAXED);
+}
+
+/** @brief Sum the histograms of every thread
+ * @param [out] out Pointer to an AB_vec_latency to overwrite
+ * @note Threads may keep recording meanwhile; their counts are read
+ *  one by one, so the result is a consistent-enough snapshot
+ */
+static AB_VEC_INLINE void
+AB_vec_latency_merge(AB_vec_latency *out)
+{
+    const AB_vec_latency *h;
+    int op;
+    unsigned b;
+    AB_VEC_CHECK(out != NULL);
+    memset(out, 0, sizeof(*out));
+    for (h = __atomic_load_n(&AB_vec_latency_head, __ATOMIC_ACQUIRE); h != NULL; h = h->next) {
+        for (op = 0; op < AB_VEC_LATENCY_OPS; op++) {
+            uint64_t m = __atomic_load_n(&h->max[op], __ATOMIC_RELAXED);
+            for (b = 0; b < AB_VEC_LATENCY_BUCKETS; b++)
+                out->count[op][b] += __atomic_load_n(&h->count[op][b], __ATOMIC_RELAXED);
+            if (m > out->max[op])
+                out->max[op] = m;
+        }
+    }
+}
+
+/** @brief Zero the histograms of every thread
+ * @note Calls being recorded at the same time may survive the reset
+ */
+static AB_VEC_INLINE void
+AB_vec_latency_reset(void)
+{
+    AB_vec_latency *h;
+    int op;
+    unsigned b;
+    for (h = __atomic_load_n(&AB_vec_latency_head, __ATOMIC_ACQUIRE); h != NULL; h = h->next) {
+        for (op = 0; op < AB_VEC_LATENCY_OPS; op++) {
+            for (b = 0; b < AB_VEC_LATENCY_BUCKETS; b++)
+                __atomic_store_n(&h->count[op][b], 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&h->max[op], 0, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/** @brief Number of calls counted for an operation
+ * @param h Const pointer to an AB_vec_latency, usually a merged one
+ * @param op One of the @c AB_VEC_LATENCY_* operations
+ * @return The number of calls
+ */
+static AB_VEC_INLINE uint64_t
+AB_vec_latency_count(const AB_vec_latency *h, int op)
+{
+    uint64_t n = 0;
+    unsigned b;
+    for (b = 0; b < AB_VEC_LATENCY_BUCKETS; b++)
+        n += h->count[op][b];
+    return n;
+}
+
+/** @brief Latency below which a fraction of the calls completed
+ * @param h Const pointer to an AB_vec_latency, usually a merged one
+ * @param op One of the @c AB_VEC_LATENCY_* operations
+ * @param q The fraction, in [0, 1]
+ * @return The upper bound of the bucket holding quantile @c q, capped at
+ *  the maximum, in clock units. 0 if no call was counted.
+ */
+static AB_VEC_INLINE uint64_t
+AB_vec_latency_quantile(const AB_vec_latency *h, int op, double q)
+{
+    uint64_t n = AB_vec_latency_count(h, op), want, seen = 0;
+    unsigned b;
+    if (n == 0)
+        return 0;
+    want = (uint64_t)(q * (double)n);
+    if (want >= n)
+        want = n - 1;
+    for (b = 0; b + 1 < AB_VEC_LATENCY_BUCKETS; b++) {
+        seen += h->count[op][b];
+        if (seen > want)
+            break;
+    }
+    if (b + 1 < AB_VEC_LATENCY_BUCKETS && AB_vec_latency_bucket_low(b + 1) - 1 < h->max[op])
+        return AB_vec_latency_bucket_low(b + 1) - 1;
+    return h->max[op];
+}
+
+/** @brief Print the tail latency of every operation that was called
+ * @param h Const pointer to an AB_vec_latency, usually a merged one
+ * @param f Stream to write to
+ */
+static AB_VEC_INLINE void
+AB_vec_latency_dump(const AB_vec_latency *h, FILE *f)
+{
+    static const char *const names[AB_VEC_LATENCY_OPS] = { "push", "pushp", "insert", "resize" };
+    int op;
+    fprintf(f, "%-8s %14s %10s %10s %10s %10s %12s (%s)\n", "op", "count", "p50", "p99",
+            "p999", "p9999", "max", AB_VEC_LATENCY_UNIT);
+    for (op = 0; op < AB_VEC_LATENCY_OPS; op++) {
+        uint64_t n = AB_vec_latency_count(h, op);
+        if (n == 0)
+            continue;
+        fprintf(f, "%-8s %14llu %10llu %10llu %10llu %10llu %12llu\n", names[op],
+                (unsigned long long)n,
+                (unsigned long long)AB_vec_latency_quantile(h, op, 0.5),
+                (unsigned long long)AB_vec_latency_quantile(h, op, 0.99),
+                (unsigned long long)AB_vec_latency_quantile(h, op, 0.999),
+                (unsigned long long)AB_vec_latency_quantile(h, op, 0.9999),
+                (unsigned long long)h->max[op]);
+    }
+}
+
+#if defined(AB_VEC_LATENCY)
+/** @cond false */
+static AB_VEC_INLINE void *
+AB_vec_latency_pushp(struct AB_vector_generic *vec, AB_VEC_SIZE_T elem_size, int op)
+{
+    uint64_t t0 = AB_VEC_LATENCY_CLOCK();
+    void *p;
+    AB_VEC_CHECK(vec != NULL);
+    if (AB_VEC_UNLIKELY(vec->num == vec->capacity) && AB_vec_grow_generic(vec, elem_size))
+        p = NULL;
+    else
+        p = (char *)vec->elems + elem_size * vec->num++;
+    AB_vec_latency_record(op, AB_VEC_LATENCY_CLOCK() - t0);
+    return p;
+}
+
+static AB_VEC_INLINE int
+AB_vec_latency_insert(struct AB_vector_generic *vec, AB_VEC_SIZE_T idx, AB_VEC_SIZE_T elem_size)
+{
+    uint64_t t0 = AB_VEC_LATENCY_CLOCK();
+    int err;
+    AB_VEC_CHECK(vec != NULL);
+    err = AB_vec_insert_generic(vec, idx, elem_size);
+    AB_vec_latency_record(AB_VEC_LATENCY_INSERT, AB_VEC_LATENCY_CLOCK() - t0);
+    return err;
+}
+
+static AB_VEC_INLINE int
+AB_vec_latency_resize(struct AB_vector_generic *vec, AB_VEC_SIZE_T n, AB_VEC_SIZE_T elem_size)
+{
+    uint64_t t0 = AB_VEC_LATENCY_CLOCK();
+    int err = AB_vec_resize_generic(vec, n, elem_size);
+    AB_vec_latency_record(AB_VEC_LATENCY_RESIZE, AB_VEC_LATENCY_CLOCK() - t0);
+    return err;
+}
+/** @endcond */
+
+# undef AB_vec_push
+# undef AB_vec_pushp
+# undef AB_vec_insert
+# undef AB_vec_resize
+
+/* The element is stored after the clock stops, as it would be by the
+ * caller of AB_vec_pushp() */
+# define AB_vec_push(vec, elem)                                                                    \
+    (AB_vec_latency_pushp((struct AB_vector_generic *)(vec), sizeof(*(vec)->elems),                \
+        AB_VEC_LATENCY_PUSH) == NULL ? 1 : ((vec)->elems[(vec)->num - 1] = (elem), 0))
+
+# ifdef AB_VEC_TYPEOF
+#  define AB_vec_pushp(vec)                                                                        \
+    ((AB_VEC_TYPEOF((vec)->elems))AB_vec_latency_pushp((struct AB_vector_generic *)(vec),          \
+        sizeof(*(vec)->elems), AB_VEC_LATENCY_PUSHP))
+# else
+#  define AB_vec_pushp(vec)                                                                        \
+    (AB_vec_latency_pushp((struct AB_vector_generic *)(vec), sizeof(*(vec)->elems),                \
+        AB_VEC_LATENCY_PUSHP) == NULL ? NULL : &(vec)->elems[(vec)->num - 1])
+# endif
+
+# define AB_vec_insert(vec, idx, elem)                                                             \
+    (AB_vec_latency_insert((struct AB_vector_generic *)(vec), (idx), sizeof(*(vec)->elems)) == 0 \
+        ? ((vec)->elems[(idx)] = (elem), 0) : 1)
+
+# define AB_vec_resize(vec, newsize)                                                               \
+    AB_vec_latency_resize((struct AB_vector_generic *)(vec), (newsize), sizeof(*(vec)->elems))
+#endif /* AB_VEC_LATENCY */
+
+#endif /* AMBER_UTIL_VECTOR_LATENCY_H */
@@ -0,0 +1,664 @@
+/** @file AB_vector_numeric.h
+ * @brief Bulk numeric kernels over AB_vec of fixed-width integers
+ *
+ * The kernels here work on whole vectors and dispatch on the element size,
+ * so they take any AB_vec of 4- or 8-byte unsigned integers (@c uint32_t,
+ * @c uint64_t). Signed types work as well since the arithmetic wraps the
+ * same way. Conversions between element types name the pair of types
+ * explicitly instead, and histograms take 1- or 2-byte keys. Each kernel
+ * has an x86 SSE2 path, picked at compile time, and a portable scalar
+ * fallback. Large inputs can be split across an @c AB_vec_pool from
+ * AB_vector_parallel.h; pass NULL to stay on the calling thread.
+ *
+ * This header requires C99 (for stdint.h) and AB_vector_parallel.h.
+ */
+#ifndef AMBER_UTIL_VECTOR_NUMERIC_H
+#define AMBER_UTIL_VECTOR_NUMERIC_H
+
+#include "AB_vector.h"
+#include "AB_vector_parallel.h"
+#include <float.h>
+#include <stdint.h>
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+/**************************************************************************
+ *
+ * Prefix sums
+ *
+ *************************************************************************/
+
+/* Scan n values into out (which may alias in), starting from carry.
+ * Returns carry plus the sum of all n values. */
+static AB_VEC_INLINE uint32_t
+AB_vec_scan_u32(uint32_t *out, const uint32_t *in, size_t n, uint32_t carry, int exclusive)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    __m128i c = _mm_set1_epi32((int)carry);
+    for (; i + 4 <= n; i += 4) {
+        /* In-register scan: two shifted adds give the 4-lane prefix sum */
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i s = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        s = _mm_add_epi32(s, _mm_slli_si128(s, 8));
+        s = _mm_add_epi32(s, c);
+        _mm_storeu_si128((__m128i *)(out + i), exclusive ? _mm_sub_epi32(s, x) : s);
+        c = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    carry = (uint32_t)_mm_cvtsi128_si32(c);
+#endif
+    for (; i < n; i++) {
+        uint32_t x = in[i];
+        out[i] = exclusive ? carry : carry + x;
+        carry += x;
+    }
+    return carry;
+}
+
+static AB_VEC_INLINE uint64_t
+AB_vec_scan_u64(uint64_t *out, const uint64_t *in, size_t n, uint64_t carry, int exclusive)
+{
+    size_t i = 0;
+#if defined(__SSE2__) && defined(__x86_64__)
+    __m128i c = _mm_set1_epi64x((long long)carry);
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i s = _mm_add_epi64(_mm_add_epi64(x, _mm_slli_si128(x, 8)), c);
+        _mm_storeu_si128((__m128i *)(out + i), exclusive ? _mm_sub_epi64(s, x) : s);
+        c = _mm_unpackhi_epi64(s, s);
+    }
+    carry = (uint64_t)_mm_cvtsi128_si64(c);
+#endif
+    for (; i < n; i++) {
+        uint64_t x = in[i];
+        out[i] = exclusive ? carry : carry + x;
+        carry += x;
+    }
+    return carry;
+}
+
+static AB_VEC_INLINE uint64_t
+AB_vec_scan_block(void *out, const void *in, size_t n, uint64_t carry,
+        size_t elem_size, int exclusive)
+{
+    if (elem_size == 4)
+        return AB_vec_scan_u32(out, in, n, (uint32_t)carry, exclusive);
+    return AB_vec_scan_u64(out, in, n, carry, exclusive);
+}
+
+/** @cond false */
+struct AB_vec_scan_job {
+    char *out;
+    const char *in;
+    size_t n, block, elem_size;
+    uint64_t *sums;
+    int exclusive;
+};
+/** @endcond */
+
+/* Pass 1: total of each block */
+static AB_VEC_INLINE void
+AB_vec_scan_reduce_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_scan_job *job = ctx;
+    size_t b, i;
+    (void)worker;
+    for (b = begin; b < end; b++) {
+        size_t lo = b * job->block, hi = lo + job->block < job->n ? lo + job->block : job->n;
+        uint64_t sum = 0;
+        if (job->elem_size == 4) {
+            const uint32_t *in = (const uint32_t *)job->in;
+            uint32_t s32 = 0;
+            for (i = lo; i < hi; i++)
+                s32 += in[i];
+            sum = s32;
+        } else {
+            const uint64_t *in = (const uint64_t *)job->in;
+            for (i = lo; i < hi; i++)
+                sum += in[i];
+        }
+        job->sums[b] = sum;
+    }
+}
+
+/* Pass 2: scan each block starting from its offset */
+static AB_VEC_INLINE void
+AB_vec_scan_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_scan_job *job = ctx;
+    size_t b;
+    (void)worker;
+    for (b = begin; b < end; b++) {
+        size_t lo = b * job->block, hi = lo + job->block < job->n ? lo + job->block : job->n;
+        AB_vec_scan_block(job->out + lo * job->elem_size, job->in + lo * job->elem_size,
+                hi - lo, job->sums[b], job->elem_size, job->exclusive);
+    }
+}
+
+static AB_VEC_INLINE int
+AB_vec_scan_generic(AB_vec_pool *pool, struct AB_vector_generic *dest,
+        const struct AB_vector_generic *src, size_t elem_size, int exclusive)
+{
+    struct AB_vec_scan_job job;
+    AB_vec(uint64_t) sums = AB_VEC_INIT;
+    unsigned nthreads = AB_vec_pool_size(pool);
+    size_t b, nblocks;
+    uint64_t carry = 0;
+
+    AB_VEC_ASSERT(dest != NULL);
+    AB_VEC_ASSERT(src != NULL);
+    AB_VEC_ASSERT(elem_size == 4 || elem_size == 8);
+    if (dest != src && AB_vec_reserve_generic(dest, src->num, (AB_VEC_SIZE_T)elem_size))
+        return 1;
+
+    job.out = dest->elems;
+    job.in = src->elems;
+    job.n = src->num;
+    job.elem_size = elem_size;
+    job.exclusive = exclusive;
+
+    if (nthreads == 1 || job.n * elem_size < AB_VEC_PARALLEL_MIN_BYTES) {
+        AB_vec_scan_block(job.out, job.in, job.n, 0, elem_size, exclusive);
+        dest->num = src->num;
+        return 0;
+    }
+
+    /* Reduce-then-scan over a few whole-cache-line blocks per thread */
+    job.block = (job.n + nthreads * 4 - 1) / (nthreads * 4);
+    job.block = (job.block * elem_size + AB_VEC_CACHELINE - 1)
+        / AB_VEC_CACHELINE * AB_VEC_CACHELINE / elem_size;
+    nblocks = (job.n + job.block - 1) / job.block;
+    if (AB_vec_resize(&sums, nblocks))
+        return 1;
+    job.sums = sums.elems;
+
+    AB_vec_pool_run(pool, NULL, job.block * elem_size, nblocks, AB_vec_scan_reduce_thunk, &job);
+    for (b = 0; b < nblocks; b++) {
+        uint64_t sum = job.sums[b];
+        job.sums[b] = carry;
+        carry += sum;
+    }
+    AB_vec_pool_run(pool, NULL, job.block * elem_size, nblocks, AB_vec_scan_thunk, &job);
+
+    dest->num = src->num;
+    AB_vec_destroy(&sums);
+    return 0;
+}
+/** @brief Inclusive prefix sum: @c dest[i] = @c src[0] + ... + @c src[i]
+ * @param pool Pointer to an AB_vec_pool, or NULL to run serially
+ * @param [out] dest Pointer to the destination AB_vec, may equal @c src
+ * @param [in] src Const pointer to an AB_vec of 4- or 8-byte integers
+ * @return 0 on success, nonzero on error
+ * @note Large inputs on a pool use a two-pass reduce-then-scan, so they
+ *  read the input twice
+ * @hideinitializer
+ */
+#define AB_vec_inclusive_scan(pool, dest, src)                                                     \
+    AB_vec_scan_generic((pool), (struct AB_vector_generic *)(dest),                                \
+            (const struct AB_vector_generic *)(src), sizeof(*(src)->elems), 0)
+
+/** @brief Exclusive prefix sum: @c dest[0] = 0, @c dest[i] = @c src[0] + ... + @c src[i - 1]
+ * @param pool Pointer to an AB_vec_pool, or NULL to run serially
+ * @param [out] dest Pointer to the destination AB_vec, may equal @c src
+ * @param [in] src Const pointer to an AB_vec of 4- or 8-byte integers
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#define AB_vec_exclusive_scan(pool, dest, src)                                                     \
+    AB_vec_scan_generic((pool), (struct AB_vector_generic *)(dest),                                \
+            (const struct AB_vector_generic *)(src), sizeof(*(src)->elems), 1)
+
+/**************************************************************************
+ *
+ * Conversions
+ *
+ *************************************************************************/
+
+/** @brief Element conversions for @c AB_vec_convert() */
+enum {
+    AB_VEC_CONV_I32_F32 = 0, /**< @c int32_t to @c float, rounding to nearest */
+    AB_VEC_CONV_F32_I32 = 1, /**< @c float to @c int32_t, truncating toward zero */
+    AB_VEC_CONV_F32_F64 = 2, /**< @c float to @c double */
+    AB_VEC_CONV_F64_F32 = 3, /**< @c double to @c float, rounding to nearest */
+    AB_VEC_CONV_U8_U32 = 4,  /**< @c uint8_t to @c uint32_t */
+    AB_VEC_CONV_U32_U8 = 5,  /**< @c uint32_t to @c uint8_t, keeping the low byte */
+    AB_VEC_CONV_I32_I16 = 6, /**< @c int32_t to @c int16_t, keeping the low half */
+    /** Flag: clamp narrowing conversions to the destination's range.
+     * @c float to @c int32_t also maps NaN to 0, and @c double to @c float
+     * gives +-FLT_MAX instead of infinity. */
+    AB_VEC_CONV_SATURATE = 0x100
+};
+
+/** @cond false */
+#define AB_VEC_CONV_KIND_(conv) ((conv) & 0xff)
+/** @endcond */
+
+/* Source and destination element sizes of a conversion */
+static AB_VEC_INLINE size_t
+AB_vec_conv_size(int conv, int dest)
+{
+    static const unsigned char sizes[7][2] = {
+        { 4, 4 }, { 4, 4 }, { 4, 8 }, { 8, 4 }, { 1, 4 }, { 4, 1 }, { 4, 2 }
+    };
+    return sizes[AB_VEC_CONV_KIND_(conv)][dest != 0];
+}
+
+static AB_VEC_INLINE void
+AB_vec_cvt_i32_f32(float *out, const int32_t *in, size_t n)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(in + i + 4));
+        _mm_storeu_ps(out + i, _mm_cvtepi32_ps(a));
+        _mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(b));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = (float)in[i];
+}
+
+static AB_VEC_INLINE int32_t
+AB_vec_cvt_f32_i32_1(float x)
+{
+    /* Out of range is undefined in C, so the scalar path always clamps */
+    if (x != x)
+        return 0;
+    if (x <= -2147483648.0f)
+        return INT32_MIN;
+    if (x >= 2147483648.0f)
+        return INT32_MAX;
+    return (int32_t)x;
+}
+
+static AB_VEC_INLINE void
+AB_vec_cvt_f32_i32(int32_t *out, const float *in, size_t n, int saturate)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 two31 = _mm_set1_ps(2147483648.0f);
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(in + i), big = _mm_setzero_ps();
+        __m128i r;
+        if (saturate) {
+            /* Zero NaNs. Out of range, cvttps gives INT32_MIN, which is
+             * right below the range and flipped to INT32_MAX above it. */
+            big = _mm_cmpge_ps(x, two31);
+            x = _mm_and_ps(x, _mm_cmpord_ps(x, x));
+        }
+        r = _mm_cvttps_epi32(x);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_xor_si128(r, _mm_castps_si128(big)));
+    }
+#endif
+    (void)saturate;
+    for (; i < n; i++)
+        out[i] = AB_vec_cvt_f32_i32_1(in[i]);
+}
+
+static AB_VEC_INLINE void
+AB_vec_cvt_f32_f64(double *out, const float *in, size_t n)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(in + i);
+        _mm_storeu_pd(out + i, _mm_cvtps_pd(x));
+        _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = in[i];
+}
+
+static AB_VEC_INLINE void
+AB_vec_cvt_f64_f32(float *out, const double *in, size_t n, int saturate)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d lo = _mm_set1_pd(-FLT_MAX), hi = _mm_set1_pd(FLT_MAX);
+    for (; i + 4 <= n; i += 4) {
+        __m128d a = _mm_loadu_pd(in + i), b = _mm_loadu_pd(in + i + 2);
+        if (saturate) {
+            /* min/max return their second operand for NaN, keeping it */
+            a = _mm_max_pd(lo, _mm_min_pd(hi, a));
+            b = _mm_max_pd(lo, _mm_min_pd(hi, b));
+        }
+        _mm_storeu_ps(out + i, _mm_movelh_ps(_mm_cvtpd_ps(a), _mm_cvtpd_ps(b)));
+    }
+#endif
+    for (; i < n; i++) {
+        double x = in[i];
+        if (saturate)
+            x = x > FLT_MAX ? FLT_MAX : x < -FLT_MAX ? -FLT_MAX : x;
+        out[i] = (float)x;
+    }
+}
+
+static AB_VEC_INLINE void
+AB_vec_cvt_u8_u32(uint32_t *out, const uint8_t *in, size_t n)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i l = _mm_unpacklo_epi8(x, zero), h = _mm_unpackhi_epi8(x, zero);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi16(l, zero));
+        _mm_storeu_si128((__m128i *)(out + i + 4), _mm_unpackhi_epi16(l, zero));
+        _mm_storeu_si128((__m128i *)(out + i + 8), _mm_unpacklo_epi16(h, zero));
+        _mm_storeu_si128((__m128i *)(out + i + 12), _mm_unpackhi_epi16(h, zero));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = in[i];
+}
+
+static AB_VEC_INLINE void
+AB_vec_cvt_u32_u8(uint8_t *out, const uint32_t *in, size_t n, int saturate)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    /* Bring every lane into [0, 255] first, so the signed packs are exact */
+    const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+    const __m128i top = _mm_set1_epi32((int)(0x80000000u + 255));
+    const __m128i mask = _mm_set1_epi32(255);
+    for (; i + 16 <= n; i += 16) {
+        __m128i x[4];
+        int j;
+        for (j = 0; j < 4; j++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(in + i) + j);
+            if (saturate)
+                v = _mm_or_si128(v, _mm_cmpgt_epi32(_mm_xor_si128(v, bias), top));
+            x[j] = _mm_and_si128(v, mask);
+        }
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(
+                    _mm_packs_epi32(x[0], x[1]), _mm_packs_epi32(x[2], x[3])));
+    }
+#endif
+    for (; i < n; i++)
+        out[i] = (uint8_t)(saturate && in[i] > 255 ? 255 : in[i]);
+}
+
+static AB_VEC_INLINE void
+AB_vec_cvt_i32_i16(int16_t *out, const int32_t *in, size_t n, int saturate)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(in + i + 4));
+        if (!saturate) {
+            /* Sign-extend the low halves so the saturating pack keeps them */
+            a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+            b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        }
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(a, b));
+    }
+#endif
+    for (; i < n; i++) {
+        int32_t x = in[i];
+        if (saturate)
+            x = x > INT16_MAX ? INT16_MAX : x < INT16_MIN ? INT16_MIN : x;
+        out[i] = (int16_t)(uint16_t)(uint32_t)x;
+    }
+}
+
+static AB_VEC_INLINE void
+AB_vec_convert_block(void *out, const void *in, size_t n, int conv)
+{
+    int saturate = (conv & AB_VEC_CONV_SATURATE) != 0;
+    switch (AB_VEC_CONV_KIND_(conv)) {
+    case AB_VEC_CONV_I32_F32: AB_vec_cvt_i32_f32(out, in, n); break;
+    case AB_VEC_CONV_F32_I32: AB_vec_cvt_f32_i32(out, in, n, saturate); break;
+    case AB_VEC_CONV_F32_F64: AB_vec_cvt_f32_f64(out, in, n); break;
+    case AB_VEC_CONV_F64_F32: AB_vec_cvt_f64_f32(out, in, n, saturate); break;
+    case AB_VEC_CONV_U8_U32: AB_vec_cvt_u8_u32(out, in, n); break;
+    case AB_VEC_CONV_U32_U8: AB_vec_cvt_u32_u8(out, in, n, saturate); break;
+    case AB_VEC_CONV_I32_I16: AB_vec_cvt_i32_i16(out, in, n, saturate); break;
+    }
+}
+
+/** @cond false */
+struct AB_vec_convert_job {
+    char *out;
+    const char *in;
+    size_t out_size, in_size;
+    int conv;
+};
+/** @endcond */
+
+static AB_VEC_INLINE void
+AB_vec_convert_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_convert_job *job = ctx;
+    (void)worker;
+    AB_vec_convert_block(job->out + begin * job->out_size, job->in + begin * job->in_size,
+            end - begin, job->conv);
+}
+
+static AB_VEC_INLINE int
+AB_vec_convert_generic(AB_vec_pool *pool, struct AB_vector_generic *dest, size_t dest_size,
+        const struct AB_vector_generic *src, size_t src_size, int conv)
+{
+    struct AB_vec_convert_job job;
+    AB_VEC_CHECK(dest != NULL);
+    AB_VEC_CHECK(src != NULL);
+    AB_VEC_CHECK((void *)dest != (const void *)src);
+    AB_VEC_CHECK(AB_VEC_CONV_KIND_(conv) <= AB_VEC_CONV_I32_I16);
+    AB_VEC_CHECK(AB_vec_conv_size(conv, 0) == src_size);
+    AB_VEC_CHECK(AB_vec_conv_size(conv, 1) == dest_size);
+    if (AB_vec_reserve_generic(dest, src->num, (AB_VEC_SIZE_T)dest_size))
+        return 1;
+    job.out = dest->elems;
+    job.in = src->elems;
+    job.out_size = dest_size;
+    job.in_size = src_size;
+    job.conv = conv;
+    AB_vec_pool_run(pool, dest->elems, dest_size, src->num, AB_vec_convert_thunk, &job);
+    dest->num = src->num;
+    return 0;
+}
+/** @brief Convert every element of a vector to another type
+ * @param pool Pointer to an AB_vec_pool, or NULL to run serially
+ * @param [out] dest Pointer to the destination AB_vec, resized at most once
+ * @param [in] src Const pointer to the source AB_vec
+ * @param conv One of the @c AB_VEC_CONV_ constants naming the source and
+ *  destination types, optionally or-ed with @c AB_VEC_CONV_SATURATE
+ * @return 0 on success, nonzero on error
+ * @note Without @c AB_VEC_CONV_SATURATE, @c float values outside the range
+ *  of @c int32_t (and NaN) convert to an unspecified value
+ * @hideinitializer
+ */
+#define AB_vec_convert(pool, dest, src, conv)                                                      \
+    AB_vec_convert_generic((pool), (struct AB_vector_generic *)(dest), sizeof(*(dest)->elems),    \
+            (const struct AB_vector_generic *)(src), sizeof(*(src)->elems), (conv))
+
+/**************************************************************************
+ *
+ * Histograms
+ *
+ *************************************************************************/
+
+/* Count 8-bit keys into four interleaved 256-bucket sub-histograms, so
+ * repeats of one key increment different counters and don't wait on each
+ * other's store. A 16-byte run of a single key is counted in one step. */
+static AB_VEC_INLINE void
+AB_vec_hist_u8(uint32_t *c, const uint8_t *p, size_t n)
+{
+    uint32_t *c0 = c, *c1 = c + 256, *c2 = c + 512, *c3 = c + 768;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint64_t a, b;
+#if defined(__SSE2__)
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8((char)p[i]))) == 0xffff) {
+            c0[p[i]] += 16;
+            continue;
+        }
+#endif
+        memcpy(&a, p + i, 8);
+        memcpy(&b, p + i + 8, 8);
+        c0[a & 0xff]++; c1[a >> 8 & 0xff]++; c2[a >> 16 & 0xff]++; c3[a >> 24 & 0xff]++;
+        c0[a >> 32 & 0xff]++; c1[a >> 40 & 0xff]++; c2[a >> 48 & 0xff]++; c3[a >> 56]++;
+        c0[b & 0xff]++; c1[b >> 8 & 0xff]++; c2[b >> 16 & 0xff]++; c3[b >> 24 & 0xff]++;
+        c0[b >> 32 & 0xff]++; c1[b >> 40 & 0xff]++; c2[b >> 48 & 0xff]++; c3[b >> 56]++;
+    }
+    for (; i < n; i++)
+        c0[p[i]]++;
+}
+
+/* 16-bit keys use two sub-histograms; four would not fit in L2 */
+static AB_VEC_INLINE void
+AB_vec_hist_u16(uint32_t *c, const uint16_t *p, size_t n)
+{
+    uint32_t *c0 = c, *c1 = c + 65536;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t a, b;
+#if defined(__SSE2__)
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(x, _mm_set1_epi16((short)p[i]))) == 0xffff) {
+            c0[p[i]] += 8;
+            continue;
+        }
+#endif
+        memcpy(&a, p + i, 8);
+        memcpy(&b, p + i + 4, 8);
+        c0[a & 0xffff]++; c1[a >> 16 & 0xffff]++; c0[a >> 32 & 0xffff]++; c1[a >> 48]++;
+        c0[b & 0xffff]++; c1[b >> 16 & 0xffff]++; c0[b >> 32 & 0xffff]++; c1[b >> 48]++;
+    }
+    for (; i < n; i++)
+        c0[p[i]]++;
+}
+
+/** @cond false */
+struct AB_vec_hist_job {
+    const char *in;
+    size_t elem_size, buckets, nsub;
+    uint32_t *counts;
+    uint64_t *totals, *pending;
+};
+/** @endcond */
+
+/* Fold a worker's 32-bit sub-histograms into its 64-bit totals */
+static AB_VEC_INLINE void
+AB_vec_hist_flush(struct AB_vec_hist_job *job, unsigned worker)
+{
+    uint32_t *c = job->counts + worker * job->nsub * job->buckets;
+    uint64_t *t = job->totals + worker * job->buckets;
+    size_t i;
+    for (i = 0; i < job->nsub * job->buckets; i++) {
+        t[i % job->buckets] += c[i];
+        c[i] = 0;
+    }
+}
+
+static AB_VEC_INLINE void
+AB_vec_hist_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_hist_job *job = ctx;
+    uint32_t *c = job->counts + worker * job->nsub * job->buckets;
+    uint64_t *pending = job->pending + worker * (AB_VEC_CACHELINE / sizeof(uint64_t));
+
+    while (begin < end) {
+        /* No counter may see more than 2^32 - 1 keys between flushes */
+        size_t m = end - begin;
+        if (m > 0xffffffffu - *pending) {
+            if (*pending > 0)
+                AB_vec_hist_flush(job, worker);
+            *pending = 0;
+            if (m > 0xffffffffu)
+                m = 0xffffffffu;
+        }
+        if (job->elem_size == 1)
+            AB_vec_hist_u8(c, (const uint8_t *)job->in + begin, m);
+        else
+            AB_vec_hist_u16(c, (const uint16_t *)job->in + begin, m);
+        *pending += m;
+        begin += m;
+    }
+}
+
+static AB_VEC_INLINE int
+AB_vec_histogram_generic(AB_vec_pool *pool, struct AB_vector_generic *hist,
+        const struct AB_vector_generic *src, size_t elem_size)
+{
+    struct AB_vec_hist_job job;
+    AB_vec(uint32_t) counts = AB_VEC_INIT;
+    AB_vec(uint64_t) totals = AB_VEC_INIT;
+    AB_vec(uint64_t) pending = AB_VEC_INIT;
+    unsigned t, nthreads = AB_vec_pool_size(pool);
+    uint64_t *out;
+    size_t b, i;
+
+    AB_VEC_CHECK(hist != NULL);
+    AB_VEC_CHECK(src != NULL);
+    AB_VEC_CHECK(elem_size == 1 || elem_size == 2);
+    job.buckets = elem_size == 1 ? 256 : 65536;
+    if (AB_vec_reserve_generic(hist, (AB_VEC_SIZE_T)job.buckets, sizeof(uint64_t)))
+        return 1;
+    out = hist->elems;
+    hist->num = (AB_VEC_SIZE_T)job.buckets;
+    memset(out, 0, job.buckets * sizeof(uint64_t));
+
+    /* Fewer keys than buckets: clearing sub-histograms would cost more */
+    if (src->num < job.buckets) {
+        for (i = 0; i < src->num; i++)
+            out[elem_size == 1 ? ((const uint8_t *)src->elems)[i]
+                : ((const uint16_t *)src->elems)[i]]++;
+        return 0;
+    }
+
+    if (src->num * elem_size < AB_VEC_PARALLEL_MIN_BYTES)
+        nthreads = 1;
+    job.in = src->elems;
+    job.elem_size = elem_size;
+    job.nsub = elem_size == 1 ? 4 : 2;
+    if (AB_vec_resize_zero(&counts, nthreads * job.nsub * job.buckets)
+            || AB_vec_resize_zero(&totals, nthreads * job.buckets)
+            || AB_vec_resize_zero(&pending, nthreads * (AB_VEC_CACHELINE / sizeof(uint64_t)))) {
+        AB_vec_destroy(&counts);
+        AB_vec_destroy(&totals);
+        AB_vec_destroy(&pending);
+        return 1;
+    }
+    job.counts = counts.elems;
+    job.totals = totals.elems;
+    job.pending = pending.elems;
+    AB_vec_pool_run(nthreads == 1 ? NULL : pool, src->elems, elem_size, src->num,
+            AB_vec_hist_thunk, &job);
+
+    /* Merge every worker's sub-histograms and totals */
+    for (t = 0; t < nthreads; t++) {
+        const uint32_t *c = job.counts + t * job.nsub * job.buckets;
+        const uint64_t *tot = job.totals + t * job.buckets;
+        for (b = 0; b < job.buckets; b++)
+            out[b] += tot[b];
+        for (i = 0; i < job.nsub; i++)
+            for (b = 0; b < job.buckets; b++)
+                out[b] += c[i * job.buckets + b];
+    }
+
+    AB_vec_destroy(&counts);
+    AB_vec_destroy(&totals);
+    AB_vec_destroy(&pending);
+    return 0;
+}
+/** @brief Count the occurrences of every key in a vector
+ * @param pool Pointer to an AB_vec_pool, or NULL to run serially
+ * @param [out] hist Pointer to an AB_vec of @c uint64_t. Its contents are
+ *  replaced by 256 counts for 1-byte keys or 65536 for 2-byte keys.
+ * @param [in] src Const pointer to an AB_vec of @c uint8_t or @c uint16_t
+ * @return 0 on success, nonzero on error
+ * @note Each thread counts into private sub-histograms of 32-bit counters,
+ *  which are summed into @c hist at the end
+ * @hideinitializer
+ */
+#define AB_vec_histogram(pool, hist, src)                                                          \
+    ((void)sizeof(char[sizeof(*(hist)->elems) == sizeof(uint64_t) ? 1 : -1]),                      \
+     AB_vec_histogram_generic((pool), (struct AB_vector_generic *)(hist),                          \
+         (const struct AB_vector_generic *)(src), sizeof(*(src)->elems)))
+
+#endif /* AMBER_UTIL_VECTOR_NUMERIC_H */
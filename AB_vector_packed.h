@@ -0,0 +1,353 @@
+/** @file AB_vector_packed.h
+ * @brief Compressed, read-only integer sequences built from an AB_vec(uint64_t)
+ *
+ * Values are split into blocks of @c AB_PACKED_BLOCK (128) integers. Each
+ * block is stored relative to a reference value with the minimum number of
+ * bits that fits every entry (frame-of-reference bit-packing):
+ *  - blocks that are non-decreasing store the differences between
+ *    consecutive values (delta coding), so sorted ID lists shrink to the
+ *    width of their gaps,
+ *  - other blocks store each value minus the block minimum.
+ *
+ * Packed words use the 4-lane interleaved layout of SIMD-BP128 (Lemire and
+ * Boytsov, 2015): value @c i lives in 32-bit lane @c i % 4, so one SSE2
+ * register unpacks four values per shift-and-mask. Widths above 32 bits are
+ * stored as a full 32-bit low plane followed by a narrower high plane.
+ *
+ * A small per-block index (reference value, word offset, width and mode)
+ * gives random access within a single block. All storage is made of
+ * AB_vec, so it goes through @c AB_VEC_REALLOC and @c AB_VEC_FREE.
+ *
+ * This header requires C99 (for stdint.h).
+ */
+#ifndef AMBER_UTIL_VECTOR_PACKED_H
+#define AMBER_UTIL_VECTOR_PACKED_H
+
+#include "AB_vector.h"
+#include <stdint.h>
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+/** @brief Number of integers per packed block */
+#define AB_PACKED_BLOCK 128
+
+/** @cond false */
+struct AB_packed_block {
+    uint64_t base;
+    uint32_t offset;
+    unsigned char width;
+    unsigned char delta;
+};
+/** @endcond */
+
+/** @brief A compressed sequence of 64-bit unsigned integers */
+typedef struct AB_packed {
+    /** @cond false */
+    AB_vec(struct AB_packed_block) blocks;
+    AB_vec(uint32_t) words;
+    size_t num;
+    /** @endcond */
+} AB_packed;
+
+/** @brief Initialize an empty AB_packed
+ * @param p Pointer to an AB_packed
+ */
+static AB_VEC_INLINE void
+AB_packed_init(AB_packed *p)
+{
+    AB_VEC_ASSERT(p != NULL);
+    AB_vec_init(&p->blocks);
+    AB_vec_init(&p->words);
+    p->num = 0;
+}
+
+/** @brief Free memory associated with an AB_packed
+ * @param p Pointer to an AB_packed
+ */
+static AB_VEC_INLINE void
+AB_packed_destroy(AB_packed *p)
+{
+    AB_VEC_ASSERT(p != NULL);
+    AB_vec_destroy(&p->blocks);
+    AB_vec_destroy(&p->words);
+}
+
+/** @brief Query the number of integers in the sequence
+ * @param p Pointer to an AB_packed
+ * @return The number of integers
+ */
+static AB_VEC_INLINE size_t
+AB_packed_size(const AB_packed *p)
+{
+    return p->num;
+}
+
+/** @brief Query the memory used by the packed data and its block index
+ * @param p Pointer to an AB_packed
+ * @return Size in bytes, not counting unused capacity
+ */
+static AB_VEC_INLINE size_t
+AB_packed_bytes(const AB_packed *p)
+{
+    return (size_t)p->blocks.num * sizeof(struct AB_packed_block)
+        + (size_t)p->words.num * sizeof(uint32_t);
+}
+
+/* Pack 128 values of at most w <= 32 bits into 4 * w zeroed words */
+static AB_VEC_INLINE void
+AB_packed_pack32(uint32_t *out, const uint32_t *in, unsigned w)
+{
+    unsigned lane, j;
+    if (w == 0)
+        return;
+    for (lane = 0; lane < 4; lane++) {
+        unsigned bit = 0;
+        for (j = 0; j < 32; j++, bit += w) {
+            uint32_t v = in[4 * j + lane];
+            unsigned word = bit / 32, shift = bit % 32;
+            out[4 * word + lane] |= v << shift;
+            if (shift + w > 32)
+                out[4 * (word + 1) + lane] |= v >> (32 - shift);
+        }
+    }
+}
+
+/* Inverse of AB_packed_pack32 */
+static AB_VEC_INLINE void
+AB_packed_unpack32(uint32_t *out, const uint32_t *in, unsigned w)
+{
+    unsigned j, bit;
+#if defined(__SSE2__)
+    __m128i mask = _mm_set1_epi32(w == 32 ? -1 : (int)((1u << w) - 1));
+    if (w == 0) {
+        memset(out, 0, AB_PACKED_BLOCK * sizeof(uint32_t));
+        return;
+    }
+    for (j = 0, bit = 0; j < 32; j++, bit += w) {
+        unsigned word = bit / 32, shift = bit % 32;
+        __m128i v = _mm_srl_epi32(_mm_loadu_si128((const __m128i *)(in + 4 * word)),
+                _mm_cvtsi32_si128((int)shift));
+        if (shift + w > 32) {
+            __m128i hi = _mm_loadu_si128((const __m128i *)(in + 4 * (word + 1)));
+            v = _mm_or_si128(v, _mm_sll_epi32(hi, _mm_cvtsi32_si128((int)(32 - shift))));
+        }
+        _mm_storeu_si128((__m128i *)(out + 4 * j), _mm_and_si128(v, mask));
+    }
+#else
+    uint32_t mask = w == 32 ? 0xffffffffu : (1u << w) - 1;
+    unsigned lane;
+    if (w == 0) {
+        memset(out, 0, AB_PACKED_BLOCK * sizeof(uint32_t));
+        return;
+    }
+    for (j = 0, bit = 0; j < 32; j++, bit += w) {
+        unsigned word = bit / 32, shift = bit % 32;
+        for (lane = 0; lane < 4; lane++) {
+            uint32_t v = in[4 * word + lane] >> shift;
+            if (shift + w > 32)
+                v |= in[4 * (word + 1) + lane] << (32 - shift);
+            out[4 * j + lane] = v & mask;
+        }
+    }
+#endif
+}
+
+/* Extract value k of a block packed with AB_packed_pack32 */
+static AB_VEC_INLINE uint32_t
+AB_packed_extract32(const uint32_t *in, unsigned w, unsigned k)
+{
+    unsigned lane = k % 4, bit = k / 4 * w, word = bit / 32, shift = bit % 32;
+    uint64_t v;
+    if (w == 0)
+        return 0;
+    v = in[4 * word + lane] >> shift;
+    if (shift + w > 32)
+        v |= (uint64_t)in[4 * (word + 1) + lane] << (32 - shift);
+    return (uint32_t)(v & (w == 32 ? 0xffffffffu : (1u << w) - 1));
+}
+
+/* Number of 32-bit words used by a block of the given width */
+static AB_VEC_INLINE size_t
+AB_packed_block_words(unsigned w)
+{
+    return w <= 32 ? 4u * w : AB_PACKED_BLOCK + 4u * (w - 32);
+}
+
+static AB_VEC_INLINE int
+AB_packed_encode_generic(AB_packed *p, const struct AB_vector_generic *vec, size_t elem_size)
+{
+    const uint64_t *in;
+    uint64_t diff[AB_PACKED_BLOCK];
+    uint32_t half[AB_PACKED_BLOCK];
+    size_t b, nblocks;
+
+    AB_VEC_ASSERT(p != NULL && vec != NULL);
+    AB_VEC_ASSERT(elem_size == sizeof(uint64_t));
+    (void)elem_size;
+    in = vec->elems;
+    p->num = vec->num;
+    p->blocks.num = 0;
+    p->words.num = 0;
+    nblocks = (p->num + AB_PACKED_BLOCK - 1) / AB_PACKED_BLOCK;
+    if (AB_vec_reserve(&p->blocks, nblocks))
+        return 1;
+
+    for (b = 0; b < nblocks; b++) {
+        struct AB_packed_block blk;
+        const uint64_t *v = in + b * AB_PACKED_BLOCK;
+        size_t i, n = p->num - b * AB_PACKED_BLOCK;
+        uint64_t max = 0;
+        unsigned w = 0;
+
+        if (n > AB_PACKED_BLOCK)
+            n = AB_PACKED_BLOCK;
+        for (i = 1; i < n && v[i] >= v[i - 1]; i++)
+            ;
+        blk.delta = i == n;
+        blk.base = v[0];
+        if (blk.delta) {
+            diff[0] = 0;
+            for (i = 1; i < n; i++)
+                diff[i] = v[i] - v[i - 1];
+        } else {
+            for (i = 1; i < n; i++)
+                if (v[i] < blk.base)
+                    blk.base = v[i];
+            for (i = 0; i < n; i++)
+                diff[i] = v[i] - blk.base;
+        }
+        for (i = 0; i < n; i++)
+            max |= diff[i];
+        for (i = n; i < AB_PACKED_BLOCK; i++)
+            diff[i] = 0;
+        while (w < 64 && (max >> w) != 0)
+            w++;
+        blk.width = (unsigned char)w;
+        blk.offset = (uint32_t)p->words.num;
+
+        /* Grow geometrically, then zero the block's words for packing */
+        if (p->words.capacity < p->words.num + AB_packed_block_words(w)
+                && AB_vec_resize(&p->words, 2 * p->words.capacity + AB_packed_block_words(w)))
+            return 1;
+        if (AB_vec_resize_zero(&p->words, p->words.num + AB_packed_block_words(w)))
+            return 1;
+        for (i = 0; i < AB_PACKED_BLOCK; i++)
+            half[i] = (uint32_t)diff[i];
+        AB_packed_pack32(p->words.elems + blk.offset, half, w < 32 ? w : 32);
+        if (w > 32) {
+            for (i = 0; i < AB_PACKED_BLOCK; i++)
+                half[i] = (uint32_t)(diff[i] >> 32);
+            AB_packed_pack32(p->words.elems + blk.offset + AB_PACKED_BLOCK, half, w - 32);
+        }
+        p->blocks.elems[p->blocks.num++] = blk;
+    }
+    return 0;
+}
+/** @brief Compress a vector of 64-bit integers
+ * @param p Pointer to an initialized AB_packed, whose contents are replaced
+ * @param [in] vec Const pointer to an AB_vec(uint64_t)
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#define AB_packed_encode(p, vec)                                                                   \
+    AB_packed_encode_generic((p), (const struct AB_vector_generic *)(vec), sizeof(*(vec)->elems))
+
+/* Decode all 128 slots of block b into out */
+static AB_VEC_INLINE void
+AB_packed_decode_block(const AB_packed *p, size_t b, uint64_t *out)
+{
+    const struct AB_packed_block *blk = &p->blocks.elems[b];
+    const uint32_t *words = p->words.elems + blk->offset;
+    uint32_t lo[AB_PACKED_BLOCK], hi[AB_PACKED_BLOCK];
+    unsigned i;
+
+    AB_packed_unpack32(lo, words, blk->width < 32 ? blk->width : 32);
+    if (blk->width > 32) {
+        AB_packed_unpack32(hi, words + AB_PACKED_BLOCK, blk->width - 32u);
+        for (i = 0; i < AB_PACKED_BLOCK; i++)
+            out[i] = (uint64_t)lo[i] | (uint64_t)hi[i] << 32;
+    } else {
+        for (i = 0; i < AB_PACKED_BLOCK; i++)
+            out[i] = lo[i];
+    }
+    if (blk->delta) {
+        uint64_t acc = blk->base;
+        for (i = 0; i < AB_PACKED_BLOCK; i++)
+            out[i] = acc += out[i];
+    } else {
+        for (i = 0; i < AB_PACKED_BLOCK; i++)
+            out[i] += blk->base;
+    }
+}
+
+static AB_VEC_INLINE int
+AB_packed_decode_generic(const AB_packed *p, struct AB_vector_generic *vec, size_t elem_size)
+{
+    uint64_t tmp[AB_PACKED_BLOCK], *out;
+    size_t b, full;
+
+    AB_VEC_ASSERT(p != NULL && vec != NULL);
+    AB_VEC_ASSERT(elem_size == sizeof(uint64_t));
+    if (AB_vec_reserve_generic(vec, (AB_VEC_SIZE_T)p->num, (AB_VEC_SIZE_T)elem_size))
+        return 1;
+    out = vec->elems;
+    full = p->num / AB_PACKED_BLOCK;
+    for (b = 0; b < full; b++)
+        AB_packed_decode_block(p, b, out + b * AB_PACKED_BLOCK);
+    if (full != p->blocks.num) {
+        AB_packed_decode_block(p, full, tmp);
+        memcpy(out + full * AB_PACKED_BLOCK, tmp,
+                (p->num - full * AB_PACKED_BLOCK) * sizeof(uint64_t));
+    }
+    vec->num = (AB_VEC_SIZE_T)p->num;
+    return 0;
+}
+/** @brief Decompress the whole sequence into a vector
+ * @param p Pointer to an AB_packed
+ * @param [out] vec Pointer to an AB_vec(uint64_t), whose contents are replaced
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#define AB_packed_decode(p, vec)                                                                   \
+    AB_packed_decode_generic((p), (struct AB_vector_generic *)(vec), sizeof(*(vec)->elems))
+
+/** @brief Read a single integer
+ * @param p Pointer to an AB_packed
+ * @param idx Index of the integer, must be less than @c AB_packed_size()
+ * @return The integer at that index
+ * @note Delta-coded blocks have to be decoded up to @c idx, so use
+ *  @c AB_packed_decode() for sequential access
+ */
+static AB_VEC_INLINE uint64_t
+AB_packed_get(const AB_packed *p, size_t idx)
+{
+    const struct AB_packed_block *blk;
+    const uint32_t *words;
+    unsigned i, k = (unsigned)(idx % AB_PACKED_BLOCK);
+    uint32_t tmp[AB_PACKED_BLOCK];
+    uint64_t v;
+
+    AB_VEC_ASSERT(idx < p->num);
+    blk = &p->blocks.elems[idx / AB_PACKED_BLOCK];
+    words = p->words.elems + blk->offset;
+    if (blk->delta) {
+        /* Sum the gaps up to k */
+        v = blk->base;
+        AB_packed_unpack32(tmp, words, blk->width < 32 ? blk->width : 32);
+        for (i = 0; i <= k; i++)
+            v += tmp[i];
+        if (blk->width > 32) {
+            AB_packed_unpack32(tmp, words + AB_PACKED_BLOCK, blk->width - 32u);
+            for (i = 0; i <= k; i++)
+                v += (uint64_t)tmp[i] << 32;
+        }
+        return v;
+    }
+    v = AB_packed_extract32(words, blk->width < 32 ? blk->width : 32, k);
+    if (blk->width > 32)
+        v |= (uint64_t)AB_packed_extract32(words + AB_PACKED_BLOCK, blk->width - 32u, k) << 32;
+    return blk->base + v;
+}
+
+#endif /* AMBER_UTIL_VECTOR_PACKED_H */
@@ -0,0 +1,863 @@
+/** @file AB_vector_parallel.h
+ * @brief Data-parallel loops over AB_vec backed by a work-stealing thread pool
+ *
+ * The pool keeps its worker threads alive between calls, so a single
+ * @c AB_vec_pool can be reused for every data-parallel loop in a program.
+ * Work is handed out as index ranges: each worker starts with a contiguous
+ * section of the vector and lazily splits it in half while it is larger than
+ * the grain size, leaving the other half on its own deque where idle workers
+ * can steal it. The per-worker deques are the lock-free Chase-Lev deques
+ * from AB_vector_deque.h, so owners never take a lock. Split points are
+ * snapped to cache-line boundaries of the written buffer so two threads
+ * never write to the same line.
+ *
+ * Callbacks receive whole chunks (pointer + count) rather than single
+ * elements, so the inner loop stays in user code where the compiler can
+ * vectorize it.
+ *
+ * This header requires POSIX threads and the GCC-style @c __atomic builtins
+ * (GCC, Clang, ICC). The pool is not reentrant: do not call into a pool from
+ * one of its own callbacks, and do not share one pool between threads that
+ * submit work concurrently.
+ *
+ * Macro-options:
+ *  - AB_VEC_CACHELINE
+ *    Size in bytes of a cache line, used for chunk boundaries and padding.
+ *    Defaults to 64.
+ *
+ *  - AB_VEC_PARALLEL_MIN_BYTES
+ *    Vectors smaller than this many bytes are processed serially on the
+ *    calling thread. Defaults to 64 KiB.
+ *
+ *  - AB_VEC_PARALLEL_SPLIT
+ *    Target number of chunks per thread. Higher values balance irregular
+ *    workloads better at the cost of more deque traffic. Defaults to 8.
+ *
+ *  - AB_VEC_STREAM_MIN_BYTES
+ *    Copies and fills at least this large use non-temporal (streaming)
+ *    stores on x86 so they don't evict the working set from the cache.
+ *    Defaults to 8 MiB. Define it to 0 to disable streaming stores.
+ *
+ */
+#ifndef AMBER_UTIL_VECTOR_PARALLEL_H
+#define AMBER_UTIL_VECTOR_PARALLEL_H
+
+#include "AB_vector.h"
+#include "AB_vector_algo.h"
+#include "AB_vector_deque.h"
+#include <pthread.h>
+#include <sched.h>  /* sched_yield */
+#include <unistd.h> /* sysconf */
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+#if !defined(__GNUC__) && !defined(__DOXYGEN__)
+# error "AB_vector_parallel.h requires GCC-style __atomic builtins"
+#endif
+
+/**************************************************************************
+ *
+ * User-Defined / Configuration Macros
+ *
+ *************************************************************************/
+
+/** @brief Cache line size in bytes
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_CACHELINE
+# define AB_VEC_CACHELINE 64
+#endif
+
+/** @brief Minimum vector size in bytes worth splitting across threads
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_PARALLEL_MIN_BYTES
+# define AB_VEC_PARALLEL_MIN_BYTES 65536
+#endif
+
+/** @brief Target number of chunks handed to each thread
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_PARALLEL_SPLIT
+# define AB_VEC_PARALLEL_SPLIT 8
+#endif
+
+/** @brief Minimum size in bytes for copies and fills to bypass the cache
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_STREAM_MIN_BYTES
+# define AB_VEC_STREAM_MIN_BYTES (8u << 20)
+#endif
+
+/**************************************************************************
+ *
+ * Thread pool
+ *
+ *************************************************************************/
+
+/** @brief Range callback used by @c AB_vec_pool_run()
+ * @param ctx User context
+ * @param begin First index of the range
+ * @param end One past the last index of the range
+ * @param worker Index of the executing worker, in [0, nthreads)
+ */
+typedef void (*AB_vec_pool_fn)(void *ctx, size_t begin, size_t end, unsigned worker);
+
+/** @cond false */
+struct AB_vec_range {
+    size_t begin, end;
+};
+
+struct AB_vec_pool;
+
+struct AB_vec_pool_worker {
+    AB_deque(struct AB_vec_range) tasks;
+    unsigned id, seed;
+    pthread_t thread;
+    struct AB_vec_pool *pool;
+    char pad[AB_VEC_CACHELINE];
+};
+/** @endcond */
+
+/** @brief A reusable work-stealing thread pool
+ * @note The calling thread always acts as worker 0, so a pool of
+ *  @c nthreads threads spawns @c nthreads - 1 threads.
+ */
+typedef struct AB_vec_pool {
+    /** @cond false */
+    AB_vec(struct AB_vec_pool_worker) workers;
+    AB_epoch epoch;
+    unsigned nthreads;
+    pthread_mutex_t lock;
+    pthread_cond_t wake, done;
+    unsigned long generation;
+    unsigned active;
+    int shutdown;
+    /* Current job */
+    AB_vec_pool_fn fn;
+    void *ctx;
+    size_t grain, step, phase;
+    size_t remaining;
+    /** @endcond */
+} AB_vec_pool;
+
+/* Owner end of a worker's deque */
+static AB_VEC_INLINE int
+AB_vec_pool_push(struct AB_vec_pool_worker *w, const struct AB_vec_range *r)
+{
+    return AB_deque_push(&w->tasks, r);
+}
+
+static AB_VEC_INLINE int
+AB_vec_pool_pop(struct AB_vec_pool_worker *w, struct AB_vec_range *r)
+{
+    return AB_deque_pop(&w->tasks, r) == AB_DEQUE_OK;
+}
+
+/* Thief end: sweep the other workers from a random start, retrying a
+ * victim when another thief beat us to its top element */
+static AB_VEC_INLINE int
+AB_vec_pool_steal_any(AB_vec_pool *pool, struct AB_vec_pool_worker *w, struct AB_vec_range *r)
+{
+    unsigned i, victim;
+    w->seed ^= w->seed << 13;
+    w->seed ^= w->seed >> 17;
+    w->seed ^= w->seed << 5;
+    victim = w->seed % pool->nthreads;
+    for (i = 0; i < pool->nthreads; i++, victim = (victim + 1) % pool->nthreads) {
+        int result;
+        if (victim == w->id)
+            continue;
+        do {
+            result = AB_deque_steal(&pool->workers.elems[victim].tasks, r, w->id);
+        } while (result == AB_DEQUE_ABORT);
+        if (result == AB_DEQUE_OK)
+            return 1;
+    }
+    return 0;
+}
+
+/* Round an index down to the nearest cache-line boundary of the output */
+static AB_VEC_INLINE size_t
+AB_vec_pool_snap(const AB_vec_pool *pool, size_t idx)
+{
+    if (idx < pool->phase)
+        return idx;
+    return idx - (idx - pool->phase) % pool->step;
+}
+
+static AB_VEC_INLINE void
+AB_vec_pool_exec(AB_vec_pool *pool, struct AB_vec_pool_worker *w, struct AB_vec_range r)
+{
+    /* Lazy binary splitting: keep the front half, publish the back half */
+    while (r.end - r.begin >= 2 * pool->grain) {
+        struct AB_vec_range rest;
+        rest.begin = AB_vec_pool_snap(pool, r.begin + (r.end - r.begin) / 2);
+        rest.end = r.end;
+        if (rest.begin <= r.begin || AB_vec_pool_push(w, &rest))
+            break;
+        r.end = rest.begin;
+    }
+    pool->fn(pool->ctx, r.begin, r.end, w->id);
+    __atomic_fetch_sub(&pool->remaining, r.end - r.begin, __ATOMIC_ACQ_REL);
+}
+
+static AB_VEC_INLINE void
+AB_vec_pool_work(AB_vec_pool *pool, struct AB_vec_pool_worker *w)
+{
+    struct AB_vec_range r;
+    while (__atomic_load_n(&pool->remaining, __ATOMIC_ACQUIRE) != 0) {
+        if (AB_vec_pool_pop(w, &r) || AB_vec_pool_steal_any(pool, w, &r))
+            AB_vec_pool_exec(pool, w, r);
+        else
+            sched_yield();
+    }
+}
+
+static AB_VEC_INLINE void *
+AB_vec_pool_main(void *arg)
+{
+    struct AB_vec_pool_worker *w = arg;
+    AB_vec_pool *pool = w->pool;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->shutdown)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->shutdown)
+            break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        AB_vec_pool_work(pool, w);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/** @brief Start a thread pool
+ * @param pool Pointer to an uninitialized AB_vec_pool
+ * @param nthreads Number of threads including the caller, or 0 to use
+ *  the number of online processors
+ * @return 0 on success, nonzero on error
+ * @note If some threads fail to start, the pool runs with fewer threads
+ */
+static AB_VEC_INLINE int
+AB_vec_pool_init(AB_vec_pool *pool, unsigned nthreads)
+{
+    unsigned i;
+    AB_VEC_ASSERT(pool != NULL);
+    if (nthreads == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = n > 0 ? (unsigned)n : 1;
+    }
+
+    AB_vec_init(&pool->workers);
+    if (AB_vec_resize(&pool->workers, nthreads))
+        return 1;
+    pool->workers.num = nthreads;
+    if (AB_epoch_init(&pool->epoch, nthreads)) {
+        AB_vec_destroy(&pool->workers);
+        return 1;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->generation = 0;
+    pool->active = 0;
+    pool->shutdown = 0;
+    pool->remaining = 0;
+
+    for (i = 0; i < nthreads; i++) {
+        struct AB_vec_pool_worker *w = &pool->workers.elems[i];
+        AB_deque_init(&w->tasks, &pool->epoch);
+        w->id = i;
+        w->seed = i * 2654435761u + 1;
+        w->pool = pool;
+    }
+
+    pool->nthreads = 1;
+    for (i = 1; i < nthreads; i++) {
+        if (pthread_create(&pool->workers.elems[i].thread, NULL,
+                    AB_vec_pool_main, &pool->workers.elems[i]) != 0)
+            break;
+        pool->nthreads++;
+    }
+    return 0;
+}
+
+/** @brief Stop all threads and free memory associated with a pool
+ * @param pool Pointer to an initialized AB_vec_pool
+ */
+static AB_VEC_INLINE void
+AB_vec_pool_destroy(AB_vec_pool *pool)
+{
+    unsigned i;
+    AB_VEC_ASSERT(pool != NULL);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 1; i < pool->nthreads; i++)
+        pthread_join(pool->workers.elems[i].thread, NULL);
+    for (i = 0; i < AB_vec_size(&pool->workers); i++)
+        AB_deque_destroy(&pool->workers.elems[i].tasks);
+    AB_vec_destroy(&pool->workers);
+    AB_epoch_destroy(&pool->epoch);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+/** @brief Query the number of threads (including the caller) of a pool
+ * @param pool Pointer to an AB_vec_pool, or NULL
+ * @return The thread count, 1 for a NULL pool
+ */
+static AB_VEC_INLINE unsigned
+AB_vec_pool_size(const AB_vec_pool *pool)
+{
+    return pool != NULL ? pool->nthreads : 1;
+}
+
+/** @brief Run a range callback over [0, n) on the pool
+ * @param pool Pointer to an AB_vec_pool, or NULL to run on the calling thread
+ * @param base Address of element 0 of the buffer being written, used to
+ *  keep chunk boundaries on cache lines. May be NULL.
+ * @param elem_size Size of one element of @c base
+ * @param n Number of elements
+ * @param fn Callback invoked with disjoint sub-ranges covering [0, n)
+ * @param ctx User context passed to @c fn
+ * @note Small inputs (see @c AB_VEC_PARALLEL_MIN_BYTES) run serially as a
+ *  single call on worker 0
+ */
+static AB_VEC_INLINE void
+AB_vec_pool_run(AB_vec_pool *pool, const void *base, size_t elem_size, size_t n,
+        AB_vec_pool_fn fn, void *ctx)
+{
+    size_t i, step, prev;
+    unsigned t;
+
+    if (n == 0)
+        return;
+    if (pool == NULL || pool->nthreads == 1 || n * elem_size < AB_VEC_PARALLEL_MIN_BYTES) {
+        fn(ctx, 0, n, 0);
+        return;
+    }
+
+    /* Smallest run of elements that spans whole cache lines, and the first
+     * index that starts on one */
+    step = AB_VEC_CACHELINE;
+    for (i = elem_size; i != 0; ) {
+        size_t r = step % i;
+        step = i;
+        i = r;
+    }
+    step = AB_VEC_CACHELINE / step;
+    pool->step = step;
+    pool->phase = 0;
+    for (i = 0; base != NULL && i < step; i++) {
+        if (((size_t)base + i * elem_size) % AB_VEC_CACHELINE == 0) {
+            pool->phase = i;
+            break;
+        }
+    }
+    pool->grain = n / ((size_t)pool->nthreads * AB_VEC_PARALLEL_SPLIT);
+    if (pool->grain < AB_VEC_CACHELINE * step)
+        pool->grain = AB_VEC_CACHELINE * step;
+    pool->fn = fn;
+    pool->ctx = ctx;
+    __atomic_store_n(&pool->remaining, n, __ATOMIC_RELAXED);
+
+    /* Seed each worker with one contiguous section */
+    prev = 0;
+    for (t = 0; t < pool->nthreads; t++) {
+        struct AB_vec_range r;
+        r.begin = prev;
+        r.end = t + 1 == pool->nthreads ? n
+            : AB_vec_pool_snap(pool, (size_t)((double)n * (t + 1) / pool->nthreads));
+        if (r.end <= r.begin)
+            continue;
+        if (AB_vec_pool_push(&pool->workers.elems[t], &r)) {
+            /* Out of memory: let the previous worker take this section too */
+            continue;
+        }
+        prev = r.end;
+    }
+    if (prev != n) {
+        fn(ctx, prev, n, 0);
+        __atomic_fetch_sub(&pool->remaining, n - prev, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->active = pool->nthreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    AB_vec_pool_work(pool, &pool->workers.elems[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active != 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**************************************************************************
+ *
+ * Parallel algorithms
+ *
+ *************************************************************************/
+
+/** @brief Chunk callback for @c AB_vec_parallel_for()
+ * @param elems Pointer to the first element of the chunk
+ * @param n Number of elements in the chunk
+ * @param ctx User context
+ */
+typedef void (*AB_vec_for_fn)(void *elems, size_t n, void *ctx);
+
+/** @brief Chunk callback for @c AB_vec_parallel_transform()
+ * @param dest Pointer to the first destination element of the chunk
+ * @param src Pointer to the first source element of the chunk
+ * @param n Number of elements in the chunk
+ * @param ctx User context
+ */
+typedef void (*AB_vec_transform_fn)(void *dest, const void *src, size_t n, void *ctx);
+
+/** @brief Chunk callback for @c AB_vec_parallel_reduce()
+ * @param acc Pointer to the accumulator to fold the chunk into
+ * @param elems Pointer to the first element of the chunk
+ * @param n Number of elements in the chunk
+ * @param ctx User context
+ */
+typedef void (*AB_vec_reduce_fn)(void *acc, const void *elems, size_t n, void *ctx);
+
+/** @brief Combine callback for @c AB_vec_parallel_reduce()
+ * @param acc Pointer to the accumulator to update
+ * @param other Pointer to another partial result
+ * @param ctx User context
+ */
+typedef void (*AB_vec_combine_fn)(void *acc, const void *other, void *ctx);
+
+/** @cond false */
+struct AB_vec_parallel_job {
+    char *dest;
+    const char *src;
+    size_t dest_size, src_size;
+    char *partials;
+    size_t stride;
+    int stream;
+    union {
+        AB_vec_for_fn each;
+        AB_vec_transform_fn transform;
+        AB_vec_reduce_fn reduce;
+    } fn;
+    void *ctx;
+};
+/** @endcond */
+
+static AB_VEC_INLINE void
+AB_vec_parallel_for_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_parallel_job *job = ctx;
+    (void)worker;
+    job->fn.each(job->dest + begin * job->dest_size, end - begin, job->ctx);
+}
+
+static AB_VEC_INLINE int
+AB_vec_parallel_for_generic(AB_vec_pool *pool, struct AB_vector_generic *vec,
+        size_t elem_size, AB_vec_for_fn fn, void *ctx)
+{
+    struct AB_vec_parallel_job job;
+    AB_VEC_ASSERT(vec != NULL);
+    job.dest = vec->elems;
+    job.dest_size = elem_size;
+    job.fn.each = fn;
+    job.ctx = ctx;
+    AB_vec_pool_run(pool, vec->elems, elem_size, vec->num, AB_vec_parallel_for_thunk, &job);
+    return 0;
+}
+/** @brief Apply a chunk callback to every element of a vector in parallel
+ * @param pool Pointer to an AB_vec_pool, or NULL to run serially
+ * @param vec Pointer to the AB_vec
+ * @param fn An @c AB_vec_for_fn, called on disjoint chunks of the vector
+ * @param ctx User context passed to @c fn
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#define AB_vec_parallel_for(pool, vec, fn, ctx)                                                    \
+    AB_vec_parallel_for_generic((pool), (struct AB_vector_generic *)(vec),                         \
+            sizeof(*(vec)->elems), (fn), (ctx))
+
+static AB_VEC_INLINE void
+AB_vec_parallel_transform_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_parallel_job *job = ctx;
+    (void)worker;
+    job->fn.transform(job->dest + begin * job->dest_size,
+            job->src + begin * job->src_size, end - begin, job->ctx);
+}
+
+static AB_VEC_INLINE int
+AB_vec_parallel_transform_generic(AB_vec_pool *pool,
+        struct AB_vector_generic *dest, size_t dest_size,
+        const struct AB_vector_generic *src, size_t src_size,
+        AB_vec_transform_fn fn, void *ctx)
+{
+    struct AB_vec_parallel_job job;
+    AB_VEC_ASSERT(dest != NULL);
+    AB_VEC_ASSERT(src != NULL);
+    if (dest->capacity < src->num) {
+        int err = AB_vec_resize_generic(dest, src->num, dest_size);
+        if (err)
+            return 1;
+    }
+    job.dest = dest->elems;
+    job.src = src->elems;
+    job.dest_size = dest_size;
+    job.src_size = src_size;
+    job.fn.transform = fn;
+    job.ctx = ctx;
+    AB_vec_pool_run(pool, dest->elems, dest_size, src->num, AB_vec_parallel_transform_thunk, &job);
+    dest->num = src->num;
+    return 0;
+}
+/** @brief Map every element of @c src into @c dest in parallel
+ * @param pool Pointer to an AB_vec_pool, or NULL to run serially
+ * @param [out] dest Pointer to the destination AB_vec, resized at most once
+ * @param [in] src Const pointer to the source AB_vec
+ * @param fn An @c AB_vec_transform_fn, called on matching chunks
+ * @param ctx User context passed to @c fn
+ * @return 0 on success, nonzero on error
+ * @note The element types of @c dest and @c src may differ
+ * @note @c dest and @c src may be the same vector if the types match
+ * @hideinitializer
+ */
+#define AB_vec_parallel_transform(pool, dest, src, fn, ctx)                                        \
+    AB_vec_parallel_transform_generic((pool),                                                      \
+            (struct AB_vector_generic *)(dest), sizeof(*(dest)->elems),                            \
+            (const struct AB_vector_generic *)(src), sizeof(*(src)->elems), (fn), (ctx))
+
+static AB_VEC_INLINE void
+AB_vec_parallel_reduce_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_parallel_job *job = ctx;
+    job->fn.reduce(job->partials + worker * job->stride,
+            job->src + begin * job->src_size, end - begin, job->ctx);
+}
+
+static AB_VEC_INLINE int
+AB_vec_parallel_reduce_generic(AB_vec_pool *pool,
+        const struct AB_vector_generic *vec, size_t elem_size,
+        void *result, size_t result_size,
+        AB_vec_reduce_fn fn, AB_vec_combine_fn combine, void *ctx)
+{
+    struct AB_vec_parallel_job job;
+    AB_vec(char) partials = AB_VEC_INIT;
+    unsigned t, nthreads = AB_vec_pool_size(pool);
+    AB_VEC_ASSERT(vec != NULL);
+    AB_VEC_ASSERT(result != NULL);
+
+    if (nthreads == 1 || vec->num * elem_size < AB_VEC_PARALLEL_MIN_BYTES) {
+        fn(result, vec->elems, vec->num, ctx);
+        return 0;
+    }
+
+    /* One cache-line padded accumulator per worker, seeded with the identity */
+    job.stride = (result_size + AB_VEC_CACHELINE - 1) / AB_VEC_CACHELINE * AB_VEC_CACHELINE;
+    if (AB_vec_resize(&partials, job.stride * nthreads))
+        return 1;
+    for (t = 0; t < nthreads; t++)
+        memcpy(partials.elems + t * job.stride, result, result_size);
+
+    job.partials = partials.elems;
+    job.src = vec->elems;
+    job.src_size = elem_size;
+    job.fn.reduce = fn;
+    job.ctx = ctx;
+    AB_vec_pool_run(pool, vec->elems, elem_size, vec->num, AB_vec_parallel_reduce_thunk, &job);
+
+    for (t = 0; t < nthreads; t++)
+        combine(result, partials.elems + t * job.stride, ctx);
+    AB_vec_destroy(&partials);
+    return 0;
+}
+/** @brief Fold every element of a vector into a single value in parallel
+ * @param pool Pointer to an AB_vec_pool, or NULL to run serially
+ * @param [in] vec Const pointer to the AB_vec
+ * @param [in, out] result Pointer to the result. On entry it must hold the
+ *  identity of @c combine, since it also seeds each worker's accumulator.
+ * @param fn An @c AB_vec_reduce_fn folding a chunk into an accumulator
+ * @param combine An @c AB_vec_combine_fn merging two accumulators
+ * @param ctx User context passed to @c fn and @c combine
+ * @return 0 on success, nonzero on error
+ * @note Chunks are folded in an unspecified order, so @c combine should be
+ *  associative and commutative
+ * @hideinitializer
+ */
+#define AB_vec_parallel_reduce(pool, vec, result, fn, combine, ctx)                                \
+    AB_vec_parallel_reduce_generic((pool), (const struct AB_vector_generic *)(vec),                \
+            sizeof(*(vec)->elems), (result), sizeof(*(result)), (fn), (combine), (ctx))
+
+/**************************************************************************
+ *
+ * Bulk copy and fill
+ *
+ *************************************************************************/
+
+/* Copy bytes, using streaming stores for the 16-byte aligned body */
+static AB_VEC_INLINE void
+AB_vec_stream_copy(char *dest, const char *src, size_t bytes, int stream)
+{
+#if defined(__SSE2__)
+    if (stream && bytes >= 128) {
+        size_t head = (16 - (size_t)dest % 16) % 16;
+        memcpy(dest, src, head);
+        dest += head;
+        src += head;
+        bytes -= head;
+        for (; bytes >= 64; bytes -= 64, dest += 64, src += 64) {
+            __m128i a = _mm_loadu_si128((const __m128i *)src);
+            __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+            __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+            __m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+            _mm_stream_si128((__m128i *)dest, a);
+            _mm_stream_si128((__m128i *)(dest + 16), b);
+            _mm_stream_si128((__m128i *)(dest + 32), c);
+            _mm_stream_si128((__m128i *)(dest + 48), d);
+        }
+        _mm_sfence();
+    }
+#else
+    (void)stream;
+#endif
+    memcpy(dest, src, bytes);
+}
+
+/* Fill elements [begin, end) of base with a copy of value */
+static AB_VEC_INLINE void
+AB_vec_stream_fill(char *base, size_t elem_size, size_t begin, size_t end,
+        const char *value, int stream)
+{
+#if defined(__SSE2__)
+    /* Element sizes dividing 16 tile a vector register exactly, so once an
+     * element starts on a 16-byte boundary the body is one repeated store */
+    if (stream && 16 % elem_size == 0 && (end - begin) * elem_size >= 128) {
+        char pattern[16];
+        size_t i;
+        __m128i v;
+        for (; begin < end && (size_t)(base + begin * elem_size) % 16 != 0; begin++)
+            memcpy(base + begin * elem_size, value, elem_size);
+        if ((end - begin) * elem_size >= 64) {
+            char *dest = base + begin * elem_size;
+            size_t bytes = (end - begin) * elem_size & ~(size_t)63;
+            for (i = 0; i < 16; i += elem_size)
+                memcpy(pattern + i, value, elem_size);
+            v = _mm_loadu_si128((const __m128i *)pattern);
+            for (i = 0; i < bytes; i += 64) {
+                _mm_stream_si128((__m128i *)(dest + i), v);
+                _mm_stream_si128((__m128i *)(dest + i + 16), v);
+                _mm_stream_si128((__m128i *)(dest + i + 32), v);
+                _mm_stream_si128((__m128i *)(dest + i + 48), v);
+            }
+            _mm_sfence();
+            begin += bytes / elem_size;
+        }
+    }
+#else
+    (void)stream;
+#endif
+    if (begin == end)
+        return;
+    memcpy(base + begin * elem_size, value, elem_size);
+    AB_vec_fill_generic(base + begin * elem_size, end - begin, elem_size);
+}
+
+static AB_VEC_INLINE void
+AB_vec_copy_parallel_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_parallel_job *job = ctx;
+    (void)worker;
+    AB_vec_stream_copy(job->dest + begin * job->dest_size, job->src + begin * job->dest_size,
+            (end - begin) * job->dest_size, job->stream);
+}
+
+static AB_VEC_INLINE int
+AB_vec_copy_parallel_generic(AB_vec_pool *pool, struct AB_vector_generic *dest,
+        const struct AB_vector_generic *src, size_t elem_size)
+{
+    struct AB_vec_parallel_job job;
+    AB_VEC_CHECK(src != NULL);
+    AB_VEC_CHECK(dest != NULL);
+    if (dest->capacity < src->capacity) {
+        int err = AB_vec_resize_generic(dest, src->capacity, (AB_VEC_SIZE_T)elem_size);
+        if (err)
+            return 1;
+    }
+    job.dest = dest->elems;
+    job.src = src->elems;
+    job.dest_size = elem_size;
+    job.stream = AB_VEC_STREAM_MIN_BYTES != 0
+        && (size_t)src->num * elem_size >= AB_VEC_STREAM_MIN_BYTES;
+    AB_vec_pool_run(pool, dest->elems, elem_size, src->num, AB_vec_copy_parallel_thunk, &job);
+    dest->num = src->num;
+    return 0;
+}
+/** @brief Copy a vector from src to dest, splitting the work across a pool
+ * @param pool Pointer to an AB_vec_pool, or NULL to copy on the calling thread
+ * @param [in, out] dest Pointer to an AB_vec
+ * @param [in] src Const pointer to an AB_vec
+ * @return 0 on success, nonzero on error
+ * @note Unlike @c AB_vec_copy(), only the @c size elements in use are copied
+ * @note Copies of at least @c AB_VEC_STREAM_MIN_BYTES bypass the cache
+ * @hideinitializer
+ */
+#define AB_vec_copy_parallel(pool, dest, src)                                                      \
+    AB_vec_copy_parallel_generic((pool), (struct AB_vector_generic *)(dest),                       \
+            (const struct AB_vector_generic *)(src), sizeof(*(dest)->elems))
+
+static AB_VEC_INLINE void
+AB_vec_fill_parallel_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_parallel_job *job = ctx;
+    (void)worker;
+    AB_vec_stream_fill(job->dest, job->dest_size, begin, end, job->src, job->stream);
+}
+
+static AB_VEC_INLINE int
+AB_vec_fill_parallel_generic(AB_vec_pool *pool, struct AB_vector_generic *vec, size_t elem_size)
+{
+    struct AB_vec_parallel_job job;
+    AB_vec(char) value = AB_VEC_INIT;
+    char local[AB_VEC_CACHELINE];
+
+    /* Every chunk reads the pattern, so keep it out of the written range */
+    if (elem_size <= sizeof(local)) {
+        job.src = local;
+    } else {
+        if (AB_vec_resize(&value, elem_size))
+            return 1;
+        job.src = value.elems;
+    }
+    memcpy((char *)job.src, vec->elems, elem_size);
+    job.dest = vec->elems;
+    job.dest_size = elem_size;
+    job.stream = AB_VEC_STREAM_MIN_BYTES != 0
+        && (size_t)vec->num * elem_size >= AB_VEC_STREAM_MIN_BYTES;
+    AB_vec_pool_run(pool, vec->elems, elem_size, vec->num, AB_vec_fill_parallel_thunk, &job);
+    AB_vec_destroy(&value);
+    return 0;
+}
+/** @brief Set every element of the vector to a value, splitting the work
+ *  across a pool
+ * @param pool Pointer to an AB_vec_pool, or NULL to fill on the calling thread
+ * @param vec Pointer to the AB_vec
+ * @param value The value to store in indexes [0, size)
+ * @return 0 on success, nonzero on error
+ * @note Fills of at least @c AB_VEC_STREAM_MIN_BYTES bypass the cache
+ * @hideinitializer
+ */
+#define AB_vec_fill_parallel(pool, vec, value)                                                     \
+    (AB_VEC_CHECK((vec) != NULL), (vec)->num == 0 ? 0 :                                            \
+        ((vec)->elems[0] = (value),                                                                \
+         AB_vec_fill_parallel_generic((pool), (struct AB_vector_generic *)(vec),                   \
+             sizeof(*(vec)->elems))))
+
+/**************************************************************************
+ *
+ * Merging
+ *
+ *************************************************************************/
+
+/** @cond false */
+struct AB_vec_merge_job {
+    char *out;
+    const char *a, *b;
+    size_t na, nb, elem_size;
+    AB_vec_cmp_fn cmp;
+};
+/** @endcond */
+
+/* Merge path: how many of the first d outputs come from a. Binary search
+ * along the cross diagonal d of the a x b grid for the point where the
+ * stable merge switches over. */
+static AB_VEC_INLINE size_t
+AB_vec_merge_path(const struct AB_vec_merge_job *job, size_t d)
+{
+    size_t lo = d > job->nb ? d - job->nb : 0;
+    size_t hi = d < job->na ? d : job->na;
+    while (lo < hi) {
+        size_t m = lo + (hi - lo) / 2;
+        if (!AB_vec_cmp_less(job->b + (d - m - 1) * job->elem_size,
+                    job->a + m * job->elem_size, job->elem_size, job->cmp))
+            lo = m + 1;
+        else
+            hi = m;
+    }
+    return lo;
+}
+
+static AB_VEC_INLINE void
+AB_vec_merge_parallel_thunk(void *ctx, size_t begin, size_t end, unsigned worker)
+{
+    struct AB_vec_merge_job *job = ctx;
+    size_t i0 = AB_vec_merge_path(job, begin), i1 = AB_vec_merge_path(job, end);
+    (void)worker;
+    AB_vec_merge_kernel(job->out + begin * job->elem_size,
+            job->a + i0 * job->elem_size, i1 - i0,
+            job->b + (begin - i0) * job->elem_size, (end - i1) - (begin - i0),
+            job->elem_size, job->cmp);
+}
+
+static AB_VEC_INLINE int
+AB_vec_merge_parallel_generic(AB_vec_pool *pool, struct AB_vector_generic *dest,
+        const struct AB_vector_generic *a, const struct AB_vector_generic *b,
+        size_t elem_size, AB_vec_cmp_fn cmp)
+{
+    struct AB_vec_merge_job job;
+    AB_VEC_CHECK(dest != NULL && a != NULL && b != NULL);
+    AB_VEC_CHECK(dest != a && dest != b);
+    AB_VEC_CHECK(cmp != NULL || elem_size == 4 || elem_size == 8);
+    if (AB_vec_reserve_generic(dest, a->num + b->num, (AB_VEC_SIZE_T)elem_size))
+        return 1;
+    job.out = dest->elems;
+    job.a = a->elems;
+    job.b = b->elems;
+    job.na = a->num;
+    job.nb = b->num;
+    job.elem_size = elem_size;
+    job.cmp = cmp;
+    /* Chunks are ranges of the output, so the work splits evenly however
+     * the inputs interleave; each chunk finds its inputs by merge path */
+    AB_vec_pool_run(pool, dest->elems, elem_size, job.na + job.nb,
+            AB_vec_merge_parallel_thunk, &job);
+    dest->num = a->num + b->num;
+    return 0;
+}
+/** @brief Merge two sorted vectors into a third, splitting the work across
+ *  a pool
+ * @param pool Pointer to an AB_vec_pool, or NULL to merge serially
+ * @param [out] dest Pointer to the destination AB_vec, distinct from both
+ *  inputs. Its contents are replaced.
+ * @param [in] a Const pointer to a sorted AB_vec
+ * @param [in] b Const pointer to a sorted AB_vec of the same type
+ * @param cmp An @c AB_vec_cmp_fn, or NULL for 4- or 8-byte unsigned integers
+ * @return 0 on success, nonzero on error
+ * @note The result is identical to @c AB_vec_merge(), including the order
+ *  of equal elements
+ * @hideinitializer
+ */
+#define AB_vec_merge_parallel(pool, dest, a, b, cmp)                                               \
+    AB_vec_merge_parallel_generic((pool), (struct AB_vector_generic *)(dest),                      \
+            (const struct AB_vector_generic *)(a), (const struct AB_vector_generic *)(b),          \
+            sizeof(*(dest)->elems), (cmp))
+
+#endif /* AMBER_UTIL_VECTOR_PARALLEL_H */
@@ -0,0 +1,380 @@
+/** @file AB_vector_prealloc.h
+ * @brief Allocating the next buffer of a growing AB_vec on a helper thread
+ *
+ * Growing a large vector costs more than the copy: the new buffer has to
+ * come from the allocator, usually under a lock, and every one of its
+ * pages faults on first write. With this header, a vector can be attached
+ * to an @c AB_vec_prealloc. Once its size passes a chosen fraction of its
+ * capacity, a helper thread allocates the buffer of the next growth and
+ * writes one byte per page of it. The growth in @c AB_vec_push() then
+ * finds the buffer ready and only copies the elements.
+ *
+ * The header installs itself as the @c AB_VEC_REALLOC hook and turns on
+ * @c AB_VEC_INCLUDE_USERDATA, where attached vectors keep a pointer to
+ * their @c AB_vec_prealloc. Vectors with a NULL userdata, which is every
+ * vector that is not attached, reallocate as usual. It therefore has to be
+ * included before AB_vector.h and any other header that includes it.
+ *
+ * The size check runs in @c AB_vec_prealloc_push() and
+ * @c AB_vec_prealloc_pushp(). A growth that happens before the helper is
+ * done reallocates as usual, and the late buffer is freed.
+ *
+ * Macro-options (besides those of AB_vector.h):
+ *  - AB_VEC_PREALLOC_FALLBACK(ptr, old_size, new_size)
+ *    Reallocation used when no buffer is ready. Defaults to @c realloc.
+ *    Buffers are allocated with @c malloc and freed with @c free.
+ *
+ *  - AB_VEC_PREALLOC_MIN
+ *    Growths to fewer bytes than this are not prepared in the background.
+ *    Defaults to 1 MiB.
+ *
+ *  - AB_VEC_PREALLOC_PAGE
+ *    Stride in bytes of the writes that fault in a buffer. Defaults to 4096.
+ *
+ * This header requires POSIX threads and the GCC-style @c __atomic builtins.
+ */
+#ifndef AMBER_UTIL_VECTOR_PREALLOC_H
+#define AMBER_UTIL_VECTOR_PREALLOC_H
+
+#if defined(AMBER_UTIL_VECTOR_H)
+# error "AB_vector_prealloc.h must be included before AB_vector.h"
+#endif
+#if defined(AB_VEC_REALLOC) || defined(AB_VEC_FREE)
+# error "AB_vector_prealloc.h installs AB_VEC_REALLOC; use AB_VEC_PREALLOC_FALLBACK instead"
+#endif
+#if !defined(__GNUC__) && !defined(__DOXYGEN__)
+# error "AB_vector_prealloc.h requires GCC-style __atomic builtins"
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/** @cond false */
+static void *AB_vec_prealloc_realloc(void *ptr, size_t old_size, size_t new_size, void *pa);
+/** @endcond */
+
+#ifndef AB_VEC_INCLUDE_USERDATA
+# define AB_VEC_INCLUDE_USERDATA
+#endif
+#define AB_VEC_REALLOC(ptr, old_size, new_size, userdata)                                          \
+    AB_vec_prealloc_realloc((ptr), (old_size), (new_size), (userdata))
+#define AB_VEC_FREE(ptr, size, userdata) free(ptr)
+#ifndef AB_VEC_CALLOC
+# define AB_VEC_CALLOC(size, userdata) calloc(1, size)
+#endif
+
+#include "AB_vector.h"
+
+/** @brief Reallocation used when no buffer is ready
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_PREALLOC_FALLBACK
+# define AB_VEC_PREALLOC_FALLBACK(ptr, old_size, new_size) realloc(ptr, new_size)
+#endif
+
+/** @brief Smallest growth in bytes that is prepared in the background
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_PREALLOC_MIN
+# define AB_VEC_PREALLOC_MIN (1024 * 1024)
+#endif
+
+/** @brief Stride of the writes that fault in a prepared buffer
+ * @note This macro can be overidden
+ */
+#ifndef AB_VEC_PREALLOC_PAGE
+# define AB_VEC_PREALLOC_PAGE 4096
+#endif
+
+/** @cond false */
+enum {
+    AB_VEC_PREALLOC_IDLE,
+    AB_VEC_PREALLOC_QUEUED,  /* Waiting for or being served by the helper */
+    AB_VEC_PREALLOC_READY
+};
+/** @endcond */
+
+/** @brief A helper thread serving any number of attached vectors */
+typedef struct AB_vec_prealloc_thread {
+    /** @cond false */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake, done;
+    struct AB_vec_prealloc *queue;
+    int shutdown;
+    /** @endcond */
+} AB_vec_prealloc_thread;
+
+/** @brief Background allocation state of one vector */
+typedef struct AB_vec_prealloc {
+    /** @cond false */
+    AB_vec_prealloc_thread *helper;
+    struct AB_vec_prealloc *next;
+    size_t elem_size;
+    double fraction;
+    /* Only touched by the vector's own thread */
+    AB_VEC_SIZE_T trigger;
+    size_t want;
+    /* Guarded by the helper's lock */
+    size_t request;
+    void *ready;
+    size_t ready_size;
+    int state, cancel;
+    /** @endcond */
+    unsigned long hits;   /**< Growths served by a prepared buffer */
+    unsigned long misses; /**< Prepared growths that fell back to reallocation */
+} AB_vec_prealloc;
+
+static void *
+AB_vec_prealloc_main(void *arg)
+{
+    AB_vec_prealloc_thread *t = arg;
+    pthread_mutex_lock(&t->lock);
+    for (;;) {
+        AB_vec_prealloc *pa;
+        size_t size, i;
+        char *p;
+
+        while (t->queue == NULL && !t->shutdown)
+            pthread_cond_wait(&t->wake, &t->lock);
+        if (t->queue == NULL)
+            break;
+        pa = t->queue;
+        t->queue = pa->next;
+        size = pa->request;
+        pthread_mutex_unlock(&t->lock);
+
+        p = malloc(size);
+        if (p != NULL)
+            for (i = 0; i < size; i += AB_VEC_PREALLOC_PAGE)
+                __atomic_store_n(&p[i], 0, __ATOMIC_RELAXED);
+
+        pthread_mutex_lock(&t->lock);
+        if (pa->cancel || p == NULL) {
+            free(p);
+            pa->state = AB_VEC_PREALLOC_IDLE;
+        } else if (size != pa->request) {
+            /* The vector grew and asked for a larger buffer meanwhile */
+            free(p);
+            pa->next = t->queue;
+            t->queue = pa;
+        } else {
+            pa->ready = p;
+            pa->ready_size = size;
+            pa->state = AB_VEC_PREALLOC_READY;
+        }
+        pa->cancel = 0;
+        pthread_cond_broadcast(&t->done);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+/** @brief Start a helper thread
+ * @param t Pointer to an uninitialized AB_vec_prealloc_thread
+ * @return 0 on success, nonzero on error
+ */
+static AB_VEC_INLINE int
+AB_vec_prealloc_start(AB_vec_prealloc_thread *t)
+{
+    AB_VEC_CHECK(t != NULL);
+    t->queue = NULL;
+    t->shutdown = 0;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->wake, NULL);
+    pthread_cond_init(&t->done, NULL);
+    if (pthread_create(&t->thread, NULL, AB_vec_prealloc_main, t) != 0) {
+        pthread_cond_destroy(&t->done);
+        pthread_cond_destroy(&t->wake);
+        pthread_mutex_destroy(&t->lock);
+        return 1;
+    }
+    return 0;
+}
+
+/** @brief Stop a helper thread
+ * @param t Pointer to a started AB_vec_prealloc_thread
+ * @note Every vector has to be detached first
+ */
+static AB_VEC_INLINE void
+AB_vec_prealloc_stop(AB_vec_prealloc_thread *t)
+{
+    AB_VEC_CHECK(t != NULL);
+    pthread_mutex_lock(&t->lock);
+    AB_VEC_CHECK(t->queue == NULL);
+    t->shutdown = 1;
+    pthread_cond_signal(&t->wake);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+    pthread_cond_destroy(&t->done);
+    pthread_cond_destroy(&t->wake);
+    pthread_mutex_destroy(&t->lock);
+}
+
+/* Choose the size at which the growth after capacity is requested */
+static AB_VEC_INLINE void
+AB_vec_prealloc_arm(AB_vec_prealloc *pa, AB_VEC_SIZE_T capacity)
+{
+    pa->want = (size_t)(capacity ? capacity << 1 : 2) * pa->elem_size;
+    pa->trigger = pa->want < AB_VEC_PREALLOC_MIN ? (AB_VEC_SIZE_T)-1
+        : (AB_VEC_SIZE_T)((double)capacity * pa->fraction);
+}
+
+/* Free an unused buffer, or make sure the helper will */
+static AB_VEC_INLINE void
+AB_vec_prealloc_drop(AB_vec_prealloc *pa)
+{
+    if (pa->state == AB_VEC_PREALLOC_READY) {
+        free(pa->ready);
+        pa->ready = NULL;
+        pa->state = AB_VEC_PREALLOC_IDLE;
+    } else if (pa->state == AB_VEC_PREALLOC_QUEUED) {
+        pa->cancel = 1;
+    }
+}
+
+static void *
+AB_vec_prealloc_realloc(void *ptr, size_t old_size, size_t new_size, void *userdata)
+{
+    AB_vec_prealloc *pa = userdata;
+    void *p = NULL;
+
+    if (pa == NULL || new_size <= old_size)
+        return AB_VEC_PREALLOC_FALLBACK(ptr, old_size, new_size);
+    pthread_mutex_lock(&pa->helper->lock);
+    if (pa->state == AB_VEC_PREALLOC_READY && pa->ready_size >= new_size) {
+        p = pa->ready;
+        pa->ready = NULL;
+        pa->state = AB_VEC_PREALLOC_IDLE;
+    } else {
+        if (pa->state != AB_VEC_PREALLOC_IDLE && !pa->cancel)
+            pa->misses++;
+        AB_vec_prealloc_drop(pa);
+    }
+    pthread_mutex_unlock(&pa->helper->lock);
+
+    if (p != NULL) {
+        pa->hits++;
+        if (old_size > 0)
+            memcpy(p, ptr, old_size);
+        free(ptr);
+    } else {
+        p = AB_VEC_PREALLOC_FALLBACK(ptr, old_size, new_size);
+    }
+    if (p != NULL)
+        AB_vec_prealloc_arm(pa, (AB_VEC_SIZE_T)(new_size / pa->elem_size));
+    return p;
+}
+
+/* Slow path of AB_vec_prealloc_check: queue the next buffer */
+static AB_VEC_COLD void
+AB_vec_prealloc_request(AB_vec_prealloc *pa)
+{
+    AB_vec_prealloc_thread *t = pa->helper;
+    pa->trigger = (AB_VEC_SIZE_T)-1;
+    pthread_mutex_lock(&t->lock);
+    pa->request = pa->want;
+    if (pa->state == AB_VEC_PREALLOC_IDLE) {
+        pa->state = AB_VEC_PREALLOC_QUEUED;
+        pa->next = t->queue;
+        t->queue = pa;
+        pthread_cond_signal(&t->wake);
+    } else if (pa->state == AB_VEC_PREALLOC_QUEUED) {
+        /* A growth cancelled the request before it was served: revive it
+         * with the new size, which the helper picks up or re-queues for */
+        pa->cancel = 0;
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+static AB_VEC_INLINE void
+AB_vec_prealloc_check(struct AB_vector_generic *vec)
+{
+    AB_vec_prealloc *pa = vec->userdata;
+    if (pa != NULL && AB_VEC_UNLIKELY(vec->num >= pa->trigger))
+        AB_vec_prealloc_request(pa);
+}
+
+static AB_VEC_INLINE void
+AB_vec_prealloc_attach_generic(AB_vec_prealloc *pa, AB_vec_prealloc_thread *t,
+        struct AB_vector_generic *vec, size_t elem_size, double fraction)
+{
+    AB_VEC_CHECK(pa != NULL && t != NULL && vec != NULL && vec->userdata == NULL);
+    AB_VEC_CHECK(fraction >= 0 && fraction < 1);
+    pa->helper = t;
+    pa->next = NULL;
+    pa->elem_size = elem_size;
+    pa->fraction = fraction;
+    pa->request = 0;
+    pa->ready = NULL;
+    pa->ready_size = 0;
+    pa->state = AB_VEC_PREALLOC_IDLE;
+    pa->cancel = 0;
+    pa->hits = pa->misses = 0;
+    AB_vec_prealloc_arm(pa, vec->capacity);
+    vec->userdata = pa;
+}
+/** @brief Let a vector's growth be prepared by a helper thread
+ * @param pa Pointer to an AB_vec_prealloc, which must outlive the
+ *  attachment
+ * @param t Pointer to a started AB_vec_prealloc_thread
+ * @param vec Pointer to an AB_vec with a NULL userdata
+ * @param fraction The next buffer is requested once the size reaches
+ *  this fraction of the capacity, in [0, 1). Right after a growth the
+ *  vector is half full, so 0.5 and below request it immediately.
+ * @hideinitializer
+ */
+#define AB_vec_prealloc_attach(pa, t, vec, fraction)                                               \
+    AB_vec_prealloc_attach_generic((pa), (t), (struct AB_vector_generic *)(vec),                   \
+        sizeof(*(vec)->elems), (fraction))
+
+static AB_VEC_INLINE void
+AB_vec_prealloc_detach_generic(struct AB_vector_generic *vec)
+{
+    AB_vec_prealloc *pa;
+    AB_VEC_CHECK(vec != NULL && vec->userdata != NULL);
+    pa = vec->userdata;
+    pthread_mutex_lock(&pa->helper->lock);
+    if (pa->state == AB_VEC_PREALLOC_QUEUED) {
+        AB_vec_prealloc **q = &pa->helper->queue;
+        while (*q != NULL && *q != pa)
+            q = &(*q)->next;
+        if (*q != NULL) {
+            *q = pa->next;
+            pa->state = AB_VEC_PREALLOC_IDLE;
+        }
+        /* Otherwise the helper is allocating it right now */
+        pa->cancel = 1;
+        while (pa->state == AB_VEC_PREALLOC_QUEUED)
+            pthread_cond_wait(&pa->helper->done, &pa->helper->lock);
+    }
+    AB_vec_prealloc_drop(pa);
+    pthread_mutex_unlock(&pa->helper->lock);
+    vec->userdata = NULL;
+}
+/** @brief Stop preparing a vector's growth, freeing any unused buffer
+ * @param vec Pointer to an attached AB_vec
+ * @note The vector itself stays valid, and may also have been destroyed
+ * @hideinitializer
+ */
+#define AB_vec_prealloc_detach(vec)                                                                \
+    AB_vec_prealloc_detach_generic((struct AB_vector_generic *)(vec))
+
+/** @brief Add an element to the end of the vector, preparing its next growth
+ * @param vec Pointer to the AB_vec, attached or not
+ * @param elem The element to insert
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#define AB_vec_prealloc_push(vec, elem)                                                            \
+    (AB_vec_prealloc_check((struct AB_vector_generic *)(vec)), AB_vec_push((vec), (elem)))
+
+/** @brief Add an element to the end of the vector, preparing its next growth
+ * @param vec Pointer to the AB_vec, attached or not
+ * @return Pointer to the pushed element, or NULL on error
+ * @hideinitializer
+ */
+#define AB_vec_prealloc_pushp(vec)                                                                 \
+    (AB_vec_prealloc_check((struct AB_vector_generic *)(vec)), AB_vec_pushp(vec))
+
+#endif /* AMBER_UTIL_VECTOR_PREALLOC_H */
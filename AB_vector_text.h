@@ -0,0 +1,524 @@
+/** @file AB_vector_text.h
+ * @brief Text processing over AB_vec(char) buffers
+ *
+ * @c AB_vec_split() breaks a character buffer into fields without copying:
+ * each field is an @c AB_vec_slice, an offset and length into the source,
+ * so a whole buffer is tokenized with one growing vector of slices instead
+ * of one allocation per field. Delimiters are found 16 bytes at a time. On
+ * SSSE3 targets any set of delimiters is classified with two @c pshufb
+ * table lookups per block; plain SSE2 compares against each delimiter, and
+ * other targets use a byte table.
+ *
+ * @c AB_vec_interner maps strings to small integer IDs. Every distinct
+ * string is stored once, NUL-terminated, in a single AB_vec(char) arena,
+ * and found again through a flat open-addressing index of hashes and IDs,
+ * so interning costs no allocation per string.
+ *
+ * This header requires C99 (for stdint.h) and AB_vector_hash.h.
+ */
+#ifndef AMBER_UTIL_VECTOR_TEXT_H
+#define AMBER_UTIL_VECTOR_TEXT_H
+
+#include "AB_vector.h"
+#include "AB_vector_hash.h"
+#include <stdint.h>
+#if defined(__SSSE3__)
+# include <tmmintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+/**************************************************************************
+ *
+ * Tokenizer
+ *
+ *************************************************************************/
+
+/** @brief A field of a buffer, as a range of bytes of the source */
+struct AB_vec_slice {
+    size_t offset; /**< Index of the first byte of the field */
+    size_t len;    /**< Number of bytes in the field */
+};
+
+/** @brief Flags for @c AB_vec_split() */
+enum {
+    /** Drop fields of length zero, so runs of delimiters act as one */
+    AB_VEC_SPLIT_SKIP_EMPTY = 1,
+    /** Fields starting with a double quote extend to the closing quote,
+     * CSV-style, and may contain delimiters. The slice covers the text
+     * between the quotes; doubled quotes inside it are left as they are. */
+    AB_VEC_SPLIT_QUOTED = 2
+};
+
+/** @cond false */
+struct AB_vec_delims {
+    unsigned char table[256];
+#if defined(__SSE2__)
+    /* 2: nibble lookup, 1: compare against each of eq, 0: table only */
+    int simd, neq;
+    __m128i eq[8];
+    __m128i lo, hi;
+#endif
+};
+
+struct AB_vec_split_state {
+    const char *p;
+    size_t n;
+    size_t blk, blk_end;
+    unsigned mask;
+};
+/** @endcond */
+
+static AB_VEC_INLINE unsigned
+AB_vec_ctz(unsigned x)
+{
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctz(x);
+#else
+    unsigned n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static AB_VEC_INLINE void
+AB_vec_delims_init(struct AB_vec_delims *d, const char *delims)
+{
+    const unsigned char *c;
+#if defined(__SSE2__)
+    unsigned char lo[16] = { 0 }, hi[16] = { 0 };
+    int nbits = 0;
+    d->neq = 0;
+#endif
+    memset(d->table, 0, sizeof(d->table));
+    for (c = (const unsigned char *)delims; *c != '\0'; c++) {
+        if (d->table[*c])
+            continue;
+        d->table[*c] = 1;
+#if defined(__SSE2__)
+        if (d->neq < 8)
+            d->eq[d->neq] = _mm_set1_epi8((char)*c);
+        d->neq++;
+        /* One bit per distinct high nibble: a byte matches when the entry
+         * for its low nibble has the bit of its high nibble */
+        if (hi[*c >> 4] == 0) {
+            if (nbits < 8)
+                hi[*c >> 4] = (unsigned char)(1u << nbits);
+            nbits++;
+        }
+        lo[*c & 15] |= hi[*c >> 4];
+#endif
+    }
+#if defined(__SSE2__)
+    /* With no delimiters eq[0] is unset; the table finds nothing */
+    d->simd = d->neq >= 1 && d->neq <= 8 ? 1 : 0;
+# if defined(__SSSE3__)
+    if (d->neq > 2 && nbits <= 8) {
+        d->lo = _mm_loadu_si128((const __m128i *)lo);
+        d->hi = _mm_loadu_si128((const __m128i *)hi);
+        d->simd = 2;
+    }
+# endif
+#endif
+}
+
+#if defined(__SSE2__)
+/* Bit i set if byte i of the 16 at p is a delimiter */
+static AB_VEC_INLINE unsigned
+AB_vec_delims_mask(const struct AB_vec_delims *d, const char *p)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)p), m;
+    int i;
+# if defined(__SSSE3__)
+    if (d->simd == 2) {
+        const __m128i nib = _mm_set1_epi8(15);
+        __m128i l = _mm_shuffle_epi8(d->lo, _mm_and_si128(x, nib));
+        __m128i h = _mm_shuffle_epi8(d->hi, _mm_and_si128(_mm_srli_epi16(x, 4), nib));
+        m = _mm_cmpeq_epi8(_mm_and_si128(l, h), _mm_setzero_si128());
+        return ~(unsigned)_mm_movemask_epi8(m) & 0xffffu;
+    }
+# endif
+    m = _mm_cmpeq_epi8(x, d->eq[0]);
+    for (i = 1; i < d->neq; i++)
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, d->eq[i]));
+    return (unsigned)_mm_movemask_epi8(m);
+}
+#endif
+
+/* Index of the first delimiter at or after i, or n. The mask of the last
+ * block scanned is kept, so short fields cost no extra loads. */
+static AB_VEC_INLINE size_t
+AB_vec_split_next(struct AB_vec_split_state *s, const struct AB_vec_delims *d, size_t i)
+{
+#if defined(__SSE2__)
+    if (d->simd != 0) {
+        if (i >= s->blk && i < s->blk_end) {
+            unsigned m = s->mask & (~0u << (i - s->blk));
+            if (m != 0)
+                return s->blk + AB_vec_ctz(m);
+            i = s->blk_end;
+        }
+        for (; i + 16 <= s->n; i += 16) {
+            unsigned m = AB_vec_delims_mask(d, s->p + i);
+            if (m != 0) {
+                s->blk = i;
+                s->blk_end = i + 16;
+                s->mask = m;
+                return i + AB_vec_ctz(m);
+            }
+        }
+    }
+#endif
+    for (; i < s->n; i++)
+        if (d->table[(unsigned char)s->p[i]])
+            return i;
+    return s->n;
+}
+
+static AB_VEC_INLINE int
+AB_vec_split_generic(struct AB_vector_generic *slices, const struct AB_vector_generic *src,
+        const char *delims, int flags)
+{
+    AB_vec(struct AB_vec_slice) *out = (void *)slices;
+    AB_vec_writer(struct AB_vec_slice) w;
+    struct AB_vec_delims d;
+    struct AB_vec_split_state s;
+    size_t start = 0;
+
+    AB_VEC_CHECK(slices != NULL && src != NULL && delims != NULL);
+    out->num = 0;
+    if (src->num == 0)
+        return 0;
+    AB_vec_delims_init(&d, delims);
+    s.p = src->elems;
+    s.n = src->num;
+    s.blk = s.blk_end = 0;
+    s.mask = 0;
+    if (AB_vec_writer_open(&w, out, 0))
+        return 1;
+
+    for (;;) {
+        size_t end, close = 0;
+        struct AB_vec_slice *f;
+
+        if ((flags & AB_VEC_SPLIT_QUOTED) && start < s.n && s.p[start] == '"') {
+            /* Find the closing quote, stepping over doubled ones. Anything
+             * between it and the next delimiter is dropped. */
+            size_t q = start + 1;
+            for (;;) {
+                const char *c = memchr(s.p + q, '"', s.n - q);
+                if (c == NULL) {
+                    close = q = s.n;
+                    break;
+                }
+                q = (size_t)(c - s.p);
+                if (q + 1 < s.n && s.p[q + 1] == '"') {
+                    q += 2;
+                    continue;
+                }
+                close = q++;
+                break;
+            }
+            end = AB_vec_split_next(&s, &d, q);
+            f = AB_vec_writer_pushp(&w);
+            if (f == NULL)
+                break;
+            f->offset = start + 1;
+            f->len = close - start - 1;
+        } else {
+            end = AB_vec_split_next(&s, &d, start);
+            if (end > start || !(flags & AB_VEC_SPLIT_SKIP_EMPTY)) {
+                f = AB_vec_writer_pushp(&w);
+                if (f == NULL)
+                    break;
+                f->offset = start;
+                f->len = end - start;
+            }
+        }
+        if (end == s.n) {
+            AB_vec_writer_close(&w);
+            return 0;
+        }
+        start = end + 1;
+    }
+    AB_vec_writer_close(&w);
+    return 1;
+}
+/** @brief Split a buffer into fields separated by delimiter bytes
+ * @param [out] slices Pointer to an AB_vec of @c struct AB_vec_slice. Its
+ *  contents are replaced by one slice per field, in order.
+ * @param [in] src Const pointer to an AB_vec of @c char
+ * @param delims NUL-terminated string of delimiter bytes
+ * @param flags Zero or more of @c AB_VEC_SPLIT_SKIP_EMPTY and
+ *  @c AB_VEC_SPLIT_QUOTED or-ed together
+ * @return 0 on success, nonzero on error
+ * @note A non-empty buffer with k delimiters has k + 1 fields, some of
+ *  which may be empty; an empty buffer has none. The slices point into
+ *  @c src, so they are invalidated by anything that moves its elements.
+ * @hideinitializer
+ */
+#define AB_vec_split(slices, src, delims, flags)                                                   \
+    ((void)sizeof(char[sizeof(*(slices)->elems) == sizeof(struct AB_vec_slice) ? 1 : -1]),         \
+     (void)sizeof(char[sizeof(*(src)->elems) == 1 ? 1 : -1]),                                      \
+     AB_vec_split_generic((struct AB_vector_generic *)(slices),                                    \
+         (const struct AB_vector_generic *)(src), (delims), (flags)))
+
+/**************************************************************************
+ *
+ * String interning
+ *
+ *************************************************************************/
+
+/** @brief A set of distinct strings, each identified by a stable ID
+ * @note IDs are assigned in order of first insertion, starting from 0
+ */
+typedef struct AB_vec_interner {
+    /** @cond false */
+    AB_vec(char) arena;      /* The strings, each followed by a NUL */
+    AB_vec(size_t) offsets;  /* Start of each string in the arena, by ID */
+    AB_vec(uint64_t) slots;  /* Low 32 hash bits << 32 | ID + 1, or 0 */
+    /** @endcond */
+} AB_vec_interner;
+
+/** @brief Initialize an empty interner
+ * @param in Pointer to an uninitialized AB_vec_interner
+ */
+static AB_VEC_INLINE void
+AB_vec_interner_init(AB_vec_interner *in)
+{
+    AB_VEC_CHECK(in != NULL);
+    AB_vec_init(&in->arena);
+    AB_vec_init(&in->offsets);
+    AB_vec_init(&in->slots);
+}
+
+/** @brief Free memory associated with an interner
+ * @param in Pointer to an initialized AB_vec_interner
+ */
+static AB_VEC_INLINE void
+AB_vec_interner_destroy(AB_vec_interner *in)
+{
+    AB_VEC_CHECK(in != NULL);
+    AB_vec_destroy(&in->arena);
+    AB_vec_destroy(&in->offsets);
+    AB_vec_destroy(&in->slots);
+}
+
+/** @brief Query the number of distinct strings in an interner
+ * @param in Const pointer to an AB_vec_interner
+ * @return The number of strings, which is also the next ID to be assigned
+ */
+static AB_VEC_INLINE uint32_t
+AB_vec_interner_size(const AB_vec_interner *in)
+{
+    AB_VEC_CHECK(in != NULL);
+    return (uint32_t)in->offsets.num;
+}
+
+/** @brief Look up the string of an ID
+ * @param in Const pointer to an AB_vec_interner
+ * @param id An ID returned by the interner
+ * @return Pointer to the NUL-terminated string. It is invalidated when
+ *  another string is interned, but the ID stays valid.
+ */
+static AB_VEC_INLINE const char *
+AB_vec_interner_str(const AB_vec_interner *in, uint32_t id)
+{
+    AB_VEC_CHECK(in != NULL);
+    AB_VEC_CHECK_BOUNDS(id < in->offsets.num);
+    return in->arena.elems + in->offsets.elems[id];
+}
+
+/** @brief Look up the length of the string of an ID
+ * @param in Const pointer to an AB_vec_interner
+ * @param id An ID returned by the interner
+ * @return Length of the string in bytes, not counting the terminating NUL
+ */
+static AB_VEC_INLINE size_t
+AB_vec_interner_len(const AB_vec_interner *in, uint32_t id)
+{
+    size_t end;
+    AB_VEC_CHECK(in != NULL);
+    AB_VEC_CHECK_BOUNDS(id < in->offsets.num);
+    end = id + 1 < in->offsets.num ? in->offsets.elems[id + 1] : in->arena.num;
+    return end - in->offsets.elems[id] - 1;
+}
+
+static AB_VEC_INLINE uint32_t
+AB_vec_interner_hash(const char *s, size_t len)
+{
+    return (uint32_t)AB_vec_hash_bytes(s, len, 0);
+}
+
+/* Slot holding s, or the empty slot where it would go */
+static AB_VEC_INLINE size_t
+AB_vec_interner_probe(const AB_vec_interner *in, const char *s, size_t len, uint32_t h)
+{
+    size_t mask = in->slots.num - 1, i;
+    for (i = h & mask;; i = (i + 1) & mask) {
+        uint64_t e = in->slots.elems[i];
+        if (e == 0)
+            return i;
+        if ((uint32_t)(e >> 32) == h) {
+            uint32_t id = (uint32_t)e - 1;
+            if (AB_vec_interner_len(in, id) == len
+                    && memcmp(in->arena.elems + in->offsets.elems[id], s, len) == 0)
+                return i;
+        }
+    }
+}
+
+/* Rebuild the index with nslots slots from the stored hashes alone */
+static AB_VEC_INLINE int
+AB_vec_interner_rehash(AB_vec_interner *in, size_t nslots)
+{
+    AB_vec(uint64_t) slots = AB_VEC_INIT;
+    size_t i, j, mask = nslots - 1;
+    if (AB_vec_resize_zero(&slots, nslots))
+        return 1;
+    for (i = 0; i < in->slots.num; i++) {
+        uint64_t e = in->slots.elems[i];
+        if (e == 0)
+            continue;
+        for (j = (e >> 32) & mask; slots.elems[j] != 0; j = (j + 1) & mask)
+            ;
+        slots.elems[j] = e;
+    }
+    AB_vec_destroy(&in->slots);
+    in->slots.elems = slots.elems;
+    in->slots.num = slots.num;
+    in->slots.capacity = slots.capacity;
+    return 0;
+}
+
+static AB_VEC_INLINE int
+AB_vec_intern_hashed(AB_vec_interner *in, const char *s, size_t len, uint32_t h, uint32_t *id)
+{
+    size_t i, need, pos = (size_t)-1;
+    uint32_t next = (uint32_t)in->offsets.num;
+
+    /* Keep the index at most half full */
+    if ((size_t)(next + 1) * 2 > in->slots.num
+            && AB_vec_interner_rehash(in, in->slots.num ? in->slots.num * 2 : 16))
+        return 1;
+    i = AB_vec_interner_probe(in, s, len, h);
+    if (in->slots.elems[i] != 0) {
+        *id = (uint32_t)in->slots.elems[i] - 1;
+        return 0;
+    }
+
+    /* IDs are stored plus one in 32 bits, so the last one is reserved */
+    if (next == UINT32_MAX)
+        return 1;
+    /* s may point into the arena, which can move when it grows */
+    if ((uintptr_t)s >= (uintptr_t)in->arena.elems
+            && (uintptr_t)s < (uintptr_t)(in->arena.elems + in->arena.num))
+        pos = (size_t)(s - in->arena.elems);
+    need = in->arena.num + len + 1;
+    if (need > in->arena.capacity
+            && AB_vec_reserve(&in->arena, need > 2 * in->arena.capacity ? need
+                : 2 * in->arena.capacity))
+        return 1;
+    if (AB_vec_push(&in->offsets, in->arena.num))
+        return 1;
+    if (pos != (size_t)-1)
+        s = in->arena.elems + pos;
+    if (len > 0)
+        memcpy(in->arena.elems + in->arena.num, s, len);
+    in->arena.elems[in->arena.num + len] = '\0';
+    in->arena.num += len + 1;
+    in->slots.elems[i] = (uint64_t)h << 32 | (next + 1);
+    *id = next;
+    return 0;
+}
+/** @brief Add a string to an interner, or find it if already present
+ * @param in Pointer to an AB_vec_interner
+ * @param s Pointer to the bytes of the string, which may contain NULs
+ * @param len Length of the string in bytes
+ * @param [out] id Set to the ID of the string
+ * @return 0 on success, nonzero on error, including a new string when
+ *  @c UINT32_MAX strings are already interned
+ */
+static AB_VEC_INLINE int
+AB_vec_intern(AB_vec_interner *in, const char *s, size_t len, uint32_t *id)
+{
+    AB_VEC_CHECK(in != NULL && id != NULL && (s != NULL || len == 0));
+    return AB_vec_intern_hashed(in, s, len, AB_vec_interner_hash(s, len), id);
+}
+
+/** @brief Find the ID of a string without adding it
+ * @param in Const pointer to an AB_vec_interner
+ * @param s Pointer to the bytes of the string
+ * @param len Length of the string in bytes
+ * @param [out] id Set to the ID of the string if it is present
+ * @return 0 if the string is present, nonzero otherwise
+ */
+static AB_VEC_INLINE int
+AB_vec_interner_find(const AB_vec_interner *in, const char *s, size_t len, uint32_t *id)
+{
+    size_t i;
+    AB_VEC_CHECK(in != NULL && id != NULL && (s != NULL || len == 0));
+    if (in->slots.num == 0)
+        return 1;
+    i = AB_vec_interner_probe(in, s, len, AB_vec_interner_hash(s, len));
+    if (in->slots.elems[i] == 0)
+        return 1;
+    *id = (uint32_t)in->slots.elems[i] - 1;
+    return 0;
+}
+
+static AB_VEC_INLINE int
+AB_vec_intern_slices_generic(AB_vec_interner *in, struct AB_vector_generic *ids,
+        const struct AB_vector_generic *src, const struct AB_vector_generic *slices)
+{
+    const struct AB_vec_slice *sl = slices->elems;
+    const char *text = src->elems;
+    uint32_t *out, hashes[64];
+    size_t b, j, n = slices->num;
+
+    AB_VEC_CHECK(in != NULL && ids != NULL && src != NULL && slices != NULL);
+    if (AB_vec_reserve_generic(ids, (AB_VEC_SIZE_T)n, sizeof(uint32_t)))
+        return 1;
+    out = ids->elems;
+    ids->num = 0;
+    /* Hash a batch first and prefetch each home slot, so the probes of the
+     * batch overlap their cache misses */
+    for (b = 0; b < n; b += 64) {
+        size_t m = n - b < 64 ? n - b : 64;
+        for (j = 0; j < m; j++) {
+            hashes[j] = AB_vec_interner_hash(text + sl[b + j].offset, sl[b + j].len);
+#if defined(__GNUC__)
+            if (in->slots.num > 0)
+                __builtin_prefetch(in->slots.elems + (hashes[j] & (in->slots.num - 1)));
+#endif
+        }
+        for (j = 0; j < m; j++) {
+            if (AB_vec_intern_hashed(in, text + sl[b + j].offset, sl[b + j].len, hashes[j],
+                        &out[b + j]))
+                return 1;
+            ids->num++;
+        }
+    }
+    return 0;
+}
+/** @brief Intern every field of a tokenized buffer
+ * @param in Pointer to an AB_vec_interner
+ * @param [out] ids Pointer to an AB_vec of @c uint32_t. Its contents are
+ *  replaced by the ID of each slice, in order.
+ * @param [in] src Const pointer to the AB_vec of @c char the slices index
+ * @param [in] slices Const pointer to an AB_vec of @c struct AB_vec_slice,
+ *  such as one filled by @c AB_vec_split()
+ * @return 0 on success, nonzero on error
+ * @hideinitializer
+ */
+#define AB_vec_intern_slices(in, ids, src, slices)                                                 \
+    ((void)sizeof(char[sizeof(*(ids)->elems) == sizeof(uint32_t) ? 1 : -1]),                       \
+     (void)sizeof(char[sizeof(*(src)->elems) == 1 ? 1 : -1]),                                      \
+     (void)sizeof(char[sizeof(*(slices)->elems) == sizeof(struct AB_vec_slice) ? 1 : -1]),         \
+     AB_vec_intern_slices_generic((in), (struct AB_vector_generic *)(ids),                         \
+         (const struct AB_vector_generic *)(src), (const struct AB_vector_generic *)(slices)))
+
+#endif /* AMBER_UTIL_VECTOR_TEXT_H */
@@ -0,0 +1,339 @@
+/** @file AB_vector_trace.h
+ * @brief Binary traces of AB_vec operations, for replaying offline
+ *
+ * Whether another growth factor or allocator would help depends on how a
+ * program's vectors actually grow. When @c AB_VEC_TRACE is defined, this
+ * header redefines @c AB_vec_init(), @c AB_vec_push(), @c AB_vec_pushp(),
+ * @c AB_vec_resize(), @c AB_vec_reserve(), @c AB_vec_copy(),
+ * @c AB_vec_insert() and @c AB_vec_destroy() so that every call made after
+ * the include is logged while a trace is running. Without @c AB_VEC_TRACE
+ * the macros are left alone, so the header can be included unconditionally
+ * and the recorder switched on per build. The instrumented macros evaluate
+ * their arguments like the ANSI C ones do without @c AB_VEC_TYPEOF.
+ *
+ * A trace is an @c AB_vec_trace_header followed by fixed-size
+ * @c AB_vec_trace_event records in host byte order. The vector is named by
+ * its address, which a later @c AB_VEC_TRACE_INIT or first use after
+ * @c AB_VEC_TRACE_DESTROY may reuse. A run of pushes to one vector with no
+ * other event in between is stored as a single event, so a trace costs a
+ * few bytes per growth rather than per element. Each thread fills its own
+ * buffer and appends it to the file with one @c fwrite() when it is full,
+ * so the events of one thread stay in order, and those of different
+ * threads are interleaved a buffer at a time.
+ *
+ * bench/bench_replay.c re-runs a trace under other allocators and growth
+ * factors.
+ *
+ * Macro-options (besides those of AB_vector.h):
+ *  - AB_VEC_TRACE
+ *    Define this macro to log the operations.
+ *
+ * This header requires C99, POSIX @c clock_gettime(), the GCC-style
+ * @c __atomic builtins and @c __thread, and a target with weak symbols
+ * (ELF or Mach-O), which keep one trace for the whole program. Do not
+ * define @c AB_VEC_TRACE and @c AB_VEC_LATENCY in the same translation
+ * unit; both redefine @c AB_vec_push().
+ */
+#ifndef AMBER_UTIL_VECTOR_TRACE_H
+#define AMBER_UTIL_VECTOR_TRACE_H
+
+#include "AB_vector.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if !defined(__GNUC__) && !defined(__DOXYGEN__)
+# error "AB_vector_trace.h requires GCC-style __atomic builtins"
+#endif
+
+/** @brief Traced operations */
+enum {
+    AB_VEC_TRACE_INIT,    /**< @c AB_vec_init() */
+    AB_VEC_TRACE_PUSH,    /**< @c AB_vec_push() and @c AB_vec_pushp() */
+    AB_VEC_TRACE_RESIZE,  /**< @c AB_vec_resize() */
+    AB_VEC_TRACE_RESERVE, /**< @c AB_vec_reserve() */
+    AB_VEC_TRACE_COPY,    /**< @c AB_vec_copy(), logged on the destination */
+    AB_VEC_TRACE_INSERT,  /**< @c AB_vec_insert() */
+    AB_VEC_TRACE_DESTROY, /**< @c AB_vec_destroy() */
+    AB_VEC_TRACE_OPS      /**< Number of operations */
+};
+
+/** @brief First 8 bytes of a trace file */
+#define AB_VEC_TRACE_MAGIC "ABVTRACE"
+
+/** @brief Version of the trace format */
+#define AB_VEC_TRACE_VERSION 1
+
+/** @brief Start of a trace file */
+typedef struct AB_vec_trace_header {
+    char magic[8];       /**< @c AB_VEC_TRACE_MAGIC, without the terminator */
+    uint32_t version;    /**< @c AB_VEC_TRACE_VERSION */
+    uint32_t event_size; /**< @c sizeof(AB_vec_trace_event) */
+} AB_vec_trace_header;
+
+/** @brief One logged operation */
+typedef struct AB_vec_trace_event {
+    uint64_t vec; /**< Address of the vector */
+    uint64_t num; /**< Number of elements after the operation */
+    /** Capacity after @c RESIZE, @c RESERVE and @c DESTROY, capacity of
+     * the source of a @c COPY, index of an @c INSERT, and number of
+     * elements pushed by a @c PUSH */
+    uint64_t arg;
+    uint32_t dt;      /**< Nanoseconds since the thread's previous event, saturated */
+    uint32_t op_size; /**< Operation in the top 8 bits, element size in the low 24 */
+} AB_vec_trace_event;
+
+/** @brief Operation of an event
+ * @param e An AB_vec_trace_event
+ * @return One of the @c AB_VEC_TRACE_* operations
+ * @hideinitializer
+ */
+#define AB_vec_trace_op(e) ((int)((e).op_size >> 24))
+
+/** @brief Element size of an event
+ * @param e An AB_vec_trace_event
+ * @return Size of the vector's elements in bytes
+ * @hideinitializer
+ */
+#define AB_vec_trace_elem_size(e) ((size_t)((e).op_size & 0xffffffu))
+
+/** @cond false */
+#define AB_VEC_TRACE_BUFFER 4096
+
+typedef struct AB_vec_trace_buffer {
+    AB_vec_trace_event ev[AB_VEC_TRACE_BUFFER];
+    unsigned n;
+    uint64_t last;
+    struct AB_vec_trace_buffer *next;
+} AB_vec_trace_buffer;
+
+__attribute__((weak)) FILE *AB_vec_trace_file;
+__attribute__((weak)) AB_vec_trace_buffer *AB_vec_trace_head;
+__attribute__((weak)) __thread AB_vec_trace_buffer *AB_vec_trace_self;
+
+static AB_VEC_INLINE uint64_t
+AB_vec_trace_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* First event on a thread: allocate and publish its buffer */
+static AB_VEC_COLD AB_vec_trace_buffer *
+AB_vec_trace_register(void)
+{
+    AB_vec_trace_buffer *b = malloc(sizeof(*b));
+    if (b == NULL)
+        return NULL;
+    b->n = 0;
+    b->last = AB_vec_trace_ns();
+    b->next = __atomic_load_n(&AB_vec_trace_head, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&AB_vec_trace_head, &b->next, b, 1,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    AB_vec_trace_self = b;
+    return b;
+}
+
+static AB_VEC_COLD void
+AB_vec_trace_flush_buffer(AB_vec_trace_buffer *b, FILE *f)
+{
+    if (b->n > 0)
+        fwrite(b->ev, sizeof(b->ev[0]), b->n, f);
+    b->n = 0;
+}
+/** @endcond */
+
+/** @brief Log one operation in the running trace
+ * @param op One of the @c AB_VEC_TRACE_* operations
+ * @param vec Address of the vector
+ * @param num Number of elements after the operation
+ * @param arg See @c AB_vec_trace_event::arg
+ * @param elem_size Size of the vector's elements
+ * @note The instrumented macros call this; it is public so that callers
+ *  can log operations they make through other means. Nothing is logged
+ *  while no trace is running.
+ */
+static AB_VEC_INLINE void
+AB_vec_trace_record(int op, const void *vec, uint64_t num, uint64_t arg, size_t elem_size)
+{
+    AB_vec_trace_buffer *b;
+    AB_vec_trace_event *e;
+    FILE *f = __atomic_load_n(&AB_vec_trace_file, __ATOMIC_ACQUIRE);
+    uint64_t now;
+    if (f == NULL)
+        return;
+    b = AB_vec_trace_self;
+    if (AB_VEC_UNLIKELY(b == NULL) && (b = AB_vec_trace_register()) == NULL)
+        return;
+    if (op == AB_VEC_TRACE_PUSH && b->n > 0) {
+        e = &b->ev[b->n - 1];
+        if (e->vec == (uint64_t)(uintptr_t)vec && AB_vec_trace_op(*e) == AB_VEC_TRACE_PUSH) {
+            e->num = num;
+            e->arg += arg;
+            return;
+        }
+    }
+    if (AB_VEC_UNLIKELY(b->n == AB_VEC_TRACE_BUFFER))
+        AB_vec_trace_flush_buffer(b, f);
+    now = AB_vec_trace_ns();
+    e = &b->ev[b->n++];
+    e->vec = (uint64_t)(uintptr_t)vec;
+    e->num = num;
+    e->arg = arg;
+    e->dt = now - b->last > UINT32_MAX ? UINT32_MAX : (uint32_t)(now - b->last);
+    e->op_size = (uint32_t)op << 24 | (elem_size < 0xffffffu ? (uint32_t)elem_size : 0xffffffu);
+    b->last = now;
+}
+
+/** @brief Start logging operations to a stream
+ * @param f Stream opened for binary writing, which stays owned by the
+ *  caller
+ * @return 0 on success, nonzero if a trace is already running or the
+ *  header could not be written
+ */
+static AB_VEC_INLINE int
+AB_vec_trace_start(FILE *f)
+{
+    AB_vec_trace_header h = { AB_VEC_TRACE_MAGIC, AB_VEC_TRACE_VERSION,
+        sizeof(AB_vec_trace_event) };
+    AB_VEC_CHECK(f != NULL);
+    if (__atomic_load_n(&AB_vec_trace_file, __ATOMIC_RELAXED) != NULL)
+        return 1;
+    if (fwrite(&h, sizeof(h), 1, f) != 1)
+        return 1;
+    __atomic_store_n(&AB_vec_trace_file, f, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/** @brief Write out the buffered events of every thread and stop logging
+ * @return 0 on success, nonzero if no trace was running or a write failed
+ * @note Other threads must not be making traced calls meanwhile: their
+ *  buffers are flushed from the calling thread
+ */
+static AB_VEC_INLINE int
+AB_vec_trace_stop(void)
+{
+    AB_vec_trace_buffer *b;
+    FILE *f = __atomic_load_n(&AB_vec_trace_file, __ATOMIC_RELAXED);
+    if (f == NULL)
+        return 1;
+    for (b = __atomic_load_n(&AB_vec_trace_head, __ATOMIC_ACQUIRE); b != NULL; b = b->next)
+        AB_vec_trace_flush_buffer(b, f);
+    __atomic_store_n(&AB_vec_trace_file, NULL, __ATOMIC_RELEASE);
+    return fflush(f) != 0 || ferror(f);
+}
+
+#if defined(AB_VEC_TRACE)
+/** @cond false */
+static AB_VEC_INLINE void
+AB_vec_trace_init(struct AB_vector_generic *vec, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    vec->num = vec->capacity = 0;
+    vec->elems = NULL;
+#ifdef AB_VEC_INCLUDE_USERDATA
+    vec->userdata = NULL;
+#endif
+    AB_vec_trace_record(AB_VEC_TRACE_INIT, vec, 0, 0, elem_size);
+}
+
+static AB_VEC_INLINE void *
+AB_vec_trace_pushp(struct AB_vector_generic *vec, AB_VEC_SIZE_T elem_size)
+{
+    AB_VEC_CHECK(vec != NULL);
+    if (AB_VEC_UNLIKELY(vec->num == vec->capacity) && AB_vec_grow_generic(vec, elem_size))
+        return NULL;
+    AB_vec_trace_record(AB_VEC_TRACE_PUSH, vec, vec->num + 1, 1, elem_size);
+    return (char *)vec->elems + elem_size * vec->num++;
+}
+
+static AB_VEC_INLINE int
+AB_vec_trace_resize(struct AB_vector_generic *vec, AB_VEC_SIZE_T n, AB_VEC_SIZE_T elem_size,
+        int op)
+{
+    int err = op == AB_VEC_TRACE_RESERVE ? AB_vec_reserve_generic(vec, n, elem_size)
+        : AB_vec_resize_generic(vec, n, elem_size);
+    AB_vec_trace_record(op, vec, vec->num, vec->capacity, elem_size);
+    return err;
+}
+
+static AB_VEC_INLINE int
+AB_vec_trace_copy(struct AB_vector_generic *dest, const struct AB_vector_generic *src,
+        AB_VEC_SIZE_T elem_size)
+{
+    int err = AB_vec_copy_generic(dest, src, elem_size);
+    AB_vec_trace_record(AB_VEC_TRACE_COPY, dest, dest->num, src->capacity, elem_size);
+    return err;
+}
+
+static AB_VEC_INLINE int
+AB_vec_trace_insert(struct AB_vector_generic *vec, AB_VEC_SIZE_T idx, AB_VEC_SIZE_T elem_size)
+{
+    int err;
+    AB_VEC_CHECK(vec != NULL);
+    err = AB_vec_insert_generic(vec, idx, elem_size);
+    if (err == 0)
+        AB_vec_trace_record(AB_VEC_TRACE_INSERT, vec, vec->num, idx, elem_size);
+    return err;
+}
+/** @endcond */
+
+# undef AB_vec_init
+# undef AB_vec_push
+# undef AB_vec_pushp
+# undef AB_vec_resize
+# undef AB_vec_reserve
+# undef AB_vec_copy
+# undef AB_vec_insert
+# undef AB_vec_destroy
+
+# define AB_vec_init(vec)                                                                          \
+    AB_vec_trace_init((struct AB_vector_generic *)(vec), sizeof(*(vec)->elems))
+
+# define AB_vec_push(vec, elem)                                                                    \
+    (AB_vec_trace_pushp((struct AB_vector_generic *)(vec), sizeof(*(vec)->elems)) == NULL ? 1     \
+        : ((vec)->elems[(vec)->num - 1] = (elem), 0))
+
+# ifdef AB_VEC_TYPEOF
+#  define AB_vec_pushp(vec)                                                                        \
+    ((AB_VEC_TYPEOF((vec)->elems))AB_vec_trace_pushp((struct AB_vector_generic *)(vec),            \
+        sizeof(*(vec)->elems)))
+# else
+#  define AB_vec_pushp(vec)                                                                        \
+    (AB_vec_trace_pushp((struct AB_vector_generic *)(vec), sizeof(*(vec)->elems)) == NULL ? NULL  \
+        : &(vec)->elems[(vec)->num - 1])
+# endif
+
+# define AB_vec_resize(vec, newsize)                                                               \
+    AB_vec_trace_resize((struct AB_vector_generic *)(vec), (newsize), sizeof(*(vec)->elems),       \
+        AB_VEC_TRACE_RESIZE)
+
+# define AB_vec_reserve(vec, minsize)                                                              \
+    AB_vec_trace_resize((struct AB_vector_generic *)(vec), (minsize), sizeof(*(vec)->elems),       \
+        AB_VEC_TRACE_RESERVE)
+
+# define AB_vec_copy(dest, src)                                                                    \
+    AB_vec_trace_copy((struct AB_vector_generic *)(dest),                                          \
+        (const struct AB_vector_generic *)(src), sizeof(*(dest)->elems))
+
+# define AB_vec_insert(vec, idx, elem)                                                             \
+    (AB_vec_trace_insert((struct AB_vector_generic *)(vec), (idx), sizeof(*(vec)->elems)) == 0   \
+        ? ((vec)->elems[(idx)] = (elem), 0) : 1)
+
+# ifdef AB_VEC_INCLUDE_USERDATA
+#  define AB_vec_destroy(vec)                                                                      \
+    (AB_vec_trace_record(AB_VEC_TRACE_DESTROY, (vec), (vec)->num, (vec)->capacity,                 \
+        sizeof(*(vec)->elems)),                                                                    \
+     AB_VEC_FREE((vec)->elems, (vec)->capacity * sizeof(*(vec)->elems), (vec)->userdata))
+# else
+#  define AB_vec_destroy(vec)                                                                      \
+    (AB_vec_trace_record(AB_VEC_TRACE_DESTROY, (vec), (vec)->num, (vec)->capacity,                 \
+        sizeof(*(vec)->elems)),                                                                    \
+     AB_VEC_FREE((vec)->elems, (vec)->capacity * sizeof(*(vec)->elems)))
+# endif
+#endif /* AB_VEC_TRACE */
+
+#endif /* AMBER_UTIL_VECTOR_TRACE_H */
@@ -0,0 +1,83 @@
+/* Shared helpers for the AB_vector benchmarks */
+#ifndef AB_VECTOR_BENCH_H
+#define AB_VECTOR_BENCH_H
+
+#ifndef _POSIX_C_SOURCE
+# define _POSIX_C_SOURCE 199309L
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Monotonic wall-clock time in seconds */
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Print one result line: name, best time, and throughput in GB/s */
+static void bench_report(const char *name, double seconds, double bytes)
+{
+    printf("%-32s %10.3f ms %8.2f GB/s\n", name, seconds * 1e3, bytes / seconds * 1e-9);
+}
+
+/* Run `stmt` `reps` times and store the fastest wall time in `best` */
+#define BENCH_BEST(best, reps, stmt) do {                                     \
+    int bench_rep_;                                                           \
+    (best) = 1e30;                                                            \
+    for (bench_rep_ = 0; bench_rep_ < (reps); bench_rep_++) {                 \
+        double bench_t0_ = bench_now(), bench_dt_;                            \
+        stmt;                                                                 \
+        bench_dt_ = bench_now() - bench_t0_;                                  \
+        if (bench_dt_ < (best))                                               \
+            (best) = bench_dt_;                                               \
+    }                                                                         \
+} while (0)
+
+/* Latencies in ns, bucketed by power of two with 8 linear steps each. The
+ * helpers are inline so that benchmarks which do not use them build quietly. */
+typedef struct {
+    uint64_t count[64 * 8], n;
+    double max, total;
+} bench_hist;
+
+static inline void bench_hist_add(bench_hist *h, double seconds)
+{
+    uint64_t ns = (uint64_t)(seconds * 1e9);
+    unsigned lg = 0;
+    while (lg < 63 && (ns >> (lg + 1)) != 0)
+        lg++;
+    h->count[lg * 8 + (lg >= 3 ? (unsigned)(ns >> (lg - 3)) & 7 : 0)]++;
+    h->n++;
+    h->total += seconds;
+    if (seconds > h->max)
+        h->max = seconds;
+}
+
+/* Upper bound in ns of the bucket holding quantile q */
+static inline double bench_hist_quantile(const bench_hist *h, double q)
+{
+    uint64_t seen = 0, want = (uint64_t)(q * (double)h->n);
+    unsigned b;
+    for (b = 0; b < 64 * 8; b++) {
+        seen += h->count[b];
+        if (seen > want) {
+            unsigned lg = b / 8, sub = b % 8;
+            return lg >= 3 ? (double)((8u + sub + 1) << (lg - 3)) : (double)(2u << lg);
+        }
+    }
+    return h->max * 1e9;
+}
+
+/* Total time and throughput, then the tail of the latency distribution */
+static inline void bench_hist_report(const char *name, const bench_hist *h, double bytes)
+{
+    bench_report(name, h->total, bytes);
+    printf("  p50 %5.0f ns  p99 %5.0f ns  p999 %6.0f ns  p9999 %7.0f ns  max %9.3f ms\n",
+            bench_hist_quantile(h, 0.5), bench_hist_quantile(h, 0.99),
+            bench_hist_quantile(h, 0.999), bench_hist_quantile(h, 0.9999), h->max * 1e3);
+}
+
+#endif /* AB_VECTOR_BENCH_H */
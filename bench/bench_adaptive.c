@@ -0,0 +1,93 @@
+/* Built twice: bench_adaptive with AB_VEC_ADAPTIVE, which learns the
+ * initial capacity of each push site, and bench_adaptive_off without it.
+ * The workload tokenizes documents: each has a few hundred tokens and a
+ * few dozen lines of a few dozen fields, and produces a result list whose
+ * length is usually short and sometimes long. */
+#include "bench.h"
+#include <stdlib.h>
+
+static uint64_t reallocs;
+
+static void *counting_realloc(void *ptr, size_t new_size)
+{
+    reallocs++;
+    return realloc(ptr, new_size);
+}
+
+#define AB_VEC_REALLOC(ptr, old_size, new_size) counting_realloc(ptr, new_size)
+#define AB_VEC_FREE(ptr, size) free(ptr)
+#include <AB_vector_adaptive.h>
+
+#define DOCS 100000
+#define LINES 30
+#define REPS 3
+
+typedef AB_vec(uint32_t) u32_vec;
+typedef AB_vec(uint64_t) u64_vec;
+
+static uint64_t rng_state;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+static uint64_t elements, capacity;
+
+static uint64_t workload(void)
+{
+    uint64_t sum = 0;
+    uint32_t d, i, j, n;
+
+    rng_state = 88172645463325252ull;
+    elements = capacity = 0;
+    for (d = 0; d < DOCS; d++) {
+        u32_vec tokens = AB_VEC_INIT, fields;
+        u64_vec results = AB_VEC_INIT;
+        n = 400 + rng() % 200;
+        for (i = 0; i < n; i++)
+            AB_vec_push(&tokens, rng());
+        for (i = 0; i < LINES; i++) {
+            AB_vec_init(&fields);
+            n = 16 + rng() % 24;
+            for (j = 0; j < n; j++)
+                *AB_vec_pushp(&fields) = j * 8;
+            sum += AB_vec_at(&fields, n - 1);
+            elements += n;
+            capacity += AB_vec_max(&fields);
+            AB_vec_destroy(&fields);
+        }
+        n = rng() % 100 < 90 ? rng() % 8 : rng() % 2000;
+        for (i = 0; i < n; i++)
+            AB_vec_push(&results, (uint64_t)AB_vec_at(&tokens, i % AB_vec_size(&tokens)) << 1);
+        sum += AB_vec_size(&results) + AB_vec_at(&tokens, 0);
+        elements += AB_vec_size(&tokens) + AB_vec_size(&results);
+        capacity += AB_vec_max(&tokens) + AB_vec_max(&results);
+        AB_vec_destroy(&tokens);
+        AB_vec_destroy(&results);
+    }
+    return sum;
+}
+
+int main(void)
+{
+    uint64_t sum = 0, before;
+    double best;
+
+    before = reallocs;
+    workload();
+    printf("first run: %llu reallocs\n", (unsigned long long)(reallocs - before));
+    BENCH_BEST(best, REPS, { before = reallocs; sum += workload(); });
+#if defined(AB_VEC_ADAPTIVE)
+    bench_report("workload (adaptive)", best, (double)elements * sizeof(uint32_t));
+#else
+    bench_report("workload", best, (double)elements * sizeof(uint32_t));
+#endif
+    printf("%llu reallocs per run, %.2f allocated elements per element, checksum %llu\n",
+            (unsigned long long)(reallocs - before), (double)capacity / (double)elements,
+            (unsigned long long)sum);
+    return 0;
+}
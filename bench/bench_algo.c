@@ -0,0 +1,190 @@
+#include "bench.h"
+#include <AB_vector_algo.h>
+#include <stdlib.h>
+
+#define N (16u * 1024u * 1024u)
+#define REPS 3
+
+static int u32_cmp(const void *x, const void *y)
+{
+    uint32_t a = *(const uint32_t *)x, b = *(const uint32_t *)y;
+    return (a > b) - (a < b);
+}
+
+int main(void)
+{
+    AB_vec(uint32_t) src = AB_VEC_INIT;
+    AB_vec(uint32_t) dest = AB_VEC_INIT;
+    AB_vec(uint32_t) idx = AB_VEC_INIT;
+    double best;
+    uint32_t i, seed = 1;
+
+    for (i = 0; i < N; i++) {
+        seed = seed * 1103515245u + 12345u;
+        AB_vec_push(&src, i);
+        AB_vec_push(&idx, (seed >> 4) % N);
+    }
+    AB_vec_resize_zero(&dest, N);
+    printf("elements: %u, random indices\n", N);
+
+    BENCH_BEST(best, REPS, for (i = 0; i < N; i++)
+            AB_vec_at(&dest, i) = AB_vec_at(&src, AB_vec_at(&idx, i)));
+    bench_report("gather loop", best, 3.0 * N * sizeof(uint32_t));
+    BENCH_BEST(best, REPS, AB_vec_gather(&dest, &src, &idx));
+    bench_report("AB_vec_gather", best, 3.0 * N * sizeof(uint32_t));
+
+    BENCH_BEST(best, REPS, for (i = 0; i < N; i++)
+            AB_vec_at(&dest, AB_vec_at(&idx, i)) = AB_vec_at(&src, i));
+    bench_report("scatter loop", best, 3.0 * N * sizeof(uint32_t));
+    BENCH_BEST(best, REPS, AB_vec_scatter(&dest, &src, &idx));
+    bench_report("AB_vec_scatter", best, 3.0 * N * sizeof(uint32_t));
+
+    /* Reordering, against the hand-rolled AB_vec_at loops they replace */
+    BENCH_BEST(best, REPS, for (i = 0; i < N / 2; i++) {
+        uint32_t t = AB_vec_at(&src, i);
+        AB_vec_at(&src, i) = AB_vec_at(&src, N - 1 - i);
+        AB_vec_at(&src, N - 1 - i) = t;
+    });
+    bench_report("reverse loop", best, 2.0 * N * sizeof(uint32_t));
+    BENCH_BEST(best, REPS, AB_vec_reverse(&src));
+    bench_report("AB_vec_reverse", best, 2.0 * N * sizeof(uint32_t));
+
+    BENCH_BEST(best, REPS, {
+        for (i = 0; i < N; i++)
+            AB_vec_at(&dest, i) = AB_vec_at(&src, (i + N / 3) % N);
+        AB_vec_copy(&src, &dest);
+    });
+    bench_report("rotate via copy", best, 4.0 * N * sizeof(uint32_t));
+    BENCH_BEST(best, REPS, AB_vec_rotate(&src, N / 3));
+    bench_report("AB_vec_rotate (N / 3)", best, 2.0 * N * sizeof(uint32_t));
+    BENCH_BEST(best, REPS, AB_vec_rotate(&src, 64));
+    bench_report("AB_vec_rotate (64)", best, 2.0 * N * sizeof(uint32_t));
+
+    {
+        AB_vec(uint32_t) parts[16], all = AB_VEC_INIT;
+        for (i = 0; i < 16; i++) {
+            AB_vec_init(&parts[i]);
+            AB_vec_resize_fill(&parts[i], N / 16, i);
+        }
+        BENCH_BEST(best, REPS, {
+            all.num = 0;
+            for (i = 0; i < 16; i++) {
+                uint32_t j;
+                for (j = 0; j < N / 16; j++)
+                    AB_vec_push(&all, AB_vec_at(&parts[i], j));
+            }
+        });
+        bench_report("concat via push", best, 2.0 * N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, { all.num = 0; AB_vec_concat(&all, parts, 16); });
+        bench_report("AB_vec_concat (16 parts)", best, 2.0 * N * sizeof(uint32_t));
+        for (i = 0; i < 16; i++)
+            AB_vec_destroy(&parts[i]);
+        AB_vec_destroy(&all);
+    }
+
+    /* Merges of random sorted runs, where a branchy merge mispredicts */
+    {
+        AB_vec(uint32_t) runs[16], a = AB_VEC_INIT, b = AB_VEC_INIT, all = AB_VEC_INIT;
+        uint32_t ia, ib, o;
+        for (i = 0; i < N; i++) {
+            seed = seed * 1103515245u + 12345u;
+            AB_vec_push(i & 1 ? &b : &a, seed);
+        }
+        qsort(a.elems, a.num, sizeof(uint32_t), u32_cmp);
+        qsort(b.elems, b.num, sizeof(uint32_t), u32_cmp);
+        AB_vec_resize(&all, N);
+        BENCH_BEST(best, REPS, {
+            ia = ib = o = 0;
+            while (ia < a.num && ib < b.num) {
+                if (b.elems[ib] < a.elems[ia])
+                    all.elems[o++] = b.elems[ib++];
+                else
+                    all.elems[o++] = a.elems[ia++];
+            }
+            while (ia < a.num)
+                all.elems[o++] = a.elems[ia++];
+            while (ib < b.num)
+                all.elems[o++] = b.elems[ib++];
+        });
+        bench_report("merge loop", best, 2.0 * N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, AB_vec_merge(&all, &a, &b, NULL));
+        bench_report("AB_vec_merge", best, 2.0 * N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, AB_vec_merge(&all, &a, &b, u32_cmp));
+        bench_report("AB_vec_merge (cmp)", best, 2.0 * N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, {
+            all.num = 0;
+            AB_vec_concat(&all, &a, 1);
+            AB_vec_concat(&all, &b, 1);
+            AB_vec_merge_inplace(&all, a.num, NULL);
+        });
+        bench_report("copy + AB_vec_merge_inplace", best, 2.0 * N * sizeof(uint32_t));
+
+        for (i = 0; i < 16; i++) {
+            AB_vec_init(&runs[i]);
+            AB_vec_resize(&runs[i], N / 16);
+            memcpy(runs[i].elems, src.elems + i * (N / 16), N / 16 * sizeof(uint32_t));
+            runs[i].num = N / 16;
+            qsort(runs[i].elems, N / 16, sizeof(uint32_t), u32_cmp);
+        }
+        BENCH_BEST(best, REPS, {
+            all.num = 0;
+            AB_vec_concat(&all, runs, 16);
+            qsort(all.elems, all.num, sizeof(uint32_t), u32_cmp);
+        });
+        bench_report("concat + qsort (16 runs)", best, 2.0 * N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, AB_vec_merge_runs(&all, runs, 16, NULL));
+        bench_report("AB_vec_merge_runs (16 runs)", best, 2.0 * N * sizeof(uint32_t));
+        for (i = 0; i < 16; i++)
+            AB_vec_destroy(&runs[i]);
+        AB_vec_destroy(&a);
+        AB_vec_destroy(&b);
+        AB_vec_destroy(&all);
+    }
+
+    /* Top 100 of random scores */
+    {
+        AB_vec(uint32_t) scores = AB_VEC_INIT, work = AB_VEC_INIT, top = AB_VEC_INIT;
+        for (i = 0; i < N; i++) {
+            seed = seed * 1103515245u + 12345u;
+            AB_vec_push(&scores, seed);
+        }
+        AB_vec_resize(&work, N);
+        BENCH_BEST(best, REPS, {
+            AB_vec_copy(&work, &scores);
+            qsort(work.elems, N, sizeof(uint32_t), u32_cmp);
+        });
+        bench_report("copy + qsort", best, (double)N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, {
+            AB_vec_copy(&work, &scores);
+            AB_vec_nth_element(&work, N / 2, NULL);
+        });
+        bench_report("copy + AB_vec_nth_element", best, (double)N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, {
+            AB_vec_copy(&work, &scores);
+            AB_vec_partial_sort(&work, 100, NULL);
+        });
+        bench_report("copy + AB_vec_partial_sort (100)", best, (double)N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, AB_vec_copy(&work, &scores));
+        bench_report("copy", best, (double)N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, {
+            top.num = 0;
+            AB_vec_topk(&top, &scores, 100, NULL);
+            AB_vec_topk_sort(&top, NULL);
+        });
+        bench_report("AB_vec_topk (100)", best, (double)N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, {
+            top.num = 0;
+            AB_vec_topk(&top, &scores, 100, u32_cmp);
+            AB_vec_topk_sort(&top, u32_cmp);
+        });
+        bench_report("AB_vec_topk (100, cmp)", best, (double)N * sizeof(uint32_t));
+        AB_vec_destroy(&scores);
+        AB_vec_destroy(&work);
+        AB_vec_destroy(&top);
+    }
+
+    AB_vec_destroy(&src);
+    AB_vec_destroy(&dest);
+    AB_vec_destroy(&idx);
+    return 0;
+}
@@ -0,0 +1,59 @@
+/* Pushes into a vector picked by an expression, as in a hash table of
+ * buckets. Built twice: bench_eval with AB_VEC_TYPEOF, where each macro
+ * argument is evaluated once, and bench_eval_notypeof with
+ * AB_VEC_NO_TYPEOF, which selects the C90 macros while still compiling as
+ * C99 for the benchmark helpers. */
+#include "bench.h"
+#include <AB_vector.h>
+#include <stdint.h>
+
+#define N (16u * 1024u * 1024u)
+#define BUCKETS 4096u
+#define REPS 5
+
+typedef AB_vec(uint32_t) bucket;
+
+static bucket table[BUCKETS];
+static unsigned long hash_calls;
+
+/* Stands in for a real key hash; kept out of line so it cannot be merged */
+static __attribute__((noinline)) uint32_t hash(uint32_t k)
+{
+    hash_calls++;
+    k ^= k >> 16;
+    k *= 0x85ebca6bu;
+    k ^= k >> 13;
+    k *= 0xc2b2ae35u;
+    return (k ^ (k >> 16)) & (BUCKETS - 1);
+}
+
+static void run(void)
+{
+    uint32_t k;
+    unsigned b;
+    for (b = 0; b < BUCKETS; b++)
+        table[b].num = 0;
+    for (k = 0; k < N; k++)
+        AB_vec_push(&table[hash(k)], k);
+}
+
+int main(void)
+{
+    double best;
+    unsigned b;
+
+#ifdef AB_VEC_TYPEOF
+    puts("mode: AB_VEC_TYPEOF (single evaluation)");
+#else
+    puts("mode: C90 macros");
+#endif
+    run();
+    hash_calls = 0;
+    BENCH_BEST(best, REPS, run());
+    printf("hash calls per push: %.2f\n", (double)hash_calls / REPS / N);
+    bench_report("push into &table[hash(k)]", best, (double)N * sizeof(uint32_t));
+
+    for (b = 0; b < BUCKETS; b++)
+        AB_vec_destroy(&table[b]);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "bench.h"
+#include <AB_vector_filter.h>
+
+#ifndef KEYS
+# define KEYS (4u * 1024u * 1024u)
+#endif
+#define QUERIES (16u * 1024u * 1024u)
+#define REPS 3
+
+typedef AB_vec(uint64_t) u64_vec;
+
+static uint64_t next_key(uint64_t *seed)
+{
+    *seed = *seed * 6364136223846793005u + 1442695040888963407u;
+    return *seed ^ (*seed >> 29);
+}
+
+/* A classic Bloom filter: 7 probes anywhere in the bit array */
+static size_t run_classic(const u64_vec *bits, const u64_vec *q)
+{
+    size_t i, hits = 0, nbits = bits->num * 64;
+    for (i = 0; i < q->num; i++) {
+        uint64_t h = AB_bloom_hash(q->elems[i]), h2 = (h >> 32) | 1;
+        int hit = 1, j;
+        for (j = 0; j < 7 && hit; j++) {
+            size_t b = (size_t)(((uint64_t)(uint32_t)h * nbits) >> 32);
+            hit = (int)(bits->elems[b / 64] >> (b % 64) & 1);
+            h += h2;
+        }
+        hits += (size_t)hit;
+    }
+    return hits;
+}
+
+static void build_classic(u64_vec *bits, const u64_vec *keys, unsigned bits_per_key)
+{
+    size_t i, nbits;
+    AB_vec_resize_zero(bits, (keys->num * bits_per_key + 63) / 64);
+    nbits = bits->num * 64;
+    for (i = 0; i < keys->num; i++) {
+        uint64_t h = AB_bloom_hash(keys->elems[i]), h2 = (h >> 32) | 1;
+        int j;
+        for (j = 0; j < 7; j++) {
+            size_t b = (size_t)(((uint64_t)(uint32_t)h * nbits) >> 32);
+            bits->elems[b / 64] |= (uint64_t)1 << (b % 64);
+            h += h2;
+        }
+    }
+}
+
+static size_t run_contains(const AB_bloom *f, const u64_vec *q)
+{
+    size_t i, hits = 0;
+    for (i = 0; i < q->num; i++)
+        hits += (size_t)AB_bloom_contains(f, q->elems[i]);
+    return hits;
+}
+
+static size_t run_query(const AB_bloom *f, u64_vec *out, const u64_vec *q)
+{
+    size_t i, hits = 0;
+    AB_bloom_query(f, out, q);
+    for (i = 0; i < out->num; i++)
+        hits += (size_t)__builtin_popcountll(out->elems[i]);
+    return hits;
+}
+
+int main(void)
+{
+    u64_vec keys = AB_VEC_INIT, q = AB_VEC_INIT;
+    u64_vec classic = AB_VEC_INIT, out = AB_VEC_INIT;
+    AB_bloom f;
+    uint64_t seed = 1;
+    size_t i, hits[3];
+    double best;
+
+    for (i = 0; i < KEYS; i++)
+        AB_vec_push(&keys, next_key(&seed));
+    /* One query in eight is a stored key */
+    for (i = 0; i < QUERIES; i++)
+        AB_vec_push(&q, i % 8 == 0 ? keys.elems[(i / 8) % KEYS] : next_key(&seed));
+
+    AB_bloom_init(&f);
+    BENCH_BEST(best, REPS, AB_bloom_build(&f, &keys, 10));
+    bench_report("AB_bloom_build", best, (double)keys.num * 8);
+    BENCH_BEST(best, REPS, build_classic(&classic, &keys, 10));
+    bench_report("classic Bloom build", best, (double)keys.num * 8);
+    printf("filter: %u KiB\n", (unsigned)(AB_bloom_bytes(&f) / 1024));
+
+    BENCH_BEST(best, REPS, hits[0] = run_classic(&classic, &q));
+    bench_report("classic Bloom, 7 probes", best, (double)q.num * 8);
+    BENCH_BEST(best, REPS, hits[1] = run_contains(&f, &q));
+    bench_report("AB_bloom_contains", best, (double)q.num * 8);
+    BENCH_BEST(best, REPS, hits[2] = run_query(&f, &out, &q));
+    bench_report("AB_bloom_query", best, (double)q.num * 8);
+    printf("hits: %u %u %u\n", (unsigned)hits[0], (unsigned)hits[1], (unsigned)hits[2]);
+
+    AB_bloom_destroy(&f);
+    AB_vec_destroy(&keys);
+    AB_vec_destroy(&q);
+    AB_vec_destroy(&classic);
+    AB_vec_destroy(&out);
+    return 0;
+}
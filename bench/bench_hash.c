@@ -0,0 +1,42 @@
+#include "bench.h"
+#include <AB_vector_hash.h>
+
+#define BYTES (64u * 1024u * 1024u)
+#define REPS 5
+
+int main(void)
+{
+    static const size_t sizes[] = { 8, 16, 32, 64, 256, 4096 };
+    AB_vec(unsigned char) buf = AB_VEC_INIT;
+    AB_vec(uint64_t) big = AB_VEC_INIT;
+    volatile uint64_t sink = 0;
+    uint64_t seed = 42;
+    char name[64];
+    double best;
+    size_t i, j;
+
+    for (i = 0; i < BYTES / 8; i++) {
+        seed = seed * 6364136223846793005u + 1442695040888963407u;
+        AB_vec_push(&big, seed);
+    }
+    BENCH_BEST(best, REPS, sink ^= AB_vec_hash(&big, 0));
+    bench_report("hash 64 MiB", best, (double)BYTES);
+
+    /* Small keys, as when vectors are hash-map keys */
+    for (j = 0; j < sizeof sizes / sizeof *sizes; j++) {
+        size_t n = sizes[j], iters = BYTES / 16 / n;
+        AB_vec_resize(&buf, n);
+        memcpy(buf.elems, big.elems, n);
+        buf.num = n;
+        BENCH_BEST(best, REPS, for (i = 0; i < iters; i++) {
+            buf.elems[0] = (unsigned char)i;
+            sink ^= AB_vec_hash(&buf, i);
+        });
+        sprintf(name, "hash %lu B (%.2f ns/op)", (unsigned long)n, best * 1e9 / (double)iters);
+        bench_report(name, best, (double)n * (double)iters);
+    }
+
+    AB_vec_destroy(&buf);
+    AB_vec_destroy(&big);
+    return (int)(sink & 0);
+}
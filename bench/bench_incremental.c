@@ -0,0 +1,53 @@
+/* Built twice: bench_incremental with the C library realloc, which can
+ * move large blocks by remapping pages, and bench_incremental_copy with an
+ * allocator that always copies, as most pooling allocators do. */
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(BENCH_COPY_REALLOC)
+static void *copy_realloc(void *ptr, size_t old_size, size_t new_size)
+{
+    void *p = malloc(new_size);
+    if (p != NULL && ptr != NULL) {
+        memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+        free(ptr);
+    }
+    return p;
+}
+# define AB_VEC_REALLOC(ptr, old_size, new_size) copy_realloc(ptr, old_size, new_size)
+# define AB_VEC_FREE(ptr, size) free(ptr)
+#endif
+#include <AB_vector_incremental.h>
+#include <stdint.h>
+
+#define N (64u * 1024u * 1024u)
+
+typedef AB_vec(uint64_t) u64_vec;
+typedef AB_ivec(uint64_t) u64_ivec;
+
+int main(void)
+{
+    static bench_hist plain, incr;
+    u64_vec v = AB_VEC_INIT;
+    u64_ivec iv = AB_IVEC_INIT;
+    uint64_t i;
+
+    /* Every push is timed on its own, so the totals include two clock
+     * reads per push */
+    for (i = 0; i < N; i++) {
+        double t0 = bench_now();
+        AB_vec_push(&v, i);
+        bench_hist_add(&plain, bench_now() - t0);
+    }
+    AB_vec_destroy(&v);
+    bench_hist_report("AB_vec_push", &plain, (double)N * sizeof(uint64_t));
+
+    for (i = 0; i < N; i++) {
+        double t0 = bench_now();
+        AB_ivec_push(&iv, i);
+        bench_hist_add(&incr, bench_now() - t0);
+    }
+    AB_ivec_destroy(&iv);
+    bench_hist_report("AB_ivec_push", &incr, (double)N * sizeof(uint64_t));
+    return 0;
+}
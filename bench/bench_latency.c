@@ -0,0 +1,36 @@
+/* Built twice: bench_latency with AB_VEC_LATENCY, which times every push
+ * and dumps the histograms, and bench_latency_off without it, to show the
+ * cost of the instrumentation. */
+#include "bench.h"
+#include <AB_vector_latency.h>
+
+#define N (64u * 1024u * 1024u)
+#define REPS 3
+
+typedef AB_vec(uint32_t) u32_vec;
+
+static void fill(u32_vec *vec)
+{
+    uint32_t i;
+    for (i = 0; i < N; i++)
+        AB_vec_push(vec, i);
+}
+
+int main(void)
+{
+    u32_vec vec = AB_VEC_INIT;
+    AB_vec_latency all;
+    double best;
+
+    BENCH_BEST(best, REPS, { AB_vec_destroy(&vec); AB_vec_init(&vec); fill(&vec); });
+#if defined(AB_VEC_LATENCY)
+    bench_report("AB_vec_push (instrumented)", best, (double)N * sizeof(uint32_t));
+#else
+    bench_report("AB_vec_push", best, (double)N * sizeof(uint32_t));
+#endif
+    AB_vec_destroy(&vec);
+
+    AB_vec_latency_merge(&all);
+    AB_vec_latency_dump(&all, stdout);
+    return 0;
+}
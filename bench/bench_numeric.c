@@ -0,0 +1,136 @@
+#include "bench.h"
+#include <AB_vector_numeric.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N (32u * 1024u * 1024u)
+#define REPS 5
+
+static void naive_histogram(uint64_t *hist, const uint8_t *in, size_t n)
+{
+    size_t i;
+    memset(hist, 0, 256 * sizeof(uint64_t));
+    for (i = 0; i < n; i++)
+        hist[in[i]]++;
+}
+
+static void naive_scan(uint32_t *out, const uint32_t *in, size_t n)
+{
+    uint32_t sum = 0;
+    size_t i;
+    for (i = 0; i < n; i++)
+        out[i] = sum += in[i];
+}
+
+int main(int argc, char **argv)
+{
+    AB_vec(uint32_t) src = AB_VEC_INIT;
+    AB_vec(uint32_t) dest = AB_VEC_INIT;
+    AB_vec_pool pool;
+    double best, bytes = 2.0 * N * sizeof(uint32_t);
+    unsigned i;
+
+    if (AB_vec_pool_init(&pool, argc > 1 ? (unsigned)atoi(argv[1]) : 0))
+        return 1;
+    printf("threads: %u, elements: %u\n", AB_vec_pool_size(&pool), N);
+
+    for (i = 0; i < N; i++)
+        AB_vec_push(&src, i & 0xff);
+    AB_vec_resize_zero(&dest, N);
+
+    BENCH_BEST(best, REPS, naive_scan(dest.elems, src.elems, N));
+    bench_report("scalar loop", best, bytes);
+    BENCH_BEST(best, REPS, AB_vec_inclusive_scan(NULL, &dest, &src));
+    bench_report("inclusive_scan serial", best, bytes);
+    BENCH_BEST(best, REPS, AB_vec_inclusive_scan(&pool, &dest, &src));
+    bench_report("inclusive_scan parallel", best, bytes);
+    BENCH_BEST(best, REPS, AB_vec_exclusive_scan(&pool, &dest, &src));
+    bench_report("exclusive_scan parallel", best, bytes);
+    printf("checksum: %u\n", (unsigned)dest.elems[N - 1]);
+
+    {
+        AB_vec(float) f32 = AB_VEC_INIT;
+        AB_vec(double) f64 = AB_VEC_INIT;
+        AB_vec(uint8_t) u8 = AB_VEC_INIT;
+        for (i = 0; i < N; i++) {
+            AB_vec_push(&f64, i * 0.25);
+            AB_vec_push(&u8, (uint8_t)i);
+        }
+        AB_vec_resize(&f32, N);
+
+        BENCH_BEST(best, REPS, for (i = 0; i < N; i++)
+                f32.elems[i] = (float)(int32_t)src.elems[i]);
+        bench_report("i32 -> f32 loop", best, 2.0 * N * 4);
+        BENCH_BEST(best, REPS, AB_vec_convert(NULL, &f32, &src, AB_VEC_CONV_I32_F32));
+        bench_report("i32 -> f32 serial", best, 2.0 * N * 4);
+        BENCH_BEST(best, REPS, AB_vec_convert(&pool, &f32, &src, AB_VEC_CONV_I32_F32));
+        bench_report("i32 -> f32 parallel", best, 2.0 * N * 4);
+
+        BENCH_BEST(best, REPS, for (i = 0; i < N; i++)
+                f32.elems[i] = (float)f64.elems[i]);
+        bench_report("f64 -> f32 loop", best, 12.0 * N);
+        BENCH_BEST(best, REPS, AB_vec_convert(NULL, &f32, &f64,
+                    AB_VEC_CONV_F64_F32 | AB_VEC_CONV_SATURATE));
+        bench_report("f64 -> f32 serial (saturate)", best, 12.0 * N);
+        BENCH_BEST(best, REPS, AB_vec_convert(&pool, &f32, &f64, AB_VEC_CONV_F64_F32));
+        bench_report("f64 -> f32 parallel", best, 12.0 * N);
+
+        BENCH_BEST(best, REPS, for (i = 0; i < N; i++)
+                dest.elems[i] = u8.elems[i]);
+        bench_report("u8 -> u32 loop", best, 5.0 * N);
+        BENCH_BEST(best, REPS, AB_vec_convert(NULL, &dest, &u8, AB_VEC_CONV_U8_U32));
+        bench_report("u8 -> u32 serial", best, 5.0 * N);
+        BENCH_BEST(best, REPS, AB_vec_convert(&pool, &dest, &u8, AB_VEC_CONV_U8_U32));
+        bench_report("u8 -> u32 parallel", best, 5.0 * N);
+
+        AB_vec_destroy(&f32);
+        AB_vec_destroy(&f64);
+        AB_vec_destroy(&u8);
+    }
+
+    /* Uniform keys, skewed keys that hammer one bucket, and a single key */
+    {
+        static const char *const kinds[3] = { "uniform", "skewed", "constant" };
+        char name[64];
+        AB_vec(uint8_t) keys = AB_VEC_INIT;
+        AB_vec(uint16_t) wide = AB_VEC_INIT;
+        AB_vec(uint64_t) hist = AB_VEC_INIT;
+        uint32_t seed = 1;
+        int kind;
+
+        AB_vec_resize_zero(&keys, N);
+        AB_vec_resize_zero(&hist, 256);
+        for (kind = 0; kind < 3; kind++) {
+            for (i = 0; i < N; i++) {
+                seed = seed * 1103515245u + 12345u;
+                keys.elems[i] = (uint8_t)(kind == 2 || (kind == 1 && seed >> 28 != 0)
+                        ? 42 : seed >> 24);
+            }
+            BENCH_BEST(best, REPS, naive_histogram(hist.elems, keys.elems, N));
+            sprintf(name, "histogram loop (%s)", kinds[kind]);
+            bench_report(name, best, (double)N);
+            BENCH_BEST(best, REPS, AB_vec_histogram(NULL, &hist, &keys));
+            sprintf(name, "histogram serial (%s)", kinds[kind]);
+            bench_report(name, best, (double)N);
+            BENCH_BEST(best, REPS, AB_vec_histogram(&pool, &hist, &keys));
+            sprintf(name, "histogram parallel (%s)", kinds[kind]);
+            bench_report(name, best, (double)N);
+        }
+        for (i = 0; i < N; i++) {
+            seed = seed * 1103515245u + 12345u;
+            AB_vec_push(&wide, (uint16_t)(seed >> 16));
+        }
+        BENCH_BEST(best, REPS, AB_vec_histogram(NULL, &hist, &wide));
+        bench_report("histogram serial (16-bit)", best, 2.0 * N);
+        BENCH_BEST(best, REPS, AB_vec_histogram(&pool, &hist, &wide));
+        bench_report("histogram parallel (16-bit)", best, 2.0 * N);
+        AB_vec_destroy(&keys);
+        AB_vec_destroy(&wide);
+        AB_vec_destroy(&hist);
+    }
+
+    AB_vec_destroy(&src);
+    AB_vec_destroy(&dest);
+    AB_vec_pool_destroy(&pool);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "bench.h"
+#include <AB_vector_packed.h>
+
+#define N (16u * 1024u * 1024u)
+#define REPS 5
+
+typedef AB_vec(uint64_t) u64_vec;
+
+static void run(const char *name, const u64_vec *ids)
+{
+    AB_vec(uint64_t) out = AB_VEC_INIT;
+    AB_packed p;
+    double best, bytes = (double)N * sizeof(uint64_t);
+    uint64_t sum = 0;
+    size_t i;
+
+    AB_packed_init(&p);
+    BENCH_BEST(best, REPS, AB_packed_encode(&p, ids));
+    printf("%s: compression ratio %.2fx (%.2f bits/value)\n", name,
+            bytes / (double)AB_packed_bytes(&p), 8.0 * (double)AB_packed_bytes(&p) / N);
+    bench_report("  encode", best, bytes);
+    BENCH_BEST(best, REPS, AB_packed_decode(&p, &out));
+    bench_report("  decode", best, bytes);
+    BENCH_BEST(best, 1, for (i = 0; i < N; i += 97) sum += AB_packed_get(&p, i));
+    printf("  random get: %.1f ns/op (checksum %lu)\n",
+            best * 1e9 / (N / 97), (unsigned long)sum);
+
+    AB_packed_destroy(&p);
+    AB_vec_destroy(&out);
+}
+
+int main(void)
+{
+    u64_vec ids = AB_VEC_INIT;
+    uint64_t x = 1, seed = 42;
+    unsigned i;
+
+    for (i = 0; i < N; i++) {
+        seed = seed * 6364136223846793005u + 1442695040888963407u;
+        x += (seed >> 56) + 1;
+        AB_vec_push(&ids, x);
+    }
+    run("sorted ids (gaps < 256)", &ids);
+
+    for (i = 0; i < N; i++) {
+        seed = seed * 6364136223846793005u + 1442695040888963407u;
+        AB_vec_at(&ids, i) = (1ull << 40) + (seed >> 44);
+    }
+    run("unsorted 20-bit range", &ids);
+
+    AB_vec_destroy(&ids);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "bench.h"
+#include <AB_vector_parallel.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N (16u * 1024u * 1024u)
+#define REPS 5
+
+static void transform(void *dest, const void *src, size_t n, void *ctx)
+{
+    float *d = dest;
+    const float *s = src;
+    size_t i;
+    (void)ctx;
+    for (i = 0; i < n; i++)
+        d[i] = sqrtf(s[i]) * 0.5f + 1.0f;
+}
+
+static void sum(void *acc, const void *elems, size_t n, void *ctx)
+{
+    const float *v = elems;
+    double total = 0;
+    size_t i;
+    (void)ctx;
+    for (i = 0; i < n; i++)
+        total += v[i];
+    *(double *)acc += total;
+}
+
+static void combine(void *acc, const void *other, void *ctx)
+{
+    (void)ctx;
+    *(double *)acc += *(const double *)other;
+}
+
+int main(int argc, char **argv)
+{
+    AB_vec(float) src = AB_VEC_INIT;
+    AB_vec(float) dest = AB_VEC_INIT;
+    AB_vec_pool pool;
+    double best, total = 0;
+    unsigned i;
+
+    if (AB_vec_pool_init(&pool, argc > 1 ? (unsigned)atoi(argv[1]) : 0))
+        return 1;
+    printf("threads: %u, elements: %u\n", AB_vec_pool_size(&pool), N);
+
+    for (i = 0; i < N; i++)
+        AB_vec_push(&src, (float)i);
+    AB_vec_resize(&dest, N);
+
+    BENCH_BEST(best, REPS, AB_vec_parallel_transform(NULL, &dest, &src, transform, NULL));
+    bench_report("transform serial", best, 2.0 * N * sizeof(float));
+    BENCH_BEST(best, REPS, AB_vec_parallel_transform(&pool, &dest, &src, transform, NULL));
+    bench_report("transform parallel", best, 2.0 * N * sizeof(float));
+
+    BENCH_BEST(best, REPS, (total = 0, AB_vec_parallel_reduce(NULL, &dest, &total, sum, combine, NULL)));
+    bench_report("reduce serial", best, (double)N * sizeof(float));
+    BENCH_BEST(best, REPS, (total = 0, AB_vec_parallel_reduce(&pool, &dest, &total, sum, combine, NULL)));
+    bench_report("reduce parallel", best, (double)N * sizeof(float));
+    printf("checksum: %g\n", total);
+
+    BENCH_BEST(best, REPS, memcpy(dest.elems, src.elems, N * sizeof(float)));
+    bench_report("memcpy", best, 2.0 * N * sizeof(float));
+    BENCH_BEST(best, REPS, AB_vec_copy_parallel(NULL, &dest, &src));
+    bench_report("copy_parallel (1 thread)", best, 2.0 * N * sizeof(float));
+    BENCH_BEST(best, REPS, AB_vec_copy_parallel(&pool, &dest, &src));
+    bench_report("copy_parallel", best, 2.0 * N * sizeof(float));
+
+    BENCH_BEST(best, REPS, memset(dest.elems, 0, N * sizeof(float)));
+    bench_report("memset", best, (double)N * sizeof(float));
+    BENCH_BEST(best, REPS, AB_vec_fill(&dest, 0.0f));
+    bench_report("fill", best, (double)N * sizeof(float));
+    BENCH_BEST(best, REPS, AB_vec_fill_parallel(&pool, &dest, 0.0f));
+    bench_report("fill_parallel", best, (double)N * sizeof(float));
+
+    {
+        AB_vec(uint32_t) a = AB_VEC_INIT, b = AB_VEC_INIT, out = AB_VEC_INIT;
+        uint32_t seed = 1;
+        /* Interleaved sorted runs with random gaps */
+        for (i = 0; i < N / 2; i++) {
+            seed = seed * 1103515245u + 12345u;
+            AB_vec_push(&a, i * 16 + (seed >> 28));
+            AB_vec_push(&b, i * 16 + (seed >> 24 & 15));
+        }
+        BENCH_BEST(best, REPS, AB_vec_merge_parallel(NULL, &out, &a, &b, NULL));
+        bench_report("merge serial", best, 2.0 * N * sizeof(uint32_t));
+        BENCH_BEST(best, REPS, AB_vec_merge_parallel(&pool, &out, &a, &b, NULL));
+        bench_report("merge_parallel", best, 2.0 * N * sizeof(uint32_t));
+        AB_vec_destroy(&a);
+        AB_vec_destroy(&b);
+        AB_vec_destroy(&out);
+    }
+
+    AB_vec_destroy(&src);
+    AB_vec_destroy(&dest);
+    AB_vec_pool_destroy(&pool);
+    return 0;
+}
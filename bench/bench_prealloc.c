@@ -0,0 +1,61 @@
+/* Built twice: bench_prealloc falls back to the C library realloc, which
+ * can move large blocks by remapping pages, and bench_prealloc_copy to an
+ * allocator that always copies, as most pooling allocators do. */
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(BENCH_COPY_REALLOC)
+static void *copy_realloc(void *ptr, size_t old_size, size_t new_size)
+{
+    void *p = malloc(new_size);
+    if (p != NULL && ptr != NULL) {
+        memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+        free(ptr);
+    }
+    return p;
+}
+# define AB_VEC_PREALLOC_FALLBACK(ptr, old_size, new_size) copy_realloc(ptr, old_size, new_size)
+#endif
+#include <AB_vector_prealloc.h>
+
+#define N (64u * 1024u * 1024u)
+
+typedef AB_vec(uint64_t) u64_vec;
+
+static void fill(u64_vec *v, bench_hist *h)
+{
+    uint64_t i;
+    for (i = 0; i < N; i++) {
+        double t0 = bench_now();
+        AB_vec_prealloc_push(v, i);
+        bench_hist_add(h, bench_now() - t0);
+    }
+}
+
+int main(void)
+{
+    static bench_hist plain, pre;
+    AB_vec_prealloc_thread t;
+    AB_vec_prealloc pa;
+    u64_vec v = AB_VEC_INIT;
+
+    if (AB_vec_prealloc_start(&t))
+        return 1;
+
+    /* Every push is timed on its own, so the totals include two clock
+     * reads per push */
+    fill(&v, &plain);
+    AB_vec_destroy(&v);
+    bench_hist_report("AB_vec_push", &plain, (double)N * sizeof(uint64_t));
+
+    AB_vec_init(&v);
+    AB_vec_prealloc_attach(&pa, &t, &v, 0.75);
+    fill(&v, &pre);
+    AB_vec_destroy(&v);
+    AB_vec_prealloc_detach(&v);
+    bench_hist_report("AB_vec_prealloc_push", &pre, (double)N * sizeof(uint64_t));
+    printf("prepared growths: %lu hits, %lu misses\n", pa.hits, pa.misses);
+
+    AB_vec_prealloc_stop(&t);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/* Built twice: bench_push with the default branch hints and out-of-line
+ * growth, and bench_push_inline with both turned off. The
+ * bench_push_code_size target compares the size of push_sites(). */
+#if defined(BENCH_NO_HINTS)
+# define AB_VEC_LIKELY(c) (c)
+# define AB_VEC_UNLIKELY(c) (c)
+# define AB_VEC_COLD inline
+#endif
+#include "bench.h"
+#include <AB_vector.h>
+#include <stdint.h>
+
+#define N (64u * 1024u * 1024u)
+#define REPS 5
+
+typedef AB_vec(uint32_t) u32_vec;
+
+/* Producer loops as they appear in callers: one element per iteration */
+static void fill_push(u32_vec *vec, uint32_t seed)
+{
+    uint32_t i;
+    for (i = 0; i < N; i++)
+        AB_vec_push(vec, seed ^ i);
+}
+
+static void fill_writer(u32_vec *vec, uint32_t seed)
+{
+    AB_vec_writer(uint32_t) w;
+    uint32_t i;
+    AB_vec_writer_open(&w, vec, 0);
+    for (i = 0; i < N; i++)
+        AB_vec_writer_push(&w, seed ^ i);
+    AB_vec_writer_close(&w);
+}
+
+/* Many push sites in one function, like a record decoder filling several
+ * columns; its size shows what each call site costs in code */
+typedef struct { u32_vec cols[32]; } columns;
+
+void push_sites(columns *c, const uint32_t *row);
+void push_sites(columns *c, const uint32_t *row)
+{
+#define PUSH4(i) AB_vec_push(&c->cols[i], row[i]); AB_vec_push(&c->cols[i + 1], row[i + 1]); \
+    AB_vec_push(&c->cols[i + 2], row[i + 2]); AB_vec_push(&c->cols[i + 3], row[i + 3])
+    PUSH4(0); PUSH4(4); PUSH4(8); PUSH4(12); PUSH4(16); PUSH4(20); PUSH4(24); PUSH4(28);
+#undef PUSH4
+}
+
+int main(void)
+{
+    static columns cols;
+    uint32_t row[32] = { 0 };
+    u32_vec vec = AB_VEC_INIT;
+    double best, bytes = (double)N * sizeof(uint32_t);
+    uint32_t i;
+
+    /* Growing from empty: includes every reallocation */
+    BENCH_BEST(best, REPS, { AB_vec_destroy(&vec); AB_vec_init(&vec); fill_push(&vec, 1); });
+    bench_report("AB_vec_push (growing)", best, bytes);
+    BENCH_BEST(best, REPS, { AB_vec_destroy(&vec); AB_vec_init(&vec); fill_writer(&vec, 1); });
+    bench_report("AB_vec_writer_push (growing)", best, bytes);
+
+    /* Reused capacity: only the per-push checks remain */
+    BENCH_BEST(best, REPS, { vec.num = 0; fill_push(&vec, 2); });
+    bench_report("AB_vec_push (reserved)", best, bytes);
+    BENCH_BEST(best, REPS, { vec.num = 0; fill_writer(&vec, 2); });
+    bench_report("AB_vec_writer_push (reserved)", best, bytes);
+
+    BENCH_BEST(best, REPS, {
+        for (i = 0; i < 32; i++)
+            cols.cols[i].num = 0;
+        for (i = 0; i < N / 32; i++) {
+            row[i % 32] = i;
+            push_sites(&cols, row);
+        }
+    });
+    bench_report("32 push sites per row", best, bytes);
+
+    for (i = 0; i < 32; i++)
+        AB_vec_destroy(&cols.cols[i]);
+    AB_vec_destroy(&vec);
+    return 0;
+}
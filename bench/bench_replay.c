@@ -0,0 +1,323 @@
+/* Replays a trace written by AB_vector_trace.h under another allocator or
+ * growth factor:
+ *
+ *     bench_replay TRACE [ALLOCATOR [GROWTH]]
+ *
+ * ALLOCATOR is libc (realloc), copy (malloc, memcpy and free, as most
+ * pooling allocators do) or mremap (pages moved by the kernel above
+ * 128 KiB, Linux only). GROWTH is the factor by which a full vector grows
+ * on push; AB_vec uses 2. Without them every combination is run, each in
+ * a child process so that peak RSS is measured per run. */
+#define _GNU_SOURCE
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum { ALLOC_LIBC, ALLOC_COPY, ALLOC_MREMAP, ALLOCATORS };
+static const char *const alloc_names[ALLOCATORS] = { "libc", "copy", "mremap" };
+
+#define MREMAP_MIN ((size_t)128 * 1024)
+#define PAGE_UP(n) (((n) + 4095) & ~(size_t)4095)
+
+static int allocator;
+static double growth;
+static uint64_t reallocs;
+static size_t live, peak_live;
+
+static int is_mapped(size_t size)
+{
+    return allocator == ALLOC_MREMAP && size >= MREMAP_MIN;
+}
+
+static void *replay_realloc(void *ptr, size_t old_size, size_t new_size)
+{
+    void *p;
+    reallocs++;
+    if (allocator == ALLOC_COPY || is_mapped(old_size) != is_mapped(new_size)) {
+        size_t keep = old_size < new_size ? old_size : new_size;
+        if (is_mapped(new_size)) {
+            p = mmap(NULL, PAGE_UP(new_size), PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            p = p == MAP_FAILED ? NULL : p;
+        } else {
+            p = malloc(new_size);
+        }
+        if (p == NULL)
+            return NULL;
+        if (ptr != NULL)
+            memcpy(p, ptr, keep);
+        if (is_mapped(old_size))
+            munmap(ptr, PAGE_UP(old_size));
+        else
+            free(ptr);
+    } else if (is_mapped(new_size)) {
+        p = mremap(ptr, PAGE_UP(old_size), PAGE_UP(new_size), MREMAP_MAYMOVE);
+        p = p == MAP_FAILED ? NULL : p;
+    } else {
+        p = realloc(ptr, new_size);
+    }
+    if (p != NULL) {
+        live += new_size - old_size;
+        if (live > peak_live)
+            peak_live = live;
+    }
+    return p;
+}
+
+static void replay_free(void *ptr, size_t size)
+{
+    live -= size;
+    if (is_mapped(size))
+        munmap(ptr, PAGE_UP(size));
+    else
+        free(ptr);
+}
+
+#define AB_VEC_REALLOC(ptr, old_size, new_size) replay_realloc(ptr, old_size, new_size)
+#define AB_VEC_FREE(ptr, size) replay_free(ptr, size)
+#include <AB_vector_trace.h>
+
+/* Live vectors by address, in a linear-probing table with backward-shift
+ * deletion */
+typedef struct {
+    uint64_t key;
+    size_t elem_size;
+    struct AB_vector_generic v;
+} slot;
+
+static slot *table;
+static size_t table_mask, table_used;
+
+static size_t home(uint64_t key)
+{
+    return (size_t)(key * 0x9e3779b97f4a7c15ull >> 20) & table_mask;
+}
+
+static slot *lookup(uint64_t key)
+{
+    size_t i = home(key);
+    while (table[i].key != 0 && table[i].key != key)
+        i = (i + 1) & table_mask;
+    return &table[i];
+}
+
+static slot *find_or_add(uint64_t key, size_t elem_size)
+{
+    slot *s = lookup(key);
+    if (s->key == 0) {
+        if (2 * (table_used + 1) > table_mask + 1) {
+            slot *old = table;
+            size_t i, n = table_mask + 1;
+            table = calloc(2 * n, sizeof(*table));
+            if (table == NULL)
+                abort();
+            table_mask = 2 * n - 1;
+            for (i = 0; i < n; i++)
+                if (old[i].key != 0)
+                    *lookup(old[i].key) = old[i];
+            free(old);
+            s = lookup(key);
+        }
+        memset(s, 0, sizeof(*s));
+        s->key = key;
+        s->elem_size = elem_size;
+        table_used++;
+    }
+    return s;
+}
+
+static void release(slot *s)
+{
+    size_t i = (size_t)(s - table), j = i;
+    replay_free(s->v.elems, s->v.capacity * s->elem_size);
+    table_used--;
+    for (;;) {
+        j = (j + 1) & table_mask;
+        if (table[j].key == 0)
+            break;
+        /* Entries whose home is between the hole and themselves stay */
+        if (((j - home(table[j].key)) & table_mask) < ((j - i) & table_mask))
+            continue;
+        table[i] = table[j];
+        i = j;
+    }
+    table[i].key = 0;
+}
+
+static void set_capacity(slot *s, size_t n)
+{
+    int err;
+    if (n == 0) {
+        replay_free(s->v.elems, s->v.capacity * s->elem_size);
+        s->v.elems = NULL;
+        s->v.capacity = 0;
+        return;
+    }
+    err = AB_vec_resize_generic(&s->v, n, s->elem_size);
+    if (err)
+        abort();
+}
+
+static void set_num(slot *s, uint64_t num)
+{
+    if (num > s->v.capacity)
+        set_capacity(s, num);
+    s->v.num = num;
+}
+
+static void push(slot *s, uint64_t count)
+{
+    size_t e = s->elem_size;
+    for (; count > 0; count--) {
+        if (s->v.num == s->v.capacity) {
+            size_t n = (size_t)((double)s->v.capacity * growth);
+            set_capacity(s, n > s->v.capacity ? n : s->v.capacity ? s->v.capacity + 1 : 2);
+        }
+        memset((char *)s->v.elems + e * s->v.num++, (int)count, e);
+    }
+}
+
+static void replay(const AB_vec_trace_event *ev)
+{
+    slot *s = find_or_add(ev->vec, AB_vec_trace_elem_size(*ev));
+    switch (AB_vec_trace_op(*ev)) {
+    case AB_VEC_TRACE_INIT:
+        set_capacity(s, 0);
+        s->elem_size = AB_vec_trace_elem_size(*ev);
+        s->v.num = 0;
+        break;
+    case AB_VEC_TRACE_PUSH:
+        push(s, ev->arg);
+        set_num(s, ev->num);
+        break;
+    case AB_VEC_TRACE_RESIZE:
+        set_capacity(s, ev->arg);
+        set_num(s, ev->num);
+        break;
+    case AB_VEC_TRACE_RESERVE:
+        if (s->v.capacity < ev->arg)
+            set_capacity(s, ev->arg);
+        set_num(s, ev->num);
+        break;
+    case AB_VEC_TRACE_COPY:
+        if (s->v.capacity < ev->arg)
+            set_capacity(s, ev->arg);
+        memset(s->v.elems, 0, ev->arg * s->elem_size);
+        set_num(s, ev->num);
+        break;
+    case AB_VEC_TRACE_INSERT:
+        if (s->v.capacity <= ev->arg)
+            set_capacity(s, AB_vec_roundup_size_t(ev->arg + 1));
+        set_num(s, ev->num);
+        break;
+    case AB_VEC_TRACE_DESTROY:
+        release(s);
+        break;
+    }
+}
+
+/* Replay the whole file once and print one result line */
+static int run(FILE *f)
+{
+    static AB_vec_trace_event ev[4096];
+    struct rusage ru;
+    uint64_t events = 0, recorded = 0;
+    double t0, t;
+    size_t n, i;
+
+    table_mask = 1023;
+    table = calloc(table_mask + 1, sizeof(*table));
+    if (table == NULL)
+        return 1;
+    t0 = bench_now();
+    while ((n = fread(ev, sizeof(ev[0]), 4096, f)) > 0) {
+        for (i = 0; i < n; i++) {
+            replay(&ev[i]);
+            recorded += ev[i].dt;
+        }
+        events += n;
+    }
+    for (i = 0; i <= table_mask; i++)
+        while (table[i].key != 0)
+            release(&table[i]);
+    t = bench_now() - t0;
+    getrusage(RUSAGE_SELF, &ru);
+    printf("%-8s %6.2f %10.1f ms %12llu %10.1f MiB %10.1f MiB %12llu %10.1f ms\n",
+            alloc_names[allocator], growth, t * 1e3, (unsigned long long)reallocs,
+            (double)ru.ru_maxrss / 1024, (double)peak_live / (1 << 20),
+            (unsigned long long)events, (double)recorded * 1e-6);
+    free(table);
+    return ferror(f);
+}
+
+static FILE *open_trace(const char *path)
+{
+    AB_vec_trace_header h;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, AB_VEC_TRACE_MAGIC, 8) != 0
+            || h.version != AB_VEC_TRACE_VERSION || h.event_size != sizeof(AB_vec_trace_event)) {
+        fprintf(stderr, "%s: not a trace of this version and host\n", path);
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+int main(int argc, char **argv)
+{
+    static const double factors[] = { 2.0, 1.5, 1.25 };
+    FILE *f;
+    int a, g, err = 0;
+
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "usage: %s TRACE [libc|copy|mremap [GROWTH]]\n", argv[0]);
+        return 2;
+    }
+    if ((f = open_trace(argv[1])) == NULL)
+        return 1;
+    printf("%-8s %6s %13s %12s %14s %14s %12s %13s\n", "alloc", "growth", "time",
+            "reallocs", "peak RSS", "peak live", "events", "recorded");
+    if (argc > 2) {
+        for (allocator = 0; allocator < ALLOCATORS; allocator++)
+            if (strcmp(argv[2], alloc_names[allocator]) == 0)
+                break;
+        growth = argc > 3 ? atof(argv[3]) : 2.0;
+        if (allocator == ALLOCATORS || growth < 1.0) {
+            fprintf(stderr, "%s: unknown allocator or growth below 1\n", argv[0]);
+            fclose(f);
+            return 2;
+        }
+        err = run(f);
+        fclose(f);
+        return err;
+    }
+    fclose(f);
+    for (a = 0; a < ALLOCATORS; a++) {
+        for (g = 0; g < (int)(sizeof(factors) / sizeof(factors[0])); g++) {
+            int status;
+            pid_t pid;
+            fflush(stdout);
+            pid = fork();
+            if (pid == 0) {
+                allocator = a;
+                growth = factors[g];
+                if ((f = open_trace(argv[1])) == NULL)
+                    _exit(1);
+                err = run(f);
+                fflush(stdout);
+                _exit(err);
+            }
+            if (pid < 0 || waitpid(pid, &status, 0) != pid || status != 0)
+                err = 1;
+        }
+    }
+    return err;
+}
@@ -0,0 +1,235 @@
+#include "bench.h"
+#include <AB_vector_text.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N (64u * 1024u * 1024u)
+#define REPS 3
+
+typedef AB_vec(char) char_vec;
+typedef AB_vec(struct AB_vec_slice) slice_vec;
+typedef AB_vec(uint32_t) id_vec;
+
+#define TOKENS (4u * 1024u * 1024u)
+#define VOCAB (256u * 1024u)
+
+/* The same index as the interner, but one AB_vec per string */
+struct naive_entry {
+    uint32_t hash;
+    char_vec str;
+};
+typedef AB_vec(struct naive_entry) naive_table;
+
+static void naive_destroy(naive_table *t)
+{
+    size_t i;
+    for (i = 0; i < t->num; i++)
+        AB_vec_destroy(&t->elems[i].str);
+    AB_vec_destroy(t);
+}
+
+static uint32_t naive_intern(naive_table *t, id_vec *slots, const char *s, size_t len)
+{
+    uint32_t h = (uint32_t)AB_vec_hash_bytes(s, len, 0);
+    size_t i, mask;
+    if ((t->num + 1) * 2 > slots->num) {
+        AB_vec_resize_zero(slots, slots->num ? slots->num * 2 : 16);
+        memset(slots->elems, 0, slots->num * sizeof(uint32_t));
+        mask = slots->num - 1;
+        for (i = 0; i < t->num; i++) {
+            size_t j = t->elems[i].hash & mask;
+            while (slots->elems[j] != 0)
+                j = (j + 1) & mask;
+            slots->elems[j] = (uint32_t)i + 1;
+        }
+    }
+    mask = slots->num - 1;
+    for (i = h & mask; slots->elems[i] != 0; i = (i + 1) & mask) {
+        struct naive_entry *e = &t->elems[slots->elems[i] - 1];
+        if (e->hash == h && e->str.num == len && memcmp(e->str.elems, s, len) == 0)
+            return slots->elems[i] - 1;
+    }
+    {
+        struct naive_entry e;
+        e.hash = h;
+        AB_vec_init(&e.str);
+        AB_vec_resize(&e.str, len + 1);
+        memcpy(e.str.elems, s, len);
+        e.str.elems[len] = '\0';
+        e.str.num = len;
+        AB_vec_push(t, e);
+        slots->elems[i] = (uint32_t)t->num;
+        return (uint32_t)t->num - 1;
+    }
+}
+
+static uint32_t run_naive(const char_vec *text, const slice_vec *tokens)
+{
+    naive_table t = AB_VEC_INIT;
+    id_vec slots = AB_VEC_INIT;
+    uint32_t sum = 0;
+    size_t i;
+    for (i = 0; i < tokens->num; i++)
+        sum += naive_intern(&t, &slots, text->elems + tokens->elems[i].offset,
+                tokens->elems[i].len);
+    sum += (uint32_t)t.num;
+    naive_destroy(&t);
+    AB_vec_destroy(&slots);
+    return sum;
+}
+
+static uint32_t run_interner(const char_vec *text, const slice_vec *tokens)
+{
+    AB_vec_interner in;
+    uint32_t id, sum = 0;
+    size_t i;
+    AB_vec_interner_init(&in);
+    for (i = 0; i < tokens->num; i++) {
+        if (AB_vec_intern(&in, text->elems + tokens->elems[i].offset, tokens->elems[i].len,
+                    &id) != 0)
+            abort();
+        sum += id;
+    }
+    sum += AB_vec_interner_size(&in);
+    AB_vec_interner_destroy(&in);
+    return sum;
+}
+
+static uint32_t run_bulk(const char_vec *text, const slice_vec *tokens, id_vec *ids)
+{
+    AB_vec_interner in;
+    uint32_t sum = 0;
+    size_t i;
+    AB_vec_interner_init(&in);
+    if (AB_vec_intern_slices(&in, ids, text, tokens) != 0)
+        abort();
+    for (i = 0; i < ids->num; i++)
+        sum += ids->elems[i];
+    sum += AB_vec_interner_size(&in);
+    AB_vec_interner_destroy(&in);
+    return sum;
+}
+
+static void bench_intern(void)
+{
+    char_vec text = AB_VEC_INIT;
+    slice_vec tokens = AB_VEC_INIT;
+    id_vec ids = AB_VEC_INIT;
+    uint32_t i, seed = 7, sums[3];
+    double best;
+    char word[32];
+
+    /* Words drawn from a skewed vocabulary, as in real text */
+    for (i = 0; i < TOKENS; i++) {
+        uint32_t r;
+        int len;
+        seed = seed * 1103515245u + 12345u;
+        r = (seed >> 8) % VOCAB;
+        r = (uint32_t)(((uint64_t)r * r) / VOCAB);
+        len = sprintf(word, "tok%u_%x ", (unsigned)r, (unsigned)(r * 2654435761u) >> 20);
+        if (text.num + (size_t)len > text.capacity)
+            AB_vec_reserve(&text, 2 * text.capacity + (size_t)len);
+        memcpy(text.elems + text.num, word, (size_t)len);
+        text.num += (size_t)len;
+    }
+    AB_vec_split(&tokens, &text, " ", AB_VEC_SPLIT_SKIP_EMPTY);
+    printf("tokens: %u\n", (unsigned)tokens.num);
+
+    BENCH_BEST(best, REPS, sums[0] = run_naive(&text, &tokens));
+    bench_report("one AB_vec per string", best, (double)text.num);
+    BENCH_BEST(best, REPS, sums[1] = run_interner(&text, &tokens));
+    bench_report("AB_vec_intern", best, (double)text.num);
+    BENCH_BEST(best, REPS, sums[2] = run_bulk(&text, &tokens, &ids));
+    bench_report("AB_vec_intern_slices", best, (double)text.num);
+    printf("checksums: %u %u %u\n", (unsigned)sums[0], (unsigned)sums[1], (unsigned)sums[2]);
+
+    AB_vec_destroy(&text);
+    AB_vec_destroy(&tokens);
+    AB_vec_destroy(&ids);
+}
+
+/* What callers did before: one heap-allocated copy per field */
+static size_t split_copies(const char_vec *buf, char delim)
+{
+    size_t i, start = 0, fields = 0;
+    for (i = 0; i <= buf->num; i++) {
+        if (i < buf->num && buf->elems[i] != delim)
+            continue;
+        {
+            char_vec field = AB_VEC_INIT;
+            AB_vec_resize(&field, i - start + 1);
+            memcpy(field.elems, buf->elems + start, i - start);
+            field.num = i - start;
+            fields++;
+            AB_vec_destroy(&field);
+        }
+        start = i + 1;
+    }
+    return fields;
+}
+
+/* Slices, but found one byte at a time */
+static void split_bytes(slice_vec *slices, const char_vec *buf, const char *delims)
+{
+    unsigned char table[256] = { 0 };
+    size_t i, start = 0;
+    while (*delims != '\0')
+        table[(unsigned char)*delims++] = 1;
+    slices->num = 0;
+    for (i = 0; i <= buf->num; i++) {
+        if (i < buf->num && !table[(unsigned char)buf->elems[i]])
+            continue;
+        {
+            struct AB_vec_slice f;
+            f.offset = start;
+            f.len = i - start;
+            AB_vec_push(slices, f);
+        }
+        start = i + 1;
+    }
+}
+
+int main(void)
+{
+    char_vec buf = AB_VEC_INIT;
+    slice_vec slices = AB_VEC_INIT;
+    double best;
+    size_t fields = 0;
+    uint32_t i, seed = 1;
+
+    /* CSV-like rows: fields of 1 to 16 bytes, every 8th one quoted */
+    AB_vec_resize(&buf, N);
+    for (i = 0; buf.num < N - 64; i++) {
+        uint32_t len, j;
+        seed = seed * 1103515245u + 12345u;
+        len = 1 + (seed >> 28);
+        if (i % 8 == 7)
+            buf.elems[buf.num++] = '"';
+        for (j = 0; j < len; j++)
+            buf.elems[buf.num++] = (char)('a' + (seed >> (j % 24)) % 26);
+        if (i % 8 == 7)
+            buf.elems[buf.num++] = '"';
+        buf.elems[buf.num++] = i % 10 == 9 ? '\n' : ',';
+    }
+    printf("bytes: %u\n", (unsigned)buf.num);
+
+    BENCH_BEST(best, REPS, fields = split_copies(&buf, ','));
+    bench_report("one AB_vec per field", best, (double)buf.num);
+    BENCH_BEST(best, REPS, split_bytes(&slices, &buf, ","));
+    bench_report("byte loop (1 delimiter)", best, (double)buf.num);
+    BENCH_BEST(best, REPS, AB_vec_split(&slices, &buf, ",", 0));
+    bench_report("AB_vec_split (1 delimiter)", best, (double)buf.num);
+    BENCH_BEST(best, REPS, split_bytes(&slices, &buf, ",\n\t;"));
+    bench_report("byte loop (4 delimiters)", best, (double)buf.num);
+    BENCH_BEST(best, REPS, AB_vec_split(&slices, &buf, ",\n\t;", 0));
+    bench_report("AB_vec_split (4 delimiters)", best, (double)buf.num);
+    BENCH_BEST(best, REPS, AB_vec_split(&slices, &buf, ",\n", AB_VEC_SPLIT_QUOTED));
+    bench_report("AB_vec_split (CSV quoted)", best, (double)buf.num);
+    printf("fields: %u / %u\n", (unsigned)fields, (unsigned)slices.num);
+
+    AB_vec_destroy(&buf);
+    AB_vec_destroy(&slices);
+
+    bench_intern();
+    return 0;
+}
@@ -0,0 +1,96 @@
+/* Records a trace of a synthetic workload for bench_replay:
+ *
+ *     bench_trace [TRACE]
+ *
+ * A pool of records is refilled at random, each with a vector whose size
+ * is small most of the time and occasionally large, while one log vector
+ * takes a push per record and a snapshot of it is copied now and then. The
+ * workload runs once untraced and once writing TRACE (ab_vec.trace by
+ * default), to show the cost of recording. */
+#include "bench.h"
+#define AB_VEC_TRACE
+#include <AB_vector_trace.h>
+
+#define RECORDS 4096
+#define ROUNDS 200000
+
+typedef AB_vec(uint32_t) u32_vec;
+typedef AB_vec(uint64_t) u64_vec;
+
+static uint64_t rng_state = 88172645463325252ull;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+static uint32_t record_size(void)
+{
+    uint32_t r = rng() % 100;
+    if (r < 80)
+        return 1 + rng() % 32;
+    if (r < 99)
+        return 1 + rng() % 1000;
+    return 1 + rng() % 20000;
+}
+
+static uint64_t workload(void)
+{
+    static u32_vec records[RECORDS];
+    u64_vec log, snapshot;
+    uint64_t pushed = 0;
+    uint32_t i, j, n;
+
+    rng_state = 88172645463325252ull;
+    for (i = 0; i < RECORDS; i++)
+        AB_vec_init(&records[i]);
+    AB_vec_init(&log);
+    AB_vec_init(&snapshot);
+    for (i = 0; i < ROUNDS; i++) {
+        u32_vec *r = &records[rng() % RECORDS];
+        AB_vec_destroy(r);
+        AB_vec_init(r);
+        n = record_size();
+        for (j = 0; j < n; j++)
+            AB_vec_push(r, j);
+        AB_vec_push(&log, (uint64_t)i << 32 | n);
+        pushed += n + 1;
+        if (i % 50000 == 49999)
+            AB_vec_copy(&snapshot, &log);
+    }
+    for (i = 0; i < RECORDS; i++)
+        AB_vec_destroy(&records[i]);
+    AB_vec_destroy(&log);
+    AB_vec_destroy(&snapshot);
+    return pushed;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "ab_vec.trace";
+    double plain, traced;
+    uint64_t pushed = 0;
+    FILE *f;
+
+    BENCH_BEST(plain, 3, pushed = workload());
+    bench_report("untraced", plain, (double)pushed * sizeof(uint32_t));
+
+    f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+    traced = bench_now();
+    if (AB_vec_trace_start(f) != 0)
+        return 1;
+    workload();
+    if (AB_vec_trace_stop() != 0)
+        return 1;
+    traced = bench_now() - traced;
+    bench_report("traced", traced, (double)pushed * sizeof(uint32_t));
+    printf("%s: %ld bytes for %llu pushes\n", path, ftell(f), (unsigned long long)pushed);
+    return fclose(f) != 0;
+}
@@ -0,0 +1,122 @@
+#include <assert.h>
+#include <stdlib.h>
+
+static unsigned reallocs;
+
+static void *counting_realloc(void *ptr, size_t new_size)
+{
+    reallocs++;
+    return realloc(ptr, new_size);
+}
+
+#define AB_VEC_REALLOC(ptr, old_size, new_size) counting_realloc(ptr, new_size)
+#define AB_VEC_FREE(ptr, size) free(ptr)
+#define AB_VEC_ADAPTIVE
+#include <AB_vector_adaptive.h>
+
+typedef AB_vec(uint32_t) u32_vec;
+typedef AB_vec(uint64_t) u64_vec;
+
+/* One push site: fill a vector with n elements and return how many times
+ * it was reallocated */
+static unsigned fill(uint32_t n, size_t *first_capacity)
+{
+    u32_vec v;
+    uint32_t i;
+    unsigned before = reallocs;
+    AB_vec_init(&v);
+    for (i = 0; i < n; i++) {
+        int err = AB_vec_push(&v, i);
+        assert(!err);
+        if (i == 0)
+            *first_capacity = AB_vec_max(&v);
+    }
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&v, i) == i);
+    AB_vec_destroy(&v);
+    return reallocs - before;
+}
+
+static unsigned fill_pushp(uint32_t n)
+{
+    u32_vec v = AB_VEC_INIT;
+    uint32_t i, *p;
+    unsigned before = reallocs;
+    for (i = 0; i < n; i++) {
+        p = AB_vec_pushp(&v);
+        assert(p != NULL);
+        *p = i;
+    }
+    AB_vec_destroy(&v);
+    return reallocs - before;
+}
+
+static size_t fill_large(void)
+{
+    u64_vec v = AB_VEC_INIT;
+    uint64_t i;
+    size_t first = 0;
+    for (i = 0; i < 1000000; i++) {
+        int err = AB_vec_push(&v, i);
+        assert(!err);
+        if (i == 0)
+            first = AB_vec_max(&v);
+    }
+    AB_vec_destroy(&v);
+    return first;
+}
+
+int main(void)
+{
+    AB_vec_site site = { 0, 0 };
+    u32_vec vecs[3] = { AB_VEC_INIT, AB_VEC_INIT, AB_VEC_INIT };
+    size_t first = 0;
+    unsigned n, i, k = 0;
+    uint32_t *p;
+
+    /* Nothing learned: the first push allocates 2 and 500 elements take
+     * 9 allocations */
+    n = fill(500, &first);
+    assert(first == 2 && n == 9);
+    /* Once learned, one allocation suffices */
+    n = fill(500, &first);
+    assert(first == 500 && n == 1);
+
+    /* Sizes around a mean mostly fit in the first allocation */
+    for (i = 0, n = 0; i < 200; i++)
+        n += fill(450 + (i * 37) % 100, &first);
+    assert(n < 230);
+
+    /* pushp sites learn separately */
+    n = fill_pushp(100);
+    assert(n == 7);
+    n = fill_pushp(100);
+    assert(n == 1);
+
+    /* The learned size is capped */
+    first = fill_large();
+    assert(first == 2);
+    first = fill_large();
+    assert(first == AB_VEC_ADAPTIVE_MAX / sizeof(uint64_t));
+
+    /* Each argument is evaluated once */
+    n = AB_vec_push(&vecs[k++], 7u);
+    assert(n == 0 && k == 1 && AB_vec_size(&vecs[0]) == 1 && AB_vec_at(&vecs[0], 0) == 7);
+    p = AB_vec_pushp(&vecs[k++]);
+    assert(p != NULL && k == 2 && AB_vec_size(&vecs[1]) == 1);
+    for (i = 0; i < 3; )
+        AB_vec_destroy(&vecs[i++]);
+    assert(i == 3);
+
+    /* The mean moves towards new sizes by 1/8 a sample, and the deviation
+     * by 1/4 */
+    AB_vec_site_sample(&site, 100);
+    assert(AB_vec_site_capacity(&site, 4) == 100);
+    AB_vec_site_sample(&site, 180);
+    assert(AB_vec_site_capacity(&site, 4) == 110 + 2 * 20);
+    for (i = 0; i < 100; i++)
+        AB_vec_site_sample(&site, 180);
+    assert(AB_vec_site_capacity(&site, 4) >= 178 && AB_vec_site_capacity(&site, 4) <= 182);
+    assert(AB_vec_site_capacity(&site, 1 << 20) == 2);
+    return 0;
+}
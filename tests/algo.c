@@ -0,0 +1,349 @@
+#include <AB_vector_algo.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct triple { uint32_t a, b, c; };
+
+/* Deterministic shuffle of [0, n) */
+static void make_permutation(uint32_t *perm, uint32_t n)
+{
+    uint32_t i, seed = 12345;
+    for (i = 0; i < n; i++)
+        perm[i] = i;
+    for (i = n; i > 1; i--) {
+        uint32_t j, tmp;
+        seed = seed * 1103515245u + 12345u;
+        j = (seed >> 8) % i;
+        tmp = perm[i - 1];
+        perm[i - 1] = perm[j];
+        perm[j] = tmp;
+    }
+}
+
+static void check_indexed(uint32_t n)
+{
+    AB_vec(uint32_t) perm = AB_VEC_INIT;
+    AB_vec(uint64_t) perm64 = AB_VEC_INIT;
+    AB_vec(uint32_t) src = AB_VEC_INIT;
+    AB_vec(uint32_t) dest = AB_VEC_INIT;
+    AB_vec(uint64_t) wide = AB_VEC_INIT;
+    AB_vec(uint64_t) wide_dest = AB_VEC_INIT;
+    AB_vec(struct triple) big = AB_VEC_INIT;
+    AB_vec(struct triple) big_dest = AB_VEC_INIT;
+    uint32_t i;
+
+    AB_vec_resize_zero(&perm, n);
+    make_permutation(perm.elems, n);
+    for (i = 0; i < n; i++) {
+        struct triple t;
+        t.a = i; t.b = i * 2; t.c = i * 3;
+        AB_vec_push(&perm64, perm.elems[i]);
+        AB_vec_push(&src, i * 10);
+        AB_vec_push(&wide, (uint64_t)i << 33);
+        AB_vec_push(&big, t);
+    }
+
+    AB_vec_gather(&dest, &src, &perm);
+    AB_vec_gather(&wide_dest, &wide, &perm64);
+    AB_vec_gather(&big_dest, &big, &perm);
+    assert(AB_vec_size(&dest) == n);
+    for (i = 0; i < n; i++) {
+        assert(AB_vec_at(&dest, i) == perm.elems[i] * 10);
+        assert(AB_vec_at(&wide_dest, i) == (uint64_t)perm.elems[i] << 33);
+        assert(AB_vec_at(&big_dest, i).c == perm.elems[i] * 3);
+    }
+
+    /* Scattering by the same permutation undoes the gather */
+    AB_vec_scatter(&src, &dest, &perm);
+    AB_vec_scatter(&wide, &wide_dest, &perm64);
+    for (i = 0; i < n; i++) {
+        assert(AB_vec_at(&src, i) == i * 10);
+        assert(AB_vec_at(&wide, i) == (uint64_t)i << 33);
+    }
+
+    AB_vec_permute(&src, &perm);
+    AB_vec_permute(&big, &perm64);
+    for (i = 0; i < n; i++) {
+        assert(AB_vec_at(&src, i) == AB_vec_at(&dest, i));
+        assert(AB_vec_at(&big, i).b == perm.elems[i] * 2);
+    }
+
+    AB_vec_destroy(&perm);
+    AB_vec_destroy(&perm64);
+    AB_vec_destroy(&src);
+    AB_vec_destroy(&dest);
+    AB_vec_destroy(&wide);
+    AB_vec_destroy(&wide_dest);
+    AB_vec_destroy(&big);
+    AB_vec_destroy(&big_dest);
+}
+
+typedef AB_vec(uint32_t) u32_vec;
+
+static void check_reorder(uint32_t n)
+{
+    AB_vec(uint8_t) bytes = AB_VEC_INIT;
+    AB_vec(uint16_t) shorts = AB_VEC_INIT;
+    AB_vec(uint64_t) wide = AB_VEC_INIT;
+    AB_vec(struct triple) big = AB_VEC_INIT;
+    u32_vec words = AB_VEC_INIT, parts[3] = { AB_VEC_INIT, AB_VEC_INIT, AB_VEC_INIT };
+    uint32_t i, k;
+    int err;
+
+    for (i = 0; i < n; i++) {
+        struct triple t;
+        t.a = i; t.b = i * 2; t.c = i * 3;
+        AB_vec_push(&bytes, (uint8_t)i);
+        AB_vec_push(&shorts, (uint16_t)i);
+        AB_vec_push(&words, i);
+        AB_vec_push(&wide, (uint64_t)i << 33 | i);
+        AB_vec_push(&big, t);
+    }
+
+    AB_vec_reverse(&bytes);
+    AB_vec_reverse(&shorts);
+    AB_vec_reverse(&words);
+    AB_vec_reverse(&wide);
+    AB_vec_reverse(&big);
+    for (i = 0; i < n; i++) {
+        uint32_t j = n - 1 - i;
+        assert(AB_vec_at(&bytes, i) == (uint8_t)j);
+        assert(AB_vec_at(&shorts, i) == (uint16_t)j);
+        assert(AB_vec_at(&words, i) == j);
+        assert(AB_vec_at(&wide, i) == ((uint64_t)j << 33 | j));
+        assert(AB_vec_at(&big, i).c == j * 3);
+    }
+    AB_vec_reverse(&words);
+
+    /* Small shifts take the memmove path, large ones the block swaps */
+    for (k = 0; k <= n; k += 1 + k / 2) {
+        AB_vec_rotate(&words, k);
+        AB_vec_rotate(&big, k);
+        for (i = 0; i < n; i++) {
+            assert(AB_vec_at(&words, i) == (i + k) % n);
+            assert(AB_vec_at(&big, i).a == n - 1 - (i + k) % n);
+        }
+        AB_vec_rotate(&words, n - k);
+        AB_vec_rotate(&big, n - k);
+    }
+
+    /* Concatenation, including the destination as one of the sources */
+    AB_vec_copy(&parts[0], &words);
+    AB_vec_push(&parts[2], 7);
+    err = AB_vec_concat(&parts[1], parts, 3);
+    assert(!err);
+    assert(AB_vec_size(&parts[1]) == n + 1);
+    err = AB_vec_concat(&parts[1], parts, 2);
+    assert(!err);
+    assert(AB_vec_size(&parts[1]) == 3 * n + 2);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&parts[1], i) == i && AB_vec_at(&parts[1], n + 1 + i) == i
+                && AB_vec_at(&parts[1], 2 * n + 1 + i) == i);
+    assert(AB_vec_at(&parts[1], n) == 7 && AB_vec_at(&parts[1], 3 * n + 1) == 7);
+
+    AB_vec_destroy(&bytes);
+    AB_vec_destroy(&shorts);
+    AB_vec_destroy(&words);
+    AB_vec_destroy(&wide);
+    AB_vec_destroy(&big);
+    for (i = 0; i < 3; i++)
+        AB_vec_destroy(&parts[i]);
+}
+
+static int triple_cmp(const void *x, const void *y)
+{
+    const struct triple *a = x, *b = y;
+    return (a->a > b->a) - (a->a < b->a);
+}
+
+/* Sorted by key, and stable: equal keys keep run order, then input order */
+static void check_merged(const struct triple *t, size_t n)
+{
+    size_t i;
+    for (i = 1; i < n; i++) {
+        assert(t[i - 1].a <= t[i].a);
+        if (t[i - 1].a == t[i].a)
+            assert(t[i - 1].b < t[i].b || (t[i - 1].b == t[i].b && t[i - 1].c < t[i].c));
+    }
+}
+
+static void check_merge(uint32_t n)
+{
+    AB_vec(struct triple) runs[5], out = AB_VEC_INIT, two = AB_VEC_INIT;
+    u32_vec a = AB_VEC_INIT, b = AB_VEC_INIT, merged = AB_VEC_INIT, expect = AB_VEC_INIT;
+    uint32_t i, k, seed = 777;
+    int err;
+
+    /* Runs of different lengths drawn from few keys, so ties are common */
+    for (k = 0; k < 5; k++) {
+        AB_vec_init(&runs[k]);
+        for (i = 0; i < n / (k + 1); i++) {
+            struct triple t;
+            seed = seed * 1103515245u + 12345u;
+            t.a = i * 3 / (k + 2) + (seed >> 28);
+            t.b = k;
+            t.c = i;
+            AB_vec_push(&runs[k], t);
+        }
+        for (i = 1; i < AB_vec_size(&runs[k]); i++)
+            if (runs[k].elems[i].a < runs[k].elems[i - 1].a)
+                runs[k].elems[i].a = runs[k].elems[i - 1].a;
+    }
+    for (i = 0; i < AB_vec_size(&runs[0]); i++)
+        AB_vec_push(&a, runs[0].elems[i].a);
+    for (i = 0; i < AB_vec_size(&runs[1]); i++)
+        AB_vec_push(&b, runs[1].elems[i].a);
+
+    err = AB_vec_merge(&merged, &a, &b, NULL);
+    assert(!err);
+    assert(AB_vec_size(&merged) == AB_vec_size(&a) + AB_vec_size(&b));
+    for (i = 1; i < AB_vec_size(&merged); i++)
+        assert(merged.elems[i - 1] <= merged.elems[i]);
+    err = AB_vec_merge(&two, &runs[0], &runs[1], triple_cmp);
+    assert(!err);
+    check_merged(two.elems, AB_vec_size(&two));
+
+    for (k = 0; k <= 5; k++) {
+        size_t total = 0;
+        for (i = 0; i < k; i++)
+            total += AB_vec_size(&runs[i]);
+        err = AB_vec_merge_runs(&out, runs, k, triple_cmp);
+        assert(!err);
+        assert(AB_vec_size(&out) == total);
+        check_merged(out.elems, total);
+        if (k == 2)
+            assert(AB_vec_equal(&out, &two));
+    }
+
+    /* In place: both the buffered and the rotating paths */
+    for (k = 1; k < 5; k++) {
+        size_t mid = AB_vec_size(&runs[0]);
+        AB_vec_copy(&out, &runs[0]);
+        for (i = 0; i < AB_vec_size(&runs[k]); i++)
+            AB_vec_push(&out, AB_vec_at(&runs[k], i));
+        AB_vec_merge_inplace(&out, mid, triple_cmp);
+        check_merged(out.elems, AB_vec_size(&out));
+    }
+    AB_vec_copy(&expect, &merged);
+    AB_vec_copy(&merged, &a);
+    for (i = 0; i < AB_vec_size(&b); i++)
+        AB_vec_push(&merged, AB_vec_at(&b, i));
+    AB_vec_merge_inplace(&merged, AB_vec_size(&a), NULL);
+    assert(AB_vec_equal(&merged, &expect));
+    AB_vec_copy(&merged, &b);
+    for (i = 0; i < AB_vec_size(&a); i++)
+        AB_vec_push(&merged, AB_vec_at(&a, i));
+    AB_vec_merge_inplace(&merged, AB_vec_size(&b), NULL);
+    assert(AB_vec_equal(&merged, &expect));
+
+    for (k = 0; k < 5; k++)
+        AB_vec_destroy(&runs[k]);
+    AB_vec_destroy(&out);
+    AB_vec_destroy(&two);
+    AB_vec_destroy(&a);
+    AB_vec_destroy(&b);
+    AB_vec_destroy(&merged);
+    AB_vec_destroy(&expect);
+}
+
+static int u32_cmp(const void *x, const void *y)
+{
+    uint32_t a = *(const uint32_t *)x, b = *(const uint32_t *)y;
+    return (a > b) - (a < b);
+}
+
+static void check_select(uint32_t n)
+{
+    AB_vec(struct triple) big = AB_VEC_INIT;
+    u32_vec keys = AB_VEC_INIT, sorted = AB_VEC_INIT, work = AB_VEC_INIT;
+    u32_vec heap = AB_VEC_INIT, span = AB_VEC_INIT;
+    uint32_t i, j, k, pass, seed = 99;
+    int err;
+
+    /* Random keys with many repeats, then sorted, reversed and constant */
+    for (pass = 0; pass < 4; pass++) {
+        keys.num = 0;
+        for (i = 0; i < n; i++) {
+            seed = seed * 1103515245u + 12345u;
+            AB_vec_push(&keys, pass == 0 ? (seed >> 8) % (n / 4 + 1) * 1000003u
+                    : pass == 1 ? i : pass == 2 ? n - i : 5);
+        }
+        AB_vec_copy(&sorted, &keys);
+        if (n > 0)
+            qsort(sorted.elems, n, sizeof(uint32_t), u32_cmp);
+
+        for (k = 0; k < n; k += 1 + k / 3) {
+            AB_vec_copy(&work, &keys);
+            AB_vec_nth_element(&work, k, NULL);
+            assert(AB_vec_at(&work, k) == AB_vec_at(&sorted, k));
+            for (i = 0; i < n; i++)
+                assert(i < k ? work.elems[i] <= work.elems[k] : work.elems[i] >= work.elems[k]);
+
+            AB_vec_copy(&work, &keys);
+            AB_vec_partial_sort(&work, k, u32_cmp);
+            for (i = 0; i < k; i++)
+                assert(AB_vec_at(&work, i) == AB_vec_at(&sorted, i));
+        }
+        AB_vec_copy(&work, &keys);
+        AB_vec_partial_sort(&work, n + 5, NULL);
+        assert(AB_vec_equal(&work, &sorted));
+
+        /* The stream arrives in uneven spans */
+        for (k = 0; k <= 100; k += 1 + k * 3) {
+            heap.num = 0;
+            for (i = 0; i < n; i += j) {
+                j = 1 + i % 997;
+                if (j > n - i)
+                    j = n - i;
+                span.elems = keys.elems + i;
+                span.num = span.capacity = j;
+                err = AB_vec_topk(&heap, &span, k, NULL);
+                assert(!err);
+            }
+            AB_vec_topk_sort(&heap, NULL);
+            assert(AB_vec_size(&heap) == (k < n ? k : n));
+            for (i = 0; i < AB_vec_size(&heap); i++)
+                assert(AB_vec_at(&heap, i) == AB_vec_at(&sorted, n - 1 - i));
+        }
+    }
+
+    /* Larger elements go through the comparator and byte swaps */
+    for (i = 0; i < n; i++) {
+        struct triple t;
+        t.a = keys.elems[n - 1 - i];
+        t.b = t.c = i;
+        AB_vec_push(&big, t);
+    }
+    AB_vec_partial_sort(&big, n / 2, triple_cmp);
+    for (i = 0; i < n / 2; i++)
+        assert(AB_vec_at(&big, i).a == AB_vec_at(&sorted, i));
+
+    AB_vec_destroy(&big);
+    AB_vec_destroy(&keys);
+    AB_vec_destroy(&sorted);
+    AB_vec_destroy(&work);
+    AB_vec_destroy(&heap);
+}
+
+int main(void)
+{
+    check_indexed(0);
+    check_indexed(1);
+    check_indexed(37);
+    check_indexed(100000);
+    check_reorder(0);
+    check_reorder(1);
+    check_reorder(37);
+    check_reorder(5000);
+    check_merge(0);
+    check_merge(1);
+    check_merge(37);
+    check_merge(20000);
+    check_select(0);
+    check_select(1);
+    check_select(37);
+    check_select(5000);
+    printf("algo: gather/scatter/permute/reverse/rotate/concat/merge/select ok\n");
+    return 0;
+}
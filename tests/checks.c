@@ -0,0 +1,35 @@
+/* AB_VEC_CHECK_LEVEL 2: failed checks are counted instead of aborting */
+static int failures;
+#define AB_VEC_CHECK_LEVEL 2
+#define AB_VEC_ASSERT(cond) ((cond) ? (void)0 : (void)failures++)
+#include <AB_vector.h>
+#include <assert.h>
+#include <stdio.h>
+
+int main(void)
+{
+    AB_vec(int) vec = AB_VEC_INIT;
+    int i, *p;
+
+    for (i = 0; i < 3; i++)
+        AB_vec_push(&vec, i);
+    AB_vec_reserve(&vec, 16);
+    for (i = 0; i < 3; i++)
+        assert(AB_vec_at(&vec, i) == i);
+    assert(failures == 0);
+
+    /* In capacity but past the size: only level 2 catches this */
+    p = &AB_vec_at(&vec, 3);
+    assert(failures == 1);
+    p = &AB_vec_at(&vec, 100);
+    assert(failures == 2);
+    (void)p;
+
+    while (AB_vec_size(&vec) > 0)
+        AB_vec_pop(&vec);
+    assert(failures == 2);
+
+    AB_vec_destroy(&vec);
+    puts("checks: ok");
+    return 0;
+}
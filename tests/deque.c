@@ -0,0 +1,79 @@
+#include <AB_vector_deque.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#define NTHIEVES 3
+#define NITEMS 200000
+
+static AB_deque(unsigned) dq;
+static AB_epoch epoch;
+static unsigned char seen[NITEMS];
+static int done;
+
+static void take(unsigned v)
+{
+    unsigned char before;
+    assert(v < NITEMS);
+    before = __atomic_fetch_add(&seen[v], 1, __ATOMIC_RELAXED);
+    assert(before == 0);
+}
+
+static void *thief(void *arg)
+{
+    unsigned slot = (unsigned)(size_t)arg, v;
+    for (;;) {
+        int result = AB_deque_steal(&dq, &v, slot);
+        if (result == AB_DEQUE_OK)
+            take(v);
+        else if (result == AB_DEQUE_EMPTY && __atomic_load_n(&done, __ATOMIC_ACQUIRE))
+            break;
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t threads[NTHIEVES];
+    unsigned i, v;
+    int err;
+
+    err = AB_epoch_init(&epoch, NTHIEVES + 1);
+    assert(!err);
+    AB_deque_init(&dq, &epoch);
+
+    /* Single-threaded LIFO/FIFO behaviour */
+    for (i = 0; i < 100; i++)
+        AB_deque_push(&dq, &i);
+    assert(AB_deque_size(&dq) == 100);
+    err = AB_deque_pop(&dq, &v);
+    assert(err == AB_DEQUE_OK && v == 99);
+    err = AB_deque_steal(&dq, &v, 0);
+    assert(err == AB_DEQUE_OK && v == 0);
+    while (AB_deque_pop(&dq, &v) == AB_DEQUE_OK)
+        ;
+    assert(AB_deque_size(&dq) == 0);
+
+    /* Concurrent: the owner pushes everything, popping every third item */
+    for (i = 0; i < NTHIEVES; i++)
+        pthread_create(&threads[i], NULL, thief, (void *)(size_t)(i + 1));
+    for (i = 0; i < NITEMS; i++) {
+        err = AB_deque_push(&dq, &i);
+        assert(!err);
+        if (i % 3 == 0 && AB_deque_pop(&dq, &v) == AB_DEQUE_OK)
+            take(v);
+    }
+    while (AB_deque_pop(&dq, &v) == AB_DEQUE_OK)
+        take(v);
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < NTHIEVES; i++)
+        pthread_join(threads[i], NULL);
+
+    for (i = 0; i < NITEMS; i++)
+        assert(seen[i] == 1);
+    printf("deque: %d items taken exactly once\n", NITEMS);
+
+    AB_deque_destroy(&dq);
+    AB_epoch_destroy(&epoch);
+    return 0;
+}
@@ -2,9 +2,35 @@
 #include <assert.h>
 #include <stdio.h>
 
+typedef AB_vec(int) int_vec;
+
+#ifdef AB_VEC_TYPEOF
+static int evals;
+static size_t size, max;
+
+static int_vec *counted(int_vec *vec)
+{
+    evals++;
+    return vec;
+}
+#endif
+
+static int int_cmp(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return x < y ? -1 : x > y;
+}
+
 int main(void)
 {
     AB_vec(int) my_vec = AB_VEC_INIT;
+    AB_vec(int) zeros = AB_VEC_INIT;
+    AB_vec(int) other = AB_VEC_INIT;
+    AB_vec(unsigned char) bytes = AB_VEC_INIT;
+    AB_vec(unsigned char) bytes2 = AB_VEC_INIT;
+    AB_vec_writer(int) w;
+    int_vec once = AB_VEC_INIT;
+    size_t cap, grows;
     int i;
 
     for (i = 0; i < 20; i++) {
@@ -17,11 +43,111 @@ int main(void)
         printf("%d -> %d\n", i, val);
     }
 
+    AB_vec_copy(&other, &my_vec);
+    assert(AB_vec_equal(&other, &my_vec));
+    assert(AB_vec_compare_with(&other, &my_vec, int_cmp) == 0);
+    AB_vec_at(&other, 3) = -1;
+    assert(!AB_vec_equal(&other, &my_vec));
+    assert(AB_vec_compare_with(&other, &my_vec, int_cmp) < 0);
+    AB_vec_at(&other, 3) = 3;
+    AB_vec_pop(&other);
+    assert(AB_vec_compare_with(&other, &my_vec, int_cmp) < 0);
+    assert(AB_vec_compare_with(&my_vec, &other, int_cmp) > 0);
+
+    /* Bytes compare as unsigned char */
+    AB_vec_push(&bytes, 'a');
+    AB_vec_push(&bytes, 0x80);
+    AB_vec_copy(&bytes2, &bytes);
+    assert(AB_vec_compare(&bytes, &bytes2) == 0);
+    AB_vec_at(&bytes2, 1) = 0x01;
+    assert(AB_vec_compare(&bytes, &bytes2) > 0);
+    AB_vec_pop(&bytes2);
+    assert(AB_vec_compare(&bytes2, &bytes) < 0);
+
     while (AB_vec_size(&my_vec) > 0) {
         int val = AB_vec_pop(&my_vec);
         printf("Got value %d\n", val);
     }
 
+    AB_vec_push(&zeros, 5);
+    AB_vec_resize_zero(&zeros, 1000);
+    assert(AB_vec_at(&zeros, 0) == 5);
+    while (AB_vec_size(&zeros) > 0)
+        AB_vec_pop(&zeros);
+    AB_vec_resize_zero(&zeros, 1 << 20);
+    for (i = 0; i < 1 << 20; i++)
+        assert(AB_vec_at(&zeros, i) == 0);
+
+    /* Append through a writer: the size is only updated on commit */
+    AB_vec_push(&other, -7);
+    i = AB_vec_writer_open(&w, &other, 0);
+    assert(!i);
+    for (i = 0; i < 1000; i++) {
+        int err = AB_vec_writer_push(&w, i);
+        assert(!err);
+    }
+    *AB_vec_writer_pushp(&w) = 1000;
+    AB_vec_writer_commit(&w);
+    assert(AB_vec_size(&other) == 20 + 1001);
+    i = AB_vec_writer_reserve(&w, 5000);
+    assert(!i);
+    assert(AB_vec_max(&other) >= 20 + 1001 + 5000);
+    AB_vec_writer_push(&w, 1001);
+    AB_vec_writer_close(&w);
+    assert(AB_vec_size(&other) == 20 + 1002);
+    assert(AB_vec_at(&other, 19) == -7);
+    for (i = 0; i <= 1001; i++)
+        assert(AB_vec_at(&other, 20 + i) == i);
+
+    /* Growing by one element at a time reallocates geometrically */
+    AB_vec_destroy(&zeros);
+    AB_vec_init(&zeros);
+    for (i = 0, grows = 0, cap = 0; i < 100000; i++) {
+        int err = AB_vec_resize_fill(&zeros, AB_vec_size(&zeros) + 1, i);
+        assert(!err);
+        if (AB_vec_max(&zeros) != cap) {
+            cap = AB_vec_max(&zeros);
+            grows++;
+        }
+    }
+    assert(grows <= 18 && AB_vec_at(&zeros, 99999) == 99999);
+    /* And so does resize_zero, on both its calloc and realloc paths */
+    AB_vec_destroy(&zeros);
+    AB_vec_init(&zeros);
+    for (i = 0, grows = 0, cap = 0; i < 100000; i++) {
+        int err = AB_vec_resize_zero(&zeros, AB_vec_size(&zeros) + 3);
+        assert(!err);
+        if (AB_vec_max(&zeros) != cap) {
+            cap = AB_vec_max(&zeros);
+            grows++;
+        }
+    }
+    assert(grows <= 20 && AB_vec_size(&zeros) == 300000 && AB_vec_at(&zeros, 299999) == 0);
+
+#ifdef AB_VEC_TYPEOF
+    /* Each macro evaluates its vector argument exactly once */
+    AB_vec_push(counted(&once), 1);
+    assert(evals == 1);
+    *AB_vec_pushp(counted(&once)) = 2;
+    AB_vec_insert(counted(&once), 4, 5);
+    AB_vec_at(counted(&once), 2) = 3;
+    assert(evals == 4);
+    size = AB_vec_size(counted(&once));
+    max = AB_vec_max(counted(&once));
+    assert(size == 5 && max >= 5);
+    i = AB_vec_pop(counted(&once));
+    assert(i == 5 && evals == 7);
+    i = 5;
+    AB_vec_resize_fill(counted(&once), (size_t)i++ + 2, 9);
+    assert(evals == 8 && i == 6 && AB_vec_size(&once) == 7 && AB_vec_at(&once, 4) == 9);
+    assert(AB_vec_at(&once, 0) == 1 && AB_vec_at(&once, 1) == 2 && AB_vec_at(&once, 2) == 3);
+#endif
+
     AB_vec_destroy(&my_vec);
+    AB_vec_destroy(&zeros);
+    AB_vec_destroy(&other);
+    AB_vec_destroy(&once);
+    AB_vec_destroy(&bytes);
+    AB_vec_destroy(&bytes2);
     return 0;
 }
@@ -18,10 +18,6 @@ static void *my_realloc(void *ptr, size_t old_size, size_t new_size, void *userd
     const char *name = userdata;
     fprintf(stderr, "Called with old-size = %lu, new-size = %lu, name = %s\n",
             old_size, new_size, name);
-
-    if (new_size > old_size)
-        memset((char *)new_ptr + old_size, 0x0, new_size - old_size);
-
     return new_ptr;
 }
 #define AB_VEC_REALLOC(ptr, old_size, new_size, userdata) \
@@ -57,9 +53,12 @@ int main(void)
     int i;
     AB_vec(int) vec = AB_VEC_INIT;
     AB_vec(int) vec2 = AB_VEC_INIT;
+    AB_vec(int) vec3 = AB_VEC_INIT;
 
     AB_vec_userdata(&vec) = "my vector!";
 
+    /* Zero the slots AB_vec_insert would otherwise skip */
+    AB_vec_resize_zero(&vec, 19);
     AB_vec_insert(&vec, 19, 2);
 
     for (i = 0; i < 20; i++) {
@@ -76,6 +75,14 @@ int main(void)
 
     AB_vec_at(&vec, 18) = 3;
 
+    AB_vec_userdata(&vec3) = "Filled vector";
+    AB_vec_resize_fill(&vec3, 50, -1);
+    AB_vec_resize_fill(&vec3, 60, 7);
+    my_assert(AB_vec_size(&vec3) == 60);
+    my_assert(AB_vec_at(&vec3, 49) == -1 && AB_vec_at(&vec3, 50) == 7);
+    AB_vec_resize_fill(&vec3, 10, 0);
+    my_assert(AB_vec_size(&vec3) == 10 && AB_vec_at(&vec3, 9) == -1);
+
     i = AB_vec_size(&vec) - 1;
     while (AB_vec_size(&vec) > 0) {
         printf("pop %d - %d\n", i, AB_vec_pop(&vec));
@@ -89,5 +96,6 @@ int main(void)
 
     AB_vec_destroy(&vec);
     AB_vec_destroy(&vec2);
+    AB_vec_destroy(&vec3);
     return 0;
 }
@@ -0,0 +1,105 @@
+#include <AB_vector_filter.h>
+#include <assert.h>
+#include <stdio.h>
+
+static uint64_t next_key(uint64_t *seed)
+{
+    *seed = *seed * 6364136223846793005u + 1442695040888963407u;
+    return *seed ^ (*seed >> 29);
+}
+
+static void check_filter(size_t n, unsigned bits_per_key, double max_fpr)
+{
+    AB_vec(uint64_t) keys = AB_VEC_INIT;
+    AB_vec(uint64_t) probe = AB_VEC_INIT;
+    AB_vec(uint64_t) bits = AB_VEC_INIT;
+    AB_bloom f;
+    uint64_t seed = n + bits_per_key;
+    size_t i, hits = 0;
+    int err;
+
+    AB_bloom_init(&f);
+    for (i = 0; i < n; i++)
+        AB_vec_push(&keys, next_key(&seed));
+    err = AB_bloom_build(&f, &keys, bits_per_key);
+    assert(!err);
+    assert(AB_bloom_bytes(&f) * 8 >= n * bits_per_key);
+
+    /* No false negatives, one at a time or in bulk */
+    for (i = 0; i < n; i++)
+        assert(AB_bloom_contains(&f, AB_vec_at(&keys, i)));
+    err = AB_bloom_query(&f, &bits, &keys);
+    assert(!err);
+    assert(AB_vec_size(&bits) == (n + 63) / 64);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&bits, i / 64) >> (i % 64) & 1);
+    if (n % 64 != 0)
+        assert(AB_vec_at(&bits, n / 64) >> (n % 64) == 0);
+
+    /* Keys that were never added; the bulk query agrees with the single one */
+    for (i = 0; i < 100000; i++)
+        AB_vec_push(&probe, next_key(&seed) | 1u << 0);
+    err = AB_bloom_query(&f, &bits, &probe);
+    assert(!err);
+    for (i = 0; i < AB_vec_size(&probe); i++) {
+        int hit = AB_vec_at(&bits, i / 64) >> (i % 64) & 1;
+        assert(hit == AB_bloom_contains(&f, AB_vec_at(&probe, i)));
+        hits += (size_t)hit;
+    }
+    printf("filter: n=%u bits/key=%u fpr=%.4f\n", (unsigned)n, bits_per_key,
+            (double)hits / (double)AB_vec_size(&probe));
+    assert((double)hits / (double)AB_vec_size(&probe) <= max_fpr);
+
+    AB_bloom_destroy(&f);
+    AB_vec_destroy(&keys);
+    AB_vec_destroy(&probe);
+    AB_vec_destroy(&bits);
+}
+
+int main(void)
+{
+    AB_vec(uint64_t) keys = AB_VEC_INIT;
+    AB_vec(uint64_t) bits = AB_VEC_INIT;
+    AB_bloom f;
+    int err;
+
+#if defined(__SSE2__)
+    /* The SIMD bit positions match the scalar definition */
+    {
+        uint64_t seed = 99;
+        size_t i;
+        for (i = 0; i < 10000; i++) {
+            uint32_t h = (uint32_t)next_key(&seed), w[8];
+            __m128i m0, m1;
+            unsigned j;
+            AB_bloom_masks(h, &m0, &m1);
+            _mm_storeu_si128((__m128i *)w, m0);
+            _mm_storeu_si128((__m128i *)(w + 4), m1);
+            for (j = 0; j < 8; j++)
+                assert(w[j] == 1u << ((h * AB_bloom_salt[j]) >> 27));
+        }
+    }
+#endif
+
+    /* An empty filter contains nothing */
+    AB_bloom_init(&f);
+    assert(!AB_bloom_contains(&f, 0));
+    AB_vec_push(&keys, 1);
+    AB_vec_push(&keys, 2);
+    err = AB_bloom_query(&f, &bits, &keys);
+    assert(!err && AB_vec_size(&bits) == 1 && AB_vec_at(&bits, 0) == 0);
+    err = AB_bloom_build(&f, &keys, 10);
+    assert(!err && AB_bloom_contains(&f, 1) && AB_bloom_contains(&f, 2));
+    AB_bloom_add(&f, 3);
+    assert(AB_bloom_contains(&f, 3));
+    AB_bloom_destroy(&f);
+    AB_vec_destroy(&keys);
+    AB_vec_destroy(&bits);
+
+    check_filter(1, 10, 0.05);
+    check_filter(1000, 10, 0.03);
+    check_filter(100003, 10, 0.02);
+    check_filter(100003, 16, 0.004);
+    check_filter(300000, 4, 0.4);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <AB_vector_hash.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int u64_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(void)
+{
+    AB_vec(unsigned char) a = AB_VEC_INIT;
+    AB_vec(unsigned char) b = AB_VEC_INIT;
+    AB_vec(uint64_t) seen = AB_VEC_INIT;
+    uint64_t x = 12345, y = 67890, seed = 1;
+    size_t i, j;
+
+    /* The portable 128-bit multiply agrees with the native one */
+    for (i = 0; i < 1000; i++) {
+        uint64_t a0, b0, a1, b1;
+        seed = seed * 6364136223846793005u + 1442695040888963407u;
+        a0 = a1 = seed;
+        b0 = b1 = seed * 0x9e3779b97f4a7c15u + i;
+        AB_vec_hash_mum(&a0, &b0);
+        AB_vec_hash_mum_portable(&a1, &b1);
+        assert(a0 == a1 && b0 == b1);
+    }
+
+    assert(AB_vec_hash(&a, 0) == AB_vec_hash_bytes(NULL, 0, 0));
+    assert(AB_vec_hash(&a, 0) != AB_vec_hash(&a, 1));
+
+    /* Equal contents hash equal; every single-bit flip and every length
+     * gives a new hash. Lengths cover all of the short and long paths. */
+    for (i = 0; i < 200; i++) {
+        uint64_t h;
+        AB_vec_push(&a, (unsigned char)(i * 37));
+        AB_vec_copy(&b, &a);
+        assert(AB_vec_equal(&a, &b));
+        h = AB_vec_hash(&a, 42);
+        assert(h == AB_vec_hash(&b, 42));
+        assert(h != AB_vec_hash(&a, 43));
+        AB_vec_push(&seen, h);
+        for (j = 0; j <= i; j++) {
+            AB_vec_at(&b, j) ^= (unsigned char)(1u << (j % 8));
+            assert(!AB_vec_equal(&a, &b));
+            AB_vec_push(&seen, AB_vec_hash(&b, 42));
+            AB_vec_at(&b, j) ^= (unsigned char)(1u << (j % 8));
+        }
+    }
+    /* No two of them collide */
+    qsort(seen.elems, AB_vec_size(&seen), sizeof(uint64_t), u64_cmp);
+    for (i = 1; i < AB_vec_size(&seen); i++)
+        assert(AB_vec_at(&seen, i - 1) != AB_vec_at(&seen, i));
+
+    assert(AB_vec_hash_bytes(&x, sizeof x, 0) != AB_vec_hash_bytes(&y, sizeof y, 0));
+
+    AB_vec_destroy(&a);
+    AB_vec_destroy(&b);
+    AB_vec_destroy(&seen);
+    puts("hash: ok");
+    return 0;
+}
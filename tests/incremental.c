@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Count live buffers through the allocator hooks */
+static long live_buffers;
+static void *count_realloc(void *ptr, size_t new_size)
+{
+    if (ptr == NULL)
+        live_buffers++;
+    return realloc(ptr, new_size);
+}
+static void count_free(void *ptr)
+{
+    if (ptr != NULL)
+        live_buffers--;
+    free(ptr);
+}
+#define AB_VEC_REALLOC(ptr, old_size, new_size) count_realloc(ptr, new_size)
+#define AB_VEC_FREE(ptr, size) count_free(ptr)
+/* Tiny thresholds, so that small vectors go through every state */
+#define AB_VEC_INCREMENTAL_MIN 64
+#define AB_VEC_INCREMENTAL_STEP 8
+
+#include <AB_vector_incremental.h>
+#include <assert.h>
+#include <stdio.h>
+
+struct triple {
+    uint64_t a, b, c;
+};
+
+static void check_u32(void)
+{
+    AB_ivec(uint32_t) v = AB_IVEC_INIT;
+    uint32_t i, j, migrations = 0;
+    int err;
+
+    for (i = 0; i < 100000; i++) {
+        int was = AB_ivec_migrating(&v);
+        err = AB_ivec_push(&v, i * 3);
+        assert(!err);
+        migrations += !was && AB_ivec_migrating(&v);
+        assert(live_buffers <= 2);
+        /* Spot-check both buffers while elements are moving */
+        if (AB_ivec_migrating(&v) || i % 97 == 0) {
+            for (j = 0; j <= i; j += 1 + i / 64)
+                assert(AB_ivec_at(&v, j) == j * 3);
+            assert(AB_ivec_at(&v, i) == i * 3);
+        }
+    }
+    assert(migrations > 5);
+    assert(AB_ivec_size(&v) == 100000);
+
+    /* Writes through AB_ivec_at() survive the move */
+    for (j = (uint32_t)AB_ivec_size(&v); !AB_ivec_migrating(&v); j++)
+        AB_ivec_push(&v, j * 3);
+    for (j = 0; j < AB_ivec_size(&v); j++)
+        AB_ivec_at(&v, j) += 1;
+    AB_ivec_finish(&v);
+    assert(!AB_ivec_migrating(&v) && live_buffers == 1);
+    for (j = 0; j < AB_ivec_size(&v); j++)
+        assert(v.elems[j] == j * 3 + 1);
+
+    /* Popping into the unmoved part, then pushing again */
+    for (j = (uint32_t)AB_ivec_size(&v); !AB_ivec_migrating(&v); j++)
+        AB_ivec_push(&v, j * 3 + 1);
+    for (i = 0; i < 5000; i++) {
+        uint32_t n = (uint32_t)AB_ivec_size(&v) - 1;
+        uint32_t x = AB_ivec_pop(&v);
+        assert(x == n * 3 + 1);
+    }
+    for (i = 0; i < 20000; i++) {
+        uint32_t *p = AB_ivec_pushp(&v);
+        assert(p != NULL);
+        *p = (uint32_t)(AB_ivec_size(&v) - 1) * 3 + 1;
+    }
+    for (j = 0; j < AB_ivec_size(&v); j++)
+        assert(AB_ivec_at(&v, j) == j * 3 + 1);
+
+    AB_ivec_destroy(&v);
+    assert(live_buffers == 0);
+}
+
+static void check_large_elements(void)
+{
+    AB_ivec(struct triple) v;
+    struct triple t;
+    uint64_t i;
+    int err;
+
+    /* Elements wider than the step are still moved one per push */
+    AB_ivec_init(&v);
+    for (i = 0; i < 3000; i++) {
+        t.a = i;
+        t.b = ~i;
+        t.c = i * i;
+        err = AB_ivec_push(&v, t);
+        assert(!err);
+        assert(live_buffers <= 2);
+    }
+    for (i = 0; i < 3000; i++) {
+        t = AB_ivec_at(&v, i);
+        assert(t.a == i && t.b == ~i && t.c == i * i);
+    }
+    /* Destroying in the middle of a move frees both buffers */
+    while (!AB_ivec_migrating(&v))
+        AB_ivec_push(&v, t);
+    AB_ivec_destroy(&v);
+    assert(live_buffers == 0);
+}
+
+int main(void)
+{
+    check_u32();
+    check_large_elements();
+    printf("incremental: ok\n");
+    return 0;
+}
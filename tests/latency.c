@@ -0,0 +1,92 @@
+#define AB_VEC_LATENCY
+#include <AB_vector_latency.h>
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+
+#define THREADS 4
+#define PUSHES 100000
+
+typedef AB_vec(uint32_t) u32_vec;
+
+static void *worker(void *arg)
+{
+    u32_vec v = AB_VEC_INIT;
+    uint32_t i, *p;
+    int err;
+    (void)arg;
+    for (i = 0; i < PUSHES; i++) {
+        err = AB_vec_push(&v, i);
+        assert(!err);
+        p = AB_vec_pushp(&v);
+        assert(p != NULL);
+        *p = i;
+    }
+    for (i = 0; i < 2 * PUSHES; i++)
+        assert(AB_vec_at(&v, i) == i / 2);
+    err = AB_vec_insert(&v, 3 * PUSHES, 7u);
+    assert(!err && AB_vec_at(&v, 3 * PUSHES) == 7);
+    err = AB_vec_resize(&v, 4 * PUSHES);
+    assert(!err);
+    AB_vec_destroy(&v);
+    return NULL;
+}
+
+int main(void)
+{
+    static AB_vec_latency all;
+    pthread_t threads[THREADS];
+    uint64_t prev = 0, t;
+    unsigned b;
+    int i;
+    FILE *f;
+    char line[256];
+
+    /* Buckets are contiguous and each value lands in the right one */
+    for (b = 0; b + 1 < AB_VEC_LATENCY_BUCKETS; b++) {
+        assert(AB_vec_latency_bucket_low(b + 1) > AB_vec_latency_bucket_low(b));
+        assert(AB_vec_latency_bucket(AB_vec_latency_bucket_low(b)) == b);
+        assert(AB_vec_latency_bucket(AB_vec_latency_bucket_low(b + 1) - 1) == b);
+    }
+    assert(AB_vec_latency_bucket(UINT64_MAX) == AB_VEC_LATENCY_BUCKETS - 1);
+
+    AB_vec_latency_merge(&all);
+    assert(AB_vec_latency_count(&all, AB_VEC_LATENCY_PUSH) == 0);
+    assert(AB_vec_latency_quantile(&all, AB_VEC_LATENCY_PUSH, 0.5) == 0);
+
+    for (i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, worker, NULL);
+    worker(NULL);
+    for (i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    /* Every call of every thread is counted, including exited ones */
+    AB_vec_latency_merge(&all);
+    assert(AB_vec_latency_count(&all, AB_VEC_LATENCY_PUSH) == (THREADS + 1) * PUSHES);
+    assert(AB_vec_latency_count(&all, AB_VEC_LATENCY_PUSHP) == (THREADS + 1) * PUSHES);
+    assert(AB_vec_latency_count(&all, AB_VEC_LATENCY_INSERT) == THREADS + 1);
+    assert(AB_vec_latency_count(&all, AB_VEC_LATENCY_RESIZE) == THREADS + 1);
+    for (i = 0; i < 5; i++) {
+        static const double q[] = { 0, 0.5, 0.99, 0.999, 1 };
+        t = AB_vec_latency_quantile(&all, AB_VEC_LATENCY_PUSH, q[i]);
+        assert(t >= prev && t <= all.max[AB_VEC_LATENCY_PUSH]);
+        prev = t;
+    }
+    assert(prev == all.max[AB_VEC_LATENCY_PUSH]);
+
+    f = tmpfile();
+    assert(f != NULL);
+    AB_vec_latency_dump(&all, f);
+    rewind(f);
+    i = 0;
+    while (fgets(line, sizeof(line), f) != NULL)
+        i += strncmp(line, "push ", 5) == 0 || strncmp(line, "resize ", 7) == 0;
+    assert(i == 2);
+    fclose(f);
+    AB_vec_latency_dump(&all, stdout);
+
+    AB_vec_latency_reset();
+    AB_vec_latency_merge(&all);
+    assert(AB_vec_latency_count(&all, AB_VEC_LATENCY_PUSH) == 0);
+    return 0;
+}
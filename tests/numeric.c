@@ -0,0 +1,221 @@
+#include <AB_vector_numeric.h>
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+static void check_scan(AB_vec_pool *pool, size_t n)
+{
+    AB_vec(uint32_t) v32 = AB_VEC_INIT;
+    AB_vec(uint32_t) out32 = AB_VEC_INIT;
+    AB_vec(uint64_t) v64 = AB_VEC_INIT;
+    uint32_t sum32 = 0;
+    uint64_t sum64 = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        AB_vec_push(&v32, (uint32_t)(i * 2654435761u));
+        AB_vec_push(&v64, (uint64_t)i * i);
+    }
+
+    AB_vec_inclusive_scan(pool, &out32, &v32);
+    AB_vec_exclusive_scan(pool, &v32, &v32);
+    AB_vec_inclusive_scan(pool, &v64, &v64);
+    assert(AB_vec_size(&out32) == n);
+    for (i = 0; i < n; i++) {
+        assert(AB_vec_at(&v32, i) == sum32);
+        sum32 += (uint32_t)(i * 2654435761u);
+        assert(AB_vec_at(&out32, i) == sum32);
+        sum64 += (uint64_t)i * i;
+        assert(AB_vec_at(&v64, i) == sum64);
+    }
+
+    AB_vec_destroy(&v32);
+    AB_vec_destroy(&out32);
+    AB_vec_destroy(&v64);
+}
+
+static void check_convert(AB_vec_pool *pool, size_t n)
+{
+    AB_vec(int32_t) i32 = AB_VEC_INIT, back = AB_VEC_INIT;
+    AB_vec(float) f32 = AB_VEC_INIT, nar = AB_VEC_INIT;
+    AB_vec(double) f64 = AB_VEC_INIT;
+    AB_vec(uint8_t) u8 = AB_VEC_INIT;
+    AB_vec(uint32_t) u32 = AB_VEC_INIT;
+    AB_vec(int16_t) i16 = AB_VEC_INIT;
+    size_t i;
+    int err;
+
+    /* Values on both sides of the narrowing limits, except float to
+     * int32_t, whose limits check_convert_limits() covers */
+    for (i = 0; i < n; i++) {
+        int32_t x = (int32_t)(uint32_t)(i * 2654435761u) >> (i % 24);
+        AB_vec_push(&i32, x);
+        AB_vec_push(&f64, i % 5 == 0 ? 1e300 * (i % 2 ? 1 : -1) : (double)x / 3);
+        AB_vec_push(&u8, (uint8_t)i);
+    }
+
+    err = AB_vec_convert(pool, &f32, &i32, AB_VEC_CONV_I32_F32);
+    assert(!err);
+    assert(AB_vec_size(&f32) == n);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&f32, i) == (float)AB_vec_at(&i32, i));
+
+    /* Scale past the int32_t range, with a NaN every 7 elements */
+    for (i = 0; i < n; i++)
+        f32.elems[i] = i % 7 == 3 ? NAN : f32.elems[i] * (i % 3 ? 1.5f : 0.5f);
+    err = AB_vec_convert(pool, &back, &f32, AB_VEC_CONV_F32_I32 | AB_VEC_CONV_SATURATE);
+    assert(!err);
+    for (i = 0; i < n; i++) {
+        float x = f32.elems[i];
+        int32_t want = x != x ? 0 : x >= 2147483648.0f ? INT32_MAX
+            : x <= -2147483648.0f ? INT32_MIN : (int32_t)x;
+        assert(AB_vec_at(&back, i) == want);
+    }
+    err = AB_vec_convert(pool, &back, &f32, AB_VEC_CONV_F32_I32);
+    assert(!err);
+    for (i = 0; i < n; i++)
+        if (f32.elems[i] > -2147483648.0f && f32.elems[i] < 2147483648.0f)
+            assert(AB_vec_at(&back, i) == (int32_t)f32.elems[i]);
+
+    err = AB_vec_convert(pool, &nar, &f64, AB_VEC_CONV_F64_F32);
+    assert(!err);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&nar, i) == (float)f64.elems[i]);
+    err = AB_vec_convert(pool, &nar, &f64, AB_VEC_CONV_F64_F32 | AB_VEC_CONV_SATURATE);
+    assert(!err);
+    for (i = 0; i < n; i++) {
+        double x = f64.elems[i];
+        assert(AB_vec_at(&nar, i) == (x > FLT_MAX ? FLT_MAX : x < -FLT_MAX ? -FLT_MAX : (float)x));
+    }
+    err = AB_vec_convert(pool, &f64, &nar, AB_VEC_CONV_F32_F64);
+    assert(!err);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&f64, i) == (double)nar.elems[i]);
+
+    err = AB_vec_convert(pool, &u32, &u8, AB_VEC_CONV_U8_U32);
+    assert(!err);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&u32, i) == (uint8_t)i);
+    for (i = 0; i < n; i++)
+        u32.elems[i] = (uint32_t)i32.elems[i];
+    err = AB_vec_convert(pool, &u8, &u32, AB_VEC_CONV_U32_U8);
+    assert(!err);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&u8, i) == (uint8_t)u32.elems[i]);
+    err = AB_vec_convert(pool, &u8, &u32, AB_VEC_CONV_U32_U8 | AB_VEC_CONV_SATURATE);
+    assert(!err);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&u8, i) == (u32.elems[i] > 255 ? 255 : u32.elems[i]));
+
+    err = AB_vec_convert(pool, &i16, &i32, AB_VEC_CONV_I32_I16);
+    assert(!err);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&i16, i) == (int16_t)(uint16_t)i32.elems[i]);
+    err = AB_vec_convert(pool, &i16, &i32, AB_VEC_CONV_I32_I16 | AB_VEC_CONV_SATURATE);
+    assert(!err);
+    for (i = 0; i < n; i++) {
+        int32_t x = i32.elems[i];
+        assert(AB_vec_at(&i16, i) == (x > INT16_MAX ? INT16_MAX : x < INT16_MIN ? INT16_MIN : x));
+    }
+
+    AB_vec_destroy(&i32);
+    AB_vec_destroy(&back);
+    AB_vec_destroy(&f32);
+    AB_vec_destroy(&nar);
+    AB_vec_destroy(&f64);
+    AB_vec_destroy(&u8);
+    AB_vec_destroy(&u32);
+    AB_vec_destroy(&i16);
+}
+
+/* Saturating float to int32_t at and past the limits, with each value both
+ * in a 4-wide block and in the scalar tail */
+static void check_convert_limits(void)
+{
+    static const float x[] = {
+        3e9f, -3e9f, INFINITY, -INFINITY, 2147483648.0f, -2147483648.0f, NAN, 1.5f
+    };
+    static const int32_t want[] = {
+        INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN, 0, 1
+    };
+    AB_vec(float) f32 = AB_VEC_INIT;
+    AB_vec(int32_t) i32 = AB_VEC_INIT;
+    size_t rot, len, i, n = sizeof(x) / sizeof(x[0]);
+    int err;
+
+    /* Every rotation at every length puts each value at every position
+     * of a block and of the tail */
+    for (rot = 0; rot < n; rot++) {
+        for (len = 1; len <= n + 3; len++) {
+            f32.num = 0;
+            for (i = 0; i < len; i++)
+                AB_vec_push(&f32, x[(rot + i) % n]);
+            err = AB_vec_convert(NULL, &i32, &f32, AB_VEC_CONV_F32_I32 | AB_VEC_CONV_SATURATE);
+            assert(!err);
+            for (i = 0; i < len; i++)
+                assert(AB_vec_at(&i32, i) == want[(rot + i) % n]);
+        }
+    }
+    AB_vec_destroy(&f32);
+    AB_vec_destroy(&i32);
+}
+
+static void check_histogram(AB_vec_pool *pool, size_t n)
+{
+    AB_vec(uint8_t) u8 = AB_VEC_INIT;
+    AB_vec(uint16_t) u16 = AB_VEC_INIT;
+    AB_vec(uint64_t) hist = AB_VEC_INIT, want = AB_VEC_INIT;
+    size_t i;
+    int err;
+
+    /* Runs of one key alternate with scattered keys */
+    for (i = 0; i < n; i++) {
+        uint32_t x = (i / 64) % 3 == 0 ? 7 : (uint32_t)(i * 2654435761u) >> 13;
+        AB_vec_push(&u8, (uint8_t)x);
+        AB_vec_push(&u16, (uint16_t)x);
+    }
+
+    AB_vec_resize_zero(&want, 256);
+    for (i = 0; i < n; i++)
+        want.elems[u8.elems[i]]++;
+    err = AB_vec_histogram(pool, &hist, &u8);
+    assert(!err);
+    assert(AB_vec_equal(&hist, &want));
+
+    want.num = 0;
+    AB_vec_resize_zero(&want, 65536);
+    for (i = 0; i < n; i++)
+        want.elems[u16.elems[i]]++;
+    err = AB_vec_histogram(pool, &hist, &u16);
+    assert(!err);
+    assert(AB_vec_equal(&hist, &want));
+
+    AB_vec_destroy(&u8);
+    AB_vec_destroy(&u16);
+    AB_vec_destroy(&hist);
+    AB_vec_destroy(&want);
+}
+
+int main(void)
+{
+    AB_vec_pool pool;
+    int err = AB_vec_pool_init(&pool, 4);
+    assert(!err);
+
+    check_scan(NULL, 0);
+    check_scan(NULL, 7);
+    check_scan(&pool, 1000);
+    check_scan(&pool, 1000003);
+    check_convert(NULL, 0);
+    check_convert(NULL, 45);
+    check_convert(&pool, 1000003);
+    check_convert_limits();
+    check_histogram(NULL, 0);
+    check_histogram(NULL, 200);
+    check_histogram(NULL, 100000);
+    check_histogram(&pool, 3000017);
+    printf("numeric: scans, conversions, histograms ok\n");
+
+    AB_vec_pool_destroy(&pool);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <AB_vector_packed.h>
+#include <assert.h>
+#include <stdio.h>
+
+typedef AB_vec(uint64_t) u64_vec;
+
+static void roundtrip(const u64_vec *vec)
+{
+    AB_packed p;
+    AB_vec(uint64_t) out = AB_VEC_INIT;
+    size_t i;
+    int err;
+
+    AB_packed_init(&p);
+    err = AB_packed_encode(&p, vec);
+    assert(!err);
+    assert(AB_packed_size(&p) == AB_vec_size(vec));
+    err = AB_packed_decode(&p, &out);
+    assert(!err);
+    assert(AB_vec_size(&out) == AB_vec_size(vec));
+    for (i = 0; i < AB_vec_size(vec); i++) {
+        assert(AB_vec_at(&out, i) == AB_vec_at(vec, i));
+        assert(AB_packed_get(&p, i) == AB_vec_at(vec, i));
+    }
+    AB_packed_destroy(&p);
+    AB_vec_destroy(&out);
+}
+
+int main(void)
+{
+    u64_vec sorted = AB_VEC_INIT;
+    u64_vec mixed = AB_VEC_INIT;
+    u64_vec empty = AB_VEC_INIT;
+    AB_packed p;
+    uint64_t x = 1000, seed = 7;
+    size_t i;
+
+    for (i = 0; i < 10000; i++) {
+        seed = seed * 6364136223846793005u + 1442695040888963407u;
+        x += (seed >> 58) + 1;
+        AB_vec_push(&sorted, x);
+        /* Widths vary per block, including the 33..64 bit planes */
+        AB_vec_push(&mixed, seed >> (i / 128 % 64));
+    }
+    AB_vec_push(&mixed, 0);
+    AB_vec_push(&mixed, UINT64_MAX);
+
+    roundtrip(&empty);
+    roundtrip(&sorted);
+    roundtrip(&mixed);
+
+    /* Sorted IDs with small gaps pack to a few bits each */
+    AB_packed_init(&p);
+    AB_packed_encode(&p, &sorted);
+    assert(AB_packed_bytes(&p) * 6 < AB_vec_size(&sorted) * sizeof(uint64_t));
+    printf("packed: %lu -> %lu bytes\n", (unsigned long)(AB_vec_size(&sorted) * sizeof(uint64_t)),
+            (unsigned long)AB_packed_bytes(&p));
+    AB_packed_destroy(&p);
+
+    AB_vec_destroy(&sorted);
+    AB_vec_destroy(&mixed);
+    return 0;
+}
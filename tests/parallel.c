@@ -0,0 +1,167 @@
+/* Exercise the streaming-store paths on small inputs */
+#define AB_VEC_STREAM_MIN_BYTES 4096
+#include <AB_vector_parallel.h>
+#include <assert.h>
+#include <stdio.h>
+
+static void add_one(void *elems, size_t n, void *ctx)
+{
+    unsigned *v = elems;
+    size_t i;
+    (void)ctx;
+    for (i = 0; i < n; i++)
+        v[i] += 1;
+}
+
+static void square(void *dest, const void *src, size_t n, void *ctx)
+{
+    unsigned long *d = dest;
+    const unsigned *s = src;
+    size_t i;
+    (void)ctx;
+    for (i = 0; i < n; i++)
+        d[i] = (unsigned long)s[i] * s[i];
+}
+
+static void sum(void *acc, const void *elems, size_t n, void *ctx)
+{
+    const unsigned long *v = elems;
+    unsigned long *total = acc;
+    size_t i;
+    (void)ctx;
+    for (i = 0; i < n; i++)
+        *total += v[i];
+}
+
+static void combine(void *acc, const void *other, void *ctx)
+{
+    (void)ctx;
+    *(unsigned long *)acc += *(const unsigned long *)other;
+}
+
+static void check(AB_vec_pool *pool, unsigned n)
+{
+    AB_vec(unsigned) vec = AB_VEC_INIT;
+    AB_vec(unsigned long) squares = AB_VEC_INIT;
+    unsigned long total = 0, expected = 0;
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        int err = AB_vec_push(&vec, i);
+        assert(!err);
+    }
+
+    AB_vec_parallel_for(pool, &vec, add_one, NULL);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&vec, i) == i + 1);
+
+    AB_vec_parallel_transform(pool, &squares, &vec, square, NULL);
+    assert(AB_vec_size(&squares) == n);
+    for (i = 0; i < n; i++) {
+        assert(AB_vec_at(&squares, i) == (unsigned long)(i + 1) * (i + 1));
+        expected += AB_vec_at(&squares, i);
+    }
+
+    AB_vec_parallel_reduce(pool, &squares, &total, sum, combine, NULL);
+    assert(total == expected);
+
+    AB_vec_destroy(&vec);
+    AB_vec_destroy(&squares);
+}
+
+struct rgb { unsigned char r, g, b; };
+
+static void check_bulk(AB_vec_pool *pool, unsigned n)
+{
+    AB_vec(unsigned long) vec = AB_VEC_INIT;
+    AB_vec(unsigned long) copy = AB_VEC_INIT;
+    AB_vec(struct rgb) pixels = AB_VEC_INIT;
+    AB_vec(unsigned char) bytes = AB_VEC_INIT;
+    struct rgb red = { 255, 0, 0 };
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        AB_vec_push(&vec, i * 7ul);
+        AB_vec_push(&pixels, red);
+        AB_vec_push(&bytes, 0);
+    }
+    AB_vec_copy_parallel(pool, &copy, &vec);
+    assert(AB_vec_size(&copy) == n);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&copy, i) == i * 7ul);
+
+    AB_vec_fill_parallel(pool, &copy, 0xdeadbeeful);
+    AB_vec_fill(&vec, 0xdeadbeeful);
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(&copy, i) == 0xdeadbeeful && AB_vec_at(&vec, i) == 0xdeadbeeful);
+
+    red.g = 1;
+    AB_vec_fill_parallel(pool, &pixels, red);
+    AB_vec_fill_parallel(pool, &bytes, 0xab);
+    for (i = 0; i < n; i++) {
+        assert(AB_vec_at(&pixels, i).r == 255 && AB_vec_at(&pixels, i).g == 1);
+        assert(AB_vec_at(&pixels, i).b == 0 && AB_vec_at(&bytes, i) == 0xab);
+    }
+
+    AB_vec_destroy(&vec);
+    AB_vec_destroy(&copy);
+    AB_vec_destroy(&pixels);
+    AB_vec_destroy(&bytes);
+}
+
+static int u64_cmp(const void *x, const void *y)
+{
+    uint64_t a = *(const uint64_t *)x >> 32, b = *(const uint64_t *)y >> 32;
+    return (a > b) - (a < b);
+}
+
+static void check_merge(AB_vec_pool *pool, unsigned n)
+{
+    AB_vec(uint64_t) a = AB_VEC_INIT, b = AB_VEC_INIT;
+    AB_vec(uint64_t) serial = AB_VEC_INIT, par = AB_VEC_INIT;
+    unsigned i;
+
+    /* Keys in the high half, source and position in the low half, so the
+     * comparator sees ties and the outputs must agree on their order */
+    for (i = 0; i < n; i++)
+        AB_vec_push(&a, (uint64_t)(i / 3) << 32 | i);
+    for (i = 0; i < n / 2 + 5; i++)
+        AB_vec_push(&b, (uint64_t)(i / 2 + n / 8) << 32 | 0x80000000u | i);
+
+    AB_vec_merge(&serial, &a, &b, u64_cmp);
+    AB_vec_merge_parallel(pool, &par, &a, &b, u64_cmp);
+    assert(AB_vec_equal(&serial, &par));
+    AB_vec_merge(&serial, &a, &b, NULL);
+    AB_vec_merge_parallel(pool, &par, &b, &a, NULL);
+    assert(AB_vec_equal(&serial, &par));
+    for (i = 1; i < AB_vec_size(&par); i++)
+        assert(par.elems[i - 1] <= par.elems[i]);
+
+    AB_vec_destroy(&a);
+    AB_vec_destroy(&b);
+    AB_vec_destroy(&serial);
+    AB_vec_destroy(&par);
+}
+
+int main(void)
+{
+    AB_vec_pool pool;
+    int err = AB_vec_pool_init(&pool, 4);
+    assert(!err);
+
+    check(NULL, 1000);
+    check(&pool, 0);
+    check(&pool, 17);
+    check(&pool, 100003);
+    check(&pool, 1000000);
+    check_bulk(NULL, 5);
+    check_bulk(NULL, 100003);
+    check_bulk(&pool, 1000000);
+    check_merge(NULL, 1000);
+    check_merge(&pool, 0);
+    check_merge(&pool, 1000000);
+    printf("parallel: %u threads ok\n", AB_vec_pool_size(&pool));
+
+    AB_vec_pool_destroy(&pool);
+    return 0;
+}
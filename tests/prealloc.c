@@ -0,0 +1,109 @@
+/* Small thresholds, so that a few megabytes go through every state */
+#define AB_VEC_PREALLOC_MIN 4096
+#include <AB_vector_prealloc.h>
+#include <assert.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef AB_vec(uint64_t) u64_vec;
+
+static int state_of(AB_vec_prealloc *pa)
+{
+    int s;
+    pthread_mutex_lock(&pa->helper->lock);
+    s = pa->state;
+    pthread_mutex_unlock(&pa->helper->lock);
+    return s;
+}
+
+/* Push n elements, letting the helper finish each request before the
+ * vector grows when wait is set */
+static void fill(u64_vec *v, AB_vec_prealloc *pa, uint64_t n, int wait)
+{
+    uint64_t i;
+    int err;
+    for (i = 0; i < n; i++) {
+        err = AB_vec_prealloc_push(v, i);
+        assert(!err);
+        if (wait && pa != NULL)
+            while (state_of(pa) == AB_VEC_PREALLOC_QUEUED)
+                sched_yield();
+    }
+    for (i = 0; i < n; i++)
+        assert(AB_vec_at(v, i) == i);
+}
+
+/* Push until the vector holds n elements */
+static void fill_to(u64_vec *v, uint64_t n)
+{
+    while (AB_vec_size(v) < n) {
+        int err = AB_vec_prealloc_push(v, AB_vec_size(v));
+        assert(!err);
+    }
+}
+
+int main(void)
+{
+    AB_vec_prealloc_thread t, t2;
+    AB_vec_prealloc pa, pb, pc;
+    u64_vec v = AB_VEC_INIT, w = AB_VEC_INIT, late = AB_VEC_INIT, plain = AB_VEC_INIT;
+    int err;
+
+    err = AB_vec_prealloc_start(&t);
+    assert(!err);
+
+    /* Every growth to 4 KiB and up, capacity 2^9 to 2^20, is served by a prepared buffer */
+    AB_vec_prealloc_attach(&pa, &t, &v, 0.75);
+    fill(&v, &pa, 1u << 20, 1);
+    printf("prealloc: %lu hits, %lu misses\n", pa.hits, pa.misses);
+    assert(pa.hits == 12 && pa.misses == 0);
+    /* The full vector has already asked for its next buffer */
+    assert(state_of(&pa) == AB_VEC_PREALLOC_READY);
+
+    /* Without waiting, late buffers are dropped and the vector stays right */
+    AB_vec_prealloc_attach(&pb, &t, &w, 0);
+    fill(&w, &pb, 1u << 20, 0);
+    assert(pb.hits + pb.misses <= 12);
+    AB_vec_prealloc_detach(&w);
+    assert(w.userdata == NULL && state_of(&pb) == AB_VEC_PREALLOC_IDLE);
+
+    /* A request that a growth cancels before the helper gets to it is
+     * revived with the next size. The helper starts late, so the queue
+     * holds still meanwhile. */
+    t2.queue = NULL;
+    t2.shutdown = 0;
+    pthread_mutex_init(&t2.lock, NULL);
+    pthread_cond_init(&t2.wake, NULL);
+    pthread_cond_init(&t2.done, NULL);
+    AB_vec_prealloc_attach(&pc, &t2, &late, 0.75);
+    fill_to(&late, 200);
+    assert(state_of(&pc) == AB_VEC_PREALLOC_QUEUED && pc.request == 512 * sizeof(uint64_t));
+    fill_to(&late, 300);
+    assert(pc.misses == 1 && pc.cancel);
+    fill_to(&late, 400);
+    assert(state_of(&pc) == AB_VEC_PREALLOC_QUEUED && !pc.cancel);
+    assert(t2.queue == &pc && pc.next == NULL && pc.request == 1024 * sizeof(uint64_t));
+    err = pthread_create(&t2.thread, NULL, AB_vec_prealloc_main, &t2);
+    assert(!err);
+    while (state_of(&pc) == AB_VEC_PREALLOC_QUEUED)
+        sched_yield();
+    assert(state_of(&pc) == AB_VEC_PREALLOC_READY && pc.ready_size == pc.request);
+    fill_to(&late, 600);
+    assert(pc.hits == 1 && pc.misses == 1);
+    AB_vec_prealloc_detach(&late);
+    AB_vec_destroy(&late);
+    AB_vec_prealloc_stop(&t2);
+
+    /* A vector that is not attached grows as usual */
+    fill(&plain, NULL, 100000, 0);
+
+    /* Detaching with a buffer waiting, after the vector is destroyed */
+    AB_vec_destroy(&v);
+    AB_vec_prealloc_detach(&v);
+
+    AB_vec_destroy(&w);
+    AB_vec_destroy(&plain);
+    AB_vec_prealloc_stop(&t);
+    return 0;
+}
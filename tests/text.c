@@ -0,0 +1,176 @@
+#include <AB_vector_text.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef AB_vec(char) char_vec;
+typedef AB_vec(struct AB_vec_slice) slice_vec;
+typedef AB_vec(uint32_t) id_vec;
+
+static void set_text(char_vec *buf, const char *text)
+{
+    buf->num = 0;
+    while (*text != '\0')
+        AB_vec_push(buf, *text++);
+}
+
+/* Byte-at-a-time reference for unquoted splitting */
+static void check_against_reference(const char_vec *buf, const char *delims, int flags)
+{
+    slice_vec slices = AB_VEC_INIT;
+    size_t i, start = 0, k = 0;
+    int err = AB_vec_split(&slices, buf, delims, flags);
+    assert(!err);
+    for (i = 0; i <= buf->num && buf->num > 0; i++) {
+        if (i < buf->num && (buf->elems[i] == '\0' || strchr(delims, buf->elems[i]) == NULL))
+            continue;
+        if (i > start || !(flags & AB_VEC_SPLIT_SKIP_EMPTY)) {
+            assert(k < AB_vec_size(&slices));
+            assert(AB_vec_at(&slices, k).offset == start);
+            assert(AB_vec_at(&slices, k).len == i - start);
+            k++;
+        }
+        start = i + 1;
+    }
+    assert(AB_vec_size(&slices) == k);
+    AB_vec_destroy(&slices);
+}
+
+static void check_random(void)
+{
+    static const char *const sets[] = {
+        ",", ",;", " \t\n", ",;|:\t", "\x01\x7f\x80\xff ", "0123456789",
+        "aeiouAEIOU\n\r\t,", "\x10\x21\x32\x43\x54\x65\x76\x87\x98"
+    };
+    char_vec buf = AB_VEC_INIT;
+    uint32_t seed = 4321, len, s;
+    size_t i;
+
+    for (len = 0; len < 300; len += 1 + len / 4) {
+        for (s = 0; s < sizeof(sets) / sizeof(sets[0]); s++) {
+            buf.num = 0;
+            for (i = 0; i < len; i++) {
+                seed = seed * 1103515245u + 12345u;
+                /* Mostly letters, with delimiters and other bytes mixed in */
+                AB_vec_push(&buf, (seed >> 28) < 3 ? sets[s][(seed >> 8) % strlen(sets[s])]
+                        : (seed >> 28) < 4 ? (char)(seed >> 16) : (char)('a' + (seed >> 8) % 26));
+            }
+            check_against_reference(&buf, sets[s], 0);
+            check_against_reference(&buf, sets[s], AB_VEC_SPLIT_SKIP_EMPTY);
+        }
+    }
+    AB_vec_destroy(&buf);
+}
+
+static void expect_fields(const char *text, const char *delims, int flags,
+        const char *const *fields, size_t n)
+{
+    char_vec buf = AB_VEC_INIT;
+    slice_vec slices = AB_VEC_INIT;
+    size_t i;
+    int err;
+
+    set_text(&buf, text);
+    err = AB_vec_split(&slices, &buf, delims, flags);
+    assert(!err);
+    assert(AB_vec_size(&slices) == n);
+    for (i = 0; i < n; i++) {
+        struct AB_vec_slice f = AB_vec_at(&slices, i);
+        assert(f.len == strlen(fields[i]));
+        assert(memcmp(buf.elems + f.offset, fields[i], f.len) == 0);
+    }
+    AB_vec_destroy(&buf);
+    AB_vec_destroy(&slices);
+}
+
+static void check_interner(void)
+{
+    AB_vec_interner in;
+    char_vec buf = AB_VEC_INIT;
+    slice_vec slices = AB_VEC_INIT;
+    id_vec ids = AB_VEC_INIT;
+    char word[16];
+    uint32_t id, i;
+    int err;
+
+    AB_vec_interner_init(&in);
+    err = AB_vec_interner_find(&in, "a", 1, &id);
+    assert(err);
+
+    /* Enough strings to grow the index several times */
+    for (i = 0; i < 5000; i++) {
+        int len = sprintf(word, "w%u", (unsigned)i);
+        err = AB_vec_intern(&in, word, (size_t)len, &id);
+        assert(!err);
+        assert(id == i);
+    }
+    for (i = 0; i < 5000; i++) {
+        int len = sprintf(word, "w%u", (unsigned)i);
+        err = AB_vec_intern(&in, word, (size_t)len, &id);
+        assert(!err && id == i);
+        err = AB_vec_interner_find(&in, word, (size_t)len, &id);
+        assert(!err && id == i);
+        assert(AB_vec_interner_len(&in, i) == (size_t)len);
+        assert(strcmp(AB_vec_interner_str(&in, i), word) == 0);
+    }
+    assert(AB_vec_interner_size(&in) == 5000);
+    err = AB_vec_interner_find(&in, "w5000", 5, &id);
+    assert(err);
+
+    /* Empty strings, embedded NULs and prefixes are all distinct */
+    err = AB_vec_intern(&in, "", 0, &id);
+    assert(!err && id == 5000 && AB_vec_interner_len(&in, id) == 0);
+    err = AB_vec_intern(&in, "w1\0x", 4, &id);
+    assert(!err && id == 5001 && AB_vec_interner_len(&in, id) == 4);
+    err = AB_vec_intern(&in, "w1", 2, &id);
+    assert(!err && id == 1);
+
+    /* A string taken from the arena itself */
+    err = AB_vec_intern(&in, AB_vec_interner_str(&in, 4999) + 1, 3, &id);
+    assert(!err && id == 5002);
+    assert(strcmp(AB_vec_interner_str(&in, id), "499") == 0);
+
+    /* Bulk interning agrees with one at a time */
+    set_text(&buf, "w7 new w7 w4999  other new");
+    err = AB_vec_split(&slices, &buf, " ", 0);
+    assert(!err);
+    err = AB_vec_intern_slices(&in, &ids, &buf, &slices);
+    assert(!err);
+    assert(AB_vec_size(&ids) == 7);
+    assert(AB_vec_at(&ids, 0) == 7 && AB_vec_at(&ids, 2) == 7 && AB_vec_at(&ids, 3) == 4999);
+    assert(AB_vec_at(&ids, 1) == 5003 && AB_vec_at(&ids, 6) == 5003);
+    assert(AB_vec_at(&ids, 4) == 5000 && AB_vec_at(&ids, 5) == 5004);
+    assert(strcmp(AB_vec_interner_str(&in, 5004), "other") == 0);
+    assert(AB_vec_interner_size(&in) == 5005);
+
+    AB_vec_interner_destroy(&in);
+    AB_vec_destroy(&buf);
+    AB_vec_destroy(&slices);
+    AB_vec_destroy(&ids);
+}
+
+int main(void)
+{
+    static const char *const csv[] = { "a", "b,c", "", "d\"\"e", "", "f" };
+    static const char *const ws[] = { "one", "two", "three" };
+    static const char *const tail[] = { "x", "" };
+    static const char *const open[] = { "x", "y,z" };
+    static const char *const empty[] = { "" };
+    static const char *const whole[] = { "a,b" };
+    static const char *const line[] = { "a, b; c\td\n0123456789 abcdefghij,,klm" };
+
+    check_random();
+    expect_fields("", ",", 0, NULL, 0);
+    expect_fields(",", ",", AB_VEC_SPLIT_SKIP_EMPTY, NULL, 0);
+    expect_fields("x,", ",", 0, tail, 2);
+    expect_fields("\"\"", ",", AB_VEC_SPLIT_QUOTED, empty, 1);
+    expect_fields("a,\"b,c\",,\"d\"\"e\",\"\"junk,f", ",", AB_VEC_SPLIT_QUOTED, csv, 6);
+    expect_fields("x,\"y,z", ",", AB_VEC_SPLIT_QUOTED, open, 2);
+    /* No delimiters: the whole text is one field, on the SIMD path too */
+    expect_fields("a,b", "", 0, whole, 1);
+    expect_fields(line[0], "", 0, line, 1);
+    expect_fields("  one \t two\n\nthree ", " \t\n", AB_VEC_SPLIT_SKIP_EMPTY, ws, 3);
+    check_interner();
+    printf("text: split, intern ok\n");
+    return 0;
+}
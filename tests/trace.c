@@ -0,0 +1,141 @@
+#define AB_VEC_TRACE
+#include <AB_vector_trace.h>
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+
+typedef AB_vec(uint32_t) u32_vec;
+typedef AB_vec(uint64_t) u64_vec;
+
+static void *worker(void *arg)
+{
+    u64_vec v;
+    uint64_t i;
+    (void)arg;
+    AB_vec_init(&v);
+    for (i = 0; i < 10000; i++) {
+        int err = AB_vec_push(&v, i);
+        assert(!err);
+    }
+    AB_vec_destroy(&v);
+    return NULL;
+}
+
+static AB_vec_trace_event next(FILE *f)
+{
+    AB_vec_trace_event e;
+    size_t got = fread(&e, sizeof(e), 1, f);
+    assert(got == 1);
+    (void)got;
+    return e;
+}
+
+static void check(AB_vec_trace_event e, const void *vec, int op, uint64_t num, uint64_t arg,
+        size_t elem_size)
+{
+    assert(e.vec == (uint64_t)(uintptr_t)vec);
+    assert(AB_vec_trace_op(e) == op);
+    assert(e.num == num);
+    assert(e.arg == arg);
+    assert(AB_vec_trace_elem_size(e) == elem_size);
+    (void)e; (void)vec; (void)op; (void)num; (void)arg; (void)elem_size;
+}
+
+int main(void)
+{
+    u32_vec a, b = AB_VEC_INIT;
+    AB_vec_trace_header h;
+    AB_vec_trace_event e;
+    pthread_t thread;
+    uint32_t i, *p;
+    int err, worker_events = 0;
+    FILE *f = tmpfile();
+    assert(f != NULL);
+
+    /* Nothing is logged before the trace starts */
+    AB_vec_init(&a);
+    err = AB_vec_push(&a, 1u);
+    assert(!err);
+    AB_vec_destroy(&a);
+
+    err = AB_vec_trace_start(f);
+    assert(!err);
+    err = AB_vec_trace_start(f);
+    assert(err != 0);
+
+    AB_vec_init(&a);
+    for (i = 0; i < 100; i++) {
+        err = AB_vec_push(&a, i);
+        assert(!err);
+    }
+    p = AB_vec_pushp(&a);
+    assert(p != NULL);
+    *p = 100;
+    err = AB_vec_reserve(&a, 200);
+    assert(!err);
+    err = AB_vec_resize(&a, 150);
+    assert(!err);
+    err = AB_vec_insert(&a, 120, 42u);
+    assert(!err && AB_vec_size(&a) == 121 && AB_vec_at(&a, 120) == 42);
+    /* Alternating pushes do not merge */
+    err = AB_vec_push(&b, 1u) || AB_vec_push(&a, 2u) || AB_vec_push(&b, 3u);
+    assert(!err);
+    err = AB_vec_copy(&b, &a);
+    assert(!err && AB_vec_size(&b) == 122);
+    AB_vec_destroy(&a);
+    AB_vec_destroy(&b);
+
+    err = pthread_create(&thread, NULL, worker, NULL);
+    assert(!err);
+    pthread_join(thread, NULL);
+
+    err = AB_vec_trace_stop();
+    assert(!err);
+    err = AB_vec_trace_stop();
+    assert(err != 0);
+
+    /* Nothing is logged after it stops */
+    AB_vec_init(&a);
+    AB_vec_destroy(&a);
+
+    rewind(f);
+    err = fread(&h, sizeof(h), 1, f) != 1;
+    assert(!err);
+    assert(memcmp(h.magic, AB_VEC_TRACE_MAGIC, 8) == 0);
+    assert(h.version == AB_VEC_TRACE_VERSION && h.event_size == sizeof(AB_vec_trace_event));
+
+    /* The main thread's buffer is flushed first or second depending on
+     * the order the threads registered, so skip the worker's events */
+    for (;;) {
+        e = next(f);
+        if (e.vec == (uint64_t)(uintptr_t)&a)
+            break;
+        worker_events++;
+    }
+    check(e, &a, AB_VEC_TRACE_INIT, 0, 0, 4);
+    check(next(f), &a, AB_VEC_TRACE_PUSH, 101, 101, 4);
+    check(next(f), &a, AB_VEC_TRACE_RESERVE, 101, 200, 4);
+    check(next(f), &a, AB_VEC_TRACE_RESIZE, 101, 150, 4);
+    check(next(f), &a, AB_VEC_TRACE_INSERT, 121, 120, 4);
+    check(next(f), &b, AB_VEC_TRACE_PUSH, 1, 1, 4);
+    check(next(f), &a, AB_VEC_TRACE_PUSH, 122, 1, 4);
+    check(next(f), &b, AB_VEC_TRACE_PUSH, 2, 1, 4);
+    check(next(f), &b, AB_VEC_TRACE_COPY, 122, 150, 4);
+    check(next(f), &a, AB_VEC_TRACE_DESTROY, 122, 150, 4);
+    check(next(f), &b, AB_VEC_TRACE_DESTROY, 122, 150, 4);
+
+    /* The worker logged an init, one merged run of pushes and a destroy */
+    if (worker_events == 0) {
+        e = next(f);
+        assert(AB_vec_trace_op(e) == AB_VEC_TRACE_INIT && AB_vec_trace_elem_size(e) == 8);
+        e = next(f);
+        assert(AB_vec_trace_op(e) == AB_VEC_TRACE_PUSH && e.num == 10000 && e.arg == 10000);
+        e = next(f);
+        assert(AB_vec_trace_op(e) == AB_VEC_TRACE_DESTROY && e.arg == 16384);
+    } else {
+        assert(worker_events == 3);
+    }
+    assert(fread(&e, sizeof(e), 1, f) == 0);
+    fclose(f);
+    return 0;
+}